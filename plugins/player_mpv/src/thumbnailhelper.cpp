@@ -0,0 +1,260 @@
+// Long-lived video thumbnail generator used by qimgv's thumbnailer.
+// Decodes one frame per request with a single libmpv instance, so that
+// a folder of videos doesn't cost a process spawn + player init per file.
+//
+// Protocol (stdin / stdout, one request at a time):
+//   request:  "<size> <crop 0|1> <path>\n"
+//   response: "ok width=<w> height=<h> source_width=<w> source_height=<h> bytes=<n>\n"
+//             followed by n bytes of RGB888 pixels, rows without padding
+//   or:       "error <message>\n"
+// The thumbnail fits into size x size; with crop it is padded to exactly that.
+// Exits on EOF.
+
+#include <mpv/client.h>
+#include <mpv/render.h>
+#include <algorithm>
+#include <chrono>
+#include <clocale>
+#include <condition_variable>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <vector>
+
+#ifdef _WIN32
+#include <fcntl.h>
+#include <io.h>
+#endif
+
+namespace {
+
+const auto LOAD_TIMEOUT = std::chrono::seconds(15);
+const auto FRAME_TIMEOUT = std::chrono::seconds(5);
+
+struct Helper {
+    mpv_handle *mpv = nullptr;
+    mpv_render_context *render = nullptr;
+    std::mutex mutex;
+    std::condition_variable updated;
+    bool updatePending = false;
+
+    ~Helper() {
+        if(render)
+            mpv_render_context_free(render);
+        if(mpv)
+            mpv_terminate_destroy(mpv);
+    }
+
+    bool init() {
+        mpv = mpv_create();
+        if(!mpv)
+            return false;
+        const char *options[][2] = {
+            { "config", "no" },
+            { "load-scripts", "no" },
+            { "terminal", "no" },
+            { "vo", "libmpv" },
+            { "idle", "yes" },
+            { "pause", "yes" },
+            { "start", "15%" },
+            { "aid", "no" },
+            { "sid", "no" },
+            { "audio-display", "no" },
+            { "hwdec", "no" },
+            { "hr-seek", "no" },
+            { "vd-lavc-fast", "yes" },
+            { "vd-lavc-skiploopfilter", "all" },
+            { "vd-lavc-software-fallback", "1" },
+            { "demuxer-readahead-secs", "0" },
+            { "demuxer-max-bytes", "128KiB" },
+            { "sws-fast", "yes" },
+            { "sws-scaler", "fast-bilinear" },
+            { "keepaspect", "yes" },
+            { "background", "color" },
+        };
+        for(auto &option : options)
+            mpv_set_option_string(mpv, option[0], option[1]);
+        if(mpv_initialize(mpv) < 0)
+            return false;
+        mpv_render_param params[] = {
+            { MPV_RENDER_PARAM_API_TYPE, const_cast<char*>(MPV_RENDER_API_TYPE_SW) },
+            { MPV_RENDER_PARAM_INVALID, nullptr }
+        };
+        if(mpv_render_context_create(&render, mpv, params) < 0)
+            return false;
+        mpv_render_context_set_update_callback(render, &Helper::onUpdate, this);
+        return true;
+    }
+
+    static void onUpdate(void *ctx) {
+        auto helper = static_cast<Helper*>(ctx);
+        std::lock_guard<std::mutex> lock(helper->mutex);
+        helper->updatePending = true;
+        helper->updated.notify_one();
+    }
+
+    // waits until the first frame after the initial seek is there
+    bool load(const std::string &path, std::string &error) {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            updatePending = false;
+        }
+        const char *cmd[] = { "loadfile", path.c_str(), nullptr };
+        if(mpv_command(mpv, cmd) < 0) {
+            error = "loadfile failed";
+            return false;
+        }
+        auto deadline = std::chrono::steady_clock::now() + LOAD_TIMEOUT;
+        while(std::chrono::steady_clock::now() < deadline) {
+            mpv_event *event = mpv_wait_event(mpv, 0.1);
+            if(event->event_id == MPV_EVENT_PLAYBACK_RESTART)
+                return waitForFrame(error);
+            if(event->event_id == MPV_EVENT_END_FILE) {
+                auto endFile = static_cast<mpv_event_end_file*>(event->data);
+                error = (endFile->reason == MPV_END_FILE_REASON_ERROR) ? mpv_error_string(endFile->error)
+                                                                       : "no video";
+                return false;
+            }
+            if(event->event_id == MPV_EVENT_SHUTDOWN) {
+                error = "shutdown";
+                return false;
+            }
+        }
+        error = "timeout";
+        return false;
+    }
+
+    bool waitForFrame(std::string &error) {
+        auto deadline = std::chrono::steady_clock::now() + FRAME_TIMEOUT;
+        std::unique_lock<std::mutex> lock(mutex);
+        while(true) {
+            lock.unlock();
+            bool hasFrame = mpv_render_context_update(render) & MPV_RENDER_UPDATE_FRAME;
+            lock.lock();
+            if(hasFrame)
+                return true;
+            if(!updated.wait_until(lock, deadline, [this]() { return updatePending; })) {
+                error = "no frame";
+                return false;
+            }
+            updatePending = false;
+        }
+    }
+
+    void stop() {
+        const char *cmd[] = { "stop", nullptr };
+        mpv_command(mpv, cmd);
+        // drain until idle so that the next loadfile starts clean
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(2);
+        while(std::chrono::steady_clock::now() < deadline) {
+            mpv_event *event = mpv_wait_event(mpv, 0.1);
+            if(event->event_id == MPV_EVENT_IDLE || event->event_id == MPV_EVENT_SHUTDOWN)
+                break;
+        }
+    }
+
+    int64_t intProperty(const char *name) {
+        int64_t value = 0;
+        mpv_get_property(mpv, name, MPV_FORMAT_INT64, &value);
+        return value;
+    }
+
+    void process(int size, bool crop, const std::string &path) {
+        std::string error;
+        if(!load(path, error)) {
+            stop();
+            reply("error " + error + "\n");
+            return;
+        }
+        int64_t sourceWidth = intProperty("width");
+        int64_t sourceHeight = intProperty("height");
+        // display size: aspect ratio applied
+        int64_t displayWidth = intProperty("dwidth");
+        int64_t displayHeight = intProperty("dheight");
+        if(displayWidth <= 0 || displayHeight <= 0) {
+            displayWidth = sourceWidth;
+            displayHeight = sourceHeight;
+        }
+        if(displayWidth <= 0 || displayHeight <= 0) {
+            stop();
+            reply("error unknown video size\n");
+            return;
+        }
+        int width = size, height = size;
+        if(!crop) {
+            if(displayWidth >= displayHeight)
+                height = static_cast<int>(std::max<int64_t>(1, displayHeight * size / displayWidth));
+            else
+                width = static_cast<int>(std::max<int64_t>(1, displayWidth * size / displayHeight));
+        }
+        std::vector<unsigned char> frame(static_cast<size_t>(width) * height * 4);
+        int renderSize[2] = { width, height };
+        size_t stride = static_cast<size_t>(width) * 4;
+        mpv_render_param params[] = {
+            { MPV_RENDER_PARAM_SW_SIZE, renderSize },
+            { MPV_RENDER_PARAM_SW_FORMAT, const_cast<char*>("rgb0") },
+            { MPV_RENDER_PARAM_SW_STRIDE, &stride },
+            { MPV_RENDER_PARAM_SW_POINTER, frame.data() },
+            { MPV_RENDER_PARAM_INVALID, nullptr }
+        };
+        int result = mpv_render_context_render(render, params);
+        stop();
+        if(result < 0) {
+            reply(std::string("error ") + mpv_error_string(result) + "\n");
+            return;
+        }
+        // rgb0 -> rgb888, in place
+        size_t pixels = static_cast<size_t>(width) * height;
+        for(size_t i = 0; i < pixels; i++) {
+            frame[i * 3 + 0] = frame[i * 4 + 0];
+            frame[i * 3 + 1] = frame[i * 4 + 1];
+            frame[i * 3 + 2] = frame[i * 4 + 2];
+        }
+        std::ostringstream header;
+        header << "ok width=" << width << " height=" << height
+               << " source_width=" << sourceWidth << " source_height=" << sourceHeight
+               << " bytes=" << pixels * 3 << "\n";
+        reply(header.str(), frame.data(), pixels * 3);
+    }
+
+    void reply(const std::string &header, const unsigned char *data = nullptr, size_t size = 0) {
+        fwrite(header.data(), 1, header.size(), stdout);
+        if(data && size)
+            fwrite(data, 1, size, stdout);
+        fflush(stdout);
+    }
+};
+
+}
+
+int main() {
+#ifdef _WIN32
+    _setmode(_fileno(stdin), _O_BINARY);
+    _setmode(_fileno(stdout), _O_BINARY);
+#endif
+    // mpv requires this
+    std::setlocale(LC_NUMERIC, "C");
+    Helper helper;
+    if(!helper.init()) {
+        helper.reply("error could not initialize mpv\n");
+        return 1;
+    }
+    std::string line;
+    while(std::getline(std::cin, line)) {
+        if(!line.empty() && line.back() == '\r')
+            line.pop_back();
+        std::istringstream request(line);
+        int size = 0, crop = 0;
+        request >> size >> crop;
+        std::string path;
+        std::getline(request >> std::ws, path);
+        if(!request.fail() && size > 0 && size <= 4096 && !path.empty())
+            helper.process(size, crop != 0, path);
+        else
+            helper.reply("error bad request\n");
+    }
+    return 0;
+}
@@ -1,6 +1,12 @@
 #include "cache.h"
 
-Cache::Cache() {
+Cache::Cache()
+    : mMemoryLimit(0),
+      accessCounter(0),
+      hits(0),
+      misses(0),
+      evictions(0)
+{
 }
 
 bool Cache::contains(QString path) const {
@@ -12,7 +18,9 @@ bool Cache::insert(std::shared_ptr<Image> img) {
         if(items.contains(img->filePath())) {
             return false;
         } else {
-            items.insert(img->filePath(), new CacheItem(img));
+            auto *item = new CacheItem(img);
+            touch(item);
+            items.insert(img->filePath(), item);
             return true;
         }
     }
@@ -39,11 +47,20 @@ void Cache::clear() {
 std::shared_ptr<Image> Cache::get(QString path) {
     if(items.contains(path)) {
         CacheItem *item = items.value(path);
+        touch(item);
         return item->getContents();
     }
     return nullptr;
 }
 
+// same as get(), but also counts towards hit/miss stats
+// use this for the actual navigation requests only
+std::shared_ptr<Image> Cache::lookup(QString path) {
+    auto img = get(path);
+    img ? hits++ : misses++;
+    return img;
+}
+
 bool Cache::reserve(QString path) {
     if(items.contains(path)) {
         items[path]->lock();
@@ -60,17 +77,68 @@ bool Cache::release(QString path) {
     return false;
 }
 
-// removes all items except the ones in list
+// Evicts least recently used items until we fit into the memory limit.
+// Items in the list are never evicted, even if they alone exceed the limit.
+// Logs the stats whenever something gets evicted, for tuning the limit.
 void Cache::trimTo(QStringList pathList) {
-    for(auto path : items.keys()) {
-        if(!pathList.contains(path)) {
-            items[path]->lock();
-            auto *item = items.take(path);
-            delete item;
+    quint64 evictedBefore = evictions;
+    qint64 usage = memoryUsage();
+    while(usage > mMemoryLimit) {
+        QString lruPath;
+        quint64 lruTime = std::numeric_limits<quint64>::max();
+        for(auto i = items.constBegin(); i != items.constEnd(); ++i) {
+            if(i.value()->lastAccess() < lruTime && !pathList.contains(i.key())) {
+                lruTime = i.value()->lastAccess();
+                lruPath = i.key();
+            }
         }
+        if(lruPath.isEmpty())
+            break;
+        auto *item = items.take(lruPath);
+        item->lock();
+        usage -= item->getContents()->memorySize();
+        delete item;
+        evictions++;
+    }
+    if(evictions != evictedBefore) {
+        CacheStats s = stats();
+        qDebug() << "[Cache] evicted" << evictions - evictedBefore << "images;"
+                 << s.itemCount << "cached," << s.memoryUsage / 1048576 << "of" << s.memoryLimit / 1048576 << "MB;"
+                 << s.hits << "hits," << s.misses << "misses," << s.evictions << "evictions so far";
     }
 }
 
 const QList<QString> Cache::keys() const {
     return items.keys();
 }
+
+void Cache::setMemoryLimit(qint64 bytes) {
+    mMemoryLimit = qMax(bytes, 0ll);
+}
+
+qint64 Cache::memoryLimit() const {
+    return mMemoryLimit;
+}
+
+// summed on request; sizes can change when an image gets edited
+qint64 Cache::memoryUsage() const {
+    qint64 usage = 0;
+    for(auto item : items)
+        usage += item->getContents()->memorySize();
+    return usage;
+}
+
+CacheStats Cache::stats() const {
+    CacheStats s;
+    s.hits = hits;
+    s.misses = misses;
+    s.evictions = evictions;
+    s.memoryUsage = memoryUsage();
+    s.memoryLimit = mMemoryLimit;
+    s.itemCount = items.count();
+    return s;
+}
+
+void Cache::touch(CacheItem *item) {
+    item->setLastAccess(++accessCounter);
+}
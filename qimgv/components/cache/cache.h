@@ -4,10 +4,20 @@
 #include <QMap>
 #include <QSemaphore>
 #include <QMutexLocker>
+#include <limits>
 #include "sourcecontainers/image.h"
 #include "components/cache/cacheitem.h"
 #include "utils/imagefactory.h"
 
+struct CacheStats {
+    quint64 hits = 0;
+    quint64 misses = 0;
+    quint64 evictions = 0;
+    qint64 memoryUsage = 0;
+    qint64 memoryLimit = 0;
+    int itemCount = 0;
+};
+
 class Cache {
 public:
     explicit Cache();
@@ -19,10 +29,19 @@ public:
     void trimTo(QStringList list);
 
     std::shared_ptr<Image> get(QString path);
+    std::shared_ptr<Image> lookup(QString path);
     bool release(QString path);
     bool reserve(QString path);
     const QList<QString> keys() const;
 
+    void setMemoryLimit(qint64 bytes);
+    qint64 memoryLimit() const;
+    qint64 memoryUsage() const;
+    CacheStats stats() const;
+
 private:
     QMap<QString, CacheItem*> items;
+    qint64 mMemoryLimit;
+    quint64 accessCounter, hits, misses, evictions;
+    void touch(CacheItem *item);
 };
@@ -1,10 +1,10 @@
 #include "cacheitem.h"
 
-CacheItem::CacheItem() {
+CacheItem::CacheItem() : mLastAccess(0) {
     sem = new QSemaphore(1);
 }
 
-CacheItem::CacheItem(std::shared_ptr<Image> _contents) {
+CacheItem::CacheItem(std::shared_ptr<Image> _contents) : mLastAccess(0) {
     contents = _contents;
     sem = new QSemaphore(1);
 }
@@ -28,3 +28,11 @@ void CacheItem::unlock() {
 int CacheItem::lockStatus() {
     return sem->available();
 }
+
+quint64 CacheItem::lastAccess() const {
+    return mLastAccess;
+}
+
+void CacheItem::setLastAccess(quint64 time) {
+    mLastAccess = time;
+}
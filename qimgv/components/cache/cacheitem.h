@@ -15,8 +15,12 @@ public:
     void unlock();
 
     int lockStatus();
+
+    quint64 lastAccess() const;
+    void setLastAccess(quint64 time);
 private:
     std::shared_ptr<Image> contents;
     QSemaphore *sem;
+    quint64 mLastAccess;
 };
 
@@ -0,0 +1,135 @@
+#include "qoicodec.h"
+
+bool QoiCodec::supportsFormat(QImage::Format format) {
+    return format == QImage::Format_RGB32 ||
+           format == QImage::Format_ARGB32 ||
+           format == QImage::Format_ARGB32_Premultiplied;
+}
+
+inline int QoiCodec::hash(QRgb px) {
+    return (qRed(px) * 3 + qGreen(px) * 5 + qBlue(px) * 7 + qAlpha(px) * 11) & 63;
+}
+
+QByteArray QoiCodec::encode(const QImage &image) {
+    if(image.isNull() || !supportsFormat(image.format()))
+        return QByteArray();
+    const int width = image.width();
+    const int height = image.height();
+    // worst case is OP_RGBA for every pixel
+    QByteArray data;
+    data.resize(width * height * 5);
+    uchar *out = reinterpret_cast<uchar*>(data.data());
+    uchar *p = out;
+    QRgb index[64] = {};
+    QRgb prev = qRgba(0, 0, 0, 255);
+    int run = 0;
+    for(int y = 0; y < height; y++) {
+        const QRgb *line = reinterpret_cast<const QRgb*>(image.constScanLine(y));
+        for(int x = 0; x < width; x++) {
+            const QRgb px = line[x];
+            if(px == prev) {
+                if(++run == 62) {
+                    *p++ = OP_RUN | (run - 1);
+                    run = 0;
+                }
+                continue;
+            }
+            if(run) {
+                *p++ = OP_RUN | (run - 1);
+                run = 0;
+            }
+            const int idx = hash(px);
+            if(index[idx] == px) {
+                *p++ = OP_INDEX | idx;
+            } else {
+                index[idx] = px;
+                if(qAlpha(px) == qAlpha(prev)) {
+                    const signed char vr = static_cast<signed char>(qRed(px) - qRed(prev));
+                    const signed char vg = static_cast<signed char>(qGreen(px) - qGreen(prev));
+                    const signed char vb = static_cast<signed char>(qBlue(px) - qBlue(prev));
+                    const signed char vgr = vr - vg;
+                    const signed char vgb = vb - vg;
+                    if(vr > -3 && vr < 2 && vg > -3 && vg < 2 && vb > -3 && vb < 2) {
+                        *p++ = OP_DIFF | (vr + 2) << 4 | (vg + 2) << 2 | (vb + 2);
+                    } else if(vgr > -9 && vgr < 8 && vg > -33 && vg < 32 && vgb > -9 && vgb < 8) {
+                        *p++ = OP_LUMA | (vg + 32);
+                        *p++ = (vgr + 8) << 4 | (vgb + 8);
+                    } else {
+                        *p++ = OP_RGB;
+                        *p++ = qRed(px);
+                        *p++ = qGreen(px);
+                        *p++ = qBlue(px);
+                    }
+                } else {
+                    *p++ = OP_RGBA;
+                    *p++ = qRed(px);
+                    *p++ = qGreen(px);
+                    *p++ = qBlue(px);
+                    *p++ = qAlpha(px);
+                }
+            }
+            prev = px;
+        }
+    }
+    if(run)
+        *p++ = OP_RUN | (run - 1);
+    data.resize(static_cast<int>(p - out));
+    return data;
+}
+
+bool QoiCodec::decode(const QByteArray &data, QImage &image) {
+    if(image.isNull() || !supportsFormat(image.format()))
+        return false;
+    const int width = image.width();
+    const int height = image.height();
+    const uchar *p = reinterpret_cast<const uchar*>(data.constData());
+    const uchar *end = p + data.size();
+    QRgb index[64] = {};
+    QRgb px = qRgba(0, 0, 0, 255);
+    int run = 0;
+    for(int y = 0; y < height; y++) {
+        QRgb *line = reinterpret_cast<QRgb*>(image.scanLine(y));
+        for(int x = 0; x < width; x++) {
+            if(run) {
+                run--;
+                line[x] = px;
+                continue;
+            }
+            if(p >= end)
+                return false;
+            const uchar b1 = *p++;
+            if(b1 == OP_RGB) {
+                if(end - p < 3)
+                    return false;
+                px = qRgba(p[0], p[1], p[2], qAlpha(px));
+                p += 3;
+            } else if(b1 == OP_RGBA) {
+                if(end - p < 4)
+                    return false;
+                px = qRgba(p[0], p[1], p[2], p[3]);
+                p += 4;
+            } else if((b1 & OP_MASK) == OP_INDEX) {
+                px = index[b1];
+            } else if((b1 & OP_MASK) == OP_DIFF) {
+                px = qRgba((qRed(px) + ((b1 >> 4) & 3) - 2) & 0xff,
+                           (qGreen(px) + ((b1 >> 2) & 3) - 2) & 0xff,
+                           (qBlue(px) + (b1 & 3) - 2) & 0xff,
+                           qAlpha(px));
+            } else if((b1 & OP_MASK) == OP_LUMA) {
+                if(p >= end)
+                    return false;
+                const uchar b2 = *p++;
+                const int vg = (b1 & 0x3f) - 32;
+                px = qRgba((qRed(px) + vg - 8 + ((b2 >> 4) & 0x0f)) & 0xff,
+                           (qGreen(px) + vg) & 0xff,
+                           (qBlue(px) + vg - 8 + (b2 & 0x0f)) & 0xff,
+                           qAlpha(px));
+            } else {
+                run = b1 & 0x3f;
+            }
+            index[hash(px)] = px;
+            line[x] = px;
+        }
+    }
+    return p == end;
+}
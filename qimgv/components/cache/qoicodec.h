@@ -0,0 +1,31 @@
+#pragma once
+
+#include <QImage>
+#include <QByteArray>
+
+// Lossless pixel codec based on QOI (https://qoiformat.org).
+// Only the chunk stream is used: no header or end marker, the caller stores
+// the dimensions. Works directly on 32-bit QImage formats (RGB32, ARGB32,
+// ARGB32_Premultiplied) without any conversion; the values are treated as
+// four opaque channels, so whatever goes in comes back out.
+// Several times faster than zlib in both directions at a similar size for
+// thumbnail-sized images.
+class QoiCodec {
+public:
+    static bool supportsFormat(QImage::Format format);
+    static QByteArray encode(const QImage &image);
+    // image must already have the right size and format
+    static bool decode(const QByteArray &data, QImage &image);
+
+private:
+    enum Op : uchar {
+        OP_INDEX = 0x00,
+        OP_DIFF  = 0x40,
+        OP_LUMA  = 0x80,
+        OP_RUN   = 0xc0,
+        OP_RGB   = 0xfe,
+        OP_RGBA  = 0xff,
+        OP_MASK  = 0xc0
+    };
+    static inline int hash(QRgb px);
+};
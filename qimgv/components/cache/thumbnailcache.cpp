@@ -2,37 +2,415 @@
 
 ThumbnailCache::ThumbnailCache() {
     cacheDirPath = settings->thumbnailCacheDir();
+    pack = sharedPack(cacheDirPath + "thumbnails.pack");
+    writer = sharedWriter(pack);
 }
 
-QString ThumbnailCache::thumbnailPath(QString id) {
-    return QString(cacheDirPath + id + ".png");
+// One pack per file, no matter how many thumbnailers there are.
+// When the cache dir changes, caches created from then on get a new one;
+// the old pack stays open until the last of the old caches is gone.
+std::shared_ptr<ThumbnailPack> ThumbnailCache::sharedPack(QString path) {
+    static QMutex mutex;
+    static std::weak_ptr<ThumbnailPack> instance;
+    static QString instancePath;
+    QMutexLocker locker(&mutex);
+    auto shared = instance.lock();
+    if(!shared || instancePath != path) {
+        shared = std::make_shared<ThumbnailPack>(path);
+        instance = shared;
+        instancePath = path;
+    }
+    return shared;
+}
+
+// same for the writer, one per pack
+std::shared_ptr<ThumbnailWriter> ThumbnailCache::sharedWriter(std::shared_ptr<ThumbnailPack> pack) {
+    static QMutex mutex;
+    static std::weak_ptr<ThumbnailWriter> instance;
+    static std::weak_ptr<ThumbnailPack> instancePack;
+    QMutexLocker locker(&mutex);
+    auto shared = instance.lock();
+    if(!shared || instancePack.lock() != pack) {
+        shared = std::make_shared<ThumbnailWriter>(pack);
+        instance = shared;
+        instancePack = pack;
+    }
+    return shared;
 }
 
 bool ThumbnailCache::exists(QString id) {
-    QString filePath = thumbnailPath(id);
-    QFileInfo file(filePath);
-    return file.exists() && file.isReadable();
+    QImage image;
+    return writer->pending(id, image) || pack->contains(ThumbnailPack::keyFor(id));
+}
+
+void ThumbnailCache::removeThumbnail(QString id) {
+    writer->discard(id);
+    if(pack->isWritable())
+        pack->remove(ThumbnailPack::keyFor(id));
 }
 
+// Queued; encoding and writing happen on the writer thread.
+// Blocks if the writer is too far behind.
 void ThumbnailCache::saveThumbnail(QImage *image, QString id) {
-    if(image) {
-        QString filePath = thumbnailPath(id);
-        image->save(filePath, "PNG", 15);
-    }
+    if(image && !image->isNull() && pack->isWritable())
+        writer->enqueue(id, *image);
+}
+
+void ThumbnailCache::flush() {
+    writer->flush();
+}
+
+ThumbnailWriterStats ThumbnailCache::writerStats() {
+    return writer->stats();
 }
 
 QImage *ThumbnailCache::readThumbnail(QString id) {
-    QString filePath = thumbnailPath(id);
-    QFileInfo file(filePath);
-    if(file.exists() && file.isReadable()) {
-        QImage *thumb = new QImage();
-        if(thumb->load(filePath)) {
-            return thumb;
+    QImage pending;
+    if(writer->pending(id, pending))
+        return new QImage(pending);
+    QImage *thumb = nullptr;
+    pack->read(ThumbnailPack::keyFor(id), [&thumb](const QByteArray &data) {
+        thumb = decode(data);
+    });
+    if(!thumb)
+        thumb = readLegacy(id);
+    return thumb;
+}
+
+bool ThumbnailCache::readText(QString id, QMap<QString, QString> &text) {
+    QImage pending;
+    if(writer->pending(id, pending)) {
+        for(auto key : pending.textKeys())
+            text.insert(key, pending.text(key));
+        return true;
+    }
+    bool found = false;
+    pack->read(ThumbnailPack::keyFor(id), [&](const QByteArray &data) {
+        found = decodeText(data, text);
+    });
+    if(!found) {
+        std::unique_ptr<QImage> legacy(readLegacy(id));
+        if(legacy) {
+            for(auto key : legacy->textKeys())
+                text.insert(key, legacy->text(key));
+            found = true;
+        }
+    }
+    return found;
+}
+
+// Png thumbnail from before the pack. The metadata is in its text chunks.
+// Only removed by the process that owns the pack; others just read it.
+QImage *ThumbnailCache::readLegacy(QString id) {
+    QString filePath = cacheDirPath + id + ".png";
+    if(!QFile::exists(filePath))
+        return nullptr;
+    QImage *thumb = new QImage();
+    if(!thumb->load(filePath, "PNG")) {
+        delete thumb;
+        if(pack->isWritable())
+            QFile::remove(filePath);
+        return nullptr;
+    }
+    if(pack->isWritable()) {
+        writer->enqueue(id, *thumb);
+        QFile::remove(filePath);
+    }
+    return thumb;
+}
+
+quint32 ThumbnailCache::migrateLegacy(const std::atomic_bool *cancel) {
+    if(!pack->isWritable())
+        return 0;
+    quint32 migrated = 0;
+    QDir dir(cacheDirPath);
+    for(auto &fileName : dir.entryList(QStringList() << "*.png", QDir::Files)) {
+        if(cancel && *cancel)
+            break;
+        QString id = QFileInfo(fileName).completeBaseName();
+        // md5 ids only; leave anything else alone
+        if(id.length() != 32)
+            continue;
+        std::unique_ptr<QImage> thumb(readLegacy(id));
+        if(thumb)
+            migrated++;
+    }
+    if(migrated)
+        qDebug() << "[ThumbnailCache] migrated" << migrated << "png thumbnails";
+    return migrated;
+}
+
+QList<int> ThumbnailCache::sizeIndex(QString id) {
+    QMap<int, QByteArray> index;
+    pack->read(ThumbnailPack::keyFor(id), [&index](const QByteArray &data) {
+        decodeSizeIndex(data, index);
+    });
+    QList<int> sizes = index.keys();
+    for(auto size : writer->pendingSizes(id)) {
+        if(!sizes.contains(size))
+            sizes.append(size);
+    }
+    std::sort(sizes.begin(), sizes.end());
+    return sizes;
+}
+
+// written by the writer thread along with the thumbnails
+void ThumbnailCache::addToSizeIndex(QString id, int size, QString thumbnailId) {
+    if(!pack->isWritable())
+        return;
+    writer->addToSizeIndex(id, size, ThumbnailPack::keyFor(thumbnailId));
+}
+
+QByteArray ThumbnailCache::encodeSizeIndex(const QMap<int, QByteArray> &sizes) {
+    QMap<qint32, QByteArray> map;
+    for(auto it = sizes.constBegin(); it != sizes.constEnd(); ++it)
+        map.insert(it.key(), it.value());
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << SIZE_INDEX_MAGIC << map;
+    return data;
+}
+
+bool ThumbnailCache::decodeSizeIndex(const QByteArray &data, QMap<int, QByteArray> &sizes) {
+    sizes.clear();
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic;
+    in >> magic;
+    if(in.status() != QDataStream::Ok)
+        return false;
+    if(magic == SIZE_INDEX_MAGIC_V1)
+        return true;
+    if(magic != SIZE_INDEX_MAGIC)
+        return false;
+    QMap<qint32, QByteArray> map;
+    in >> map;
+    if(in.status() != QDataStream::Ok)
+        return false;
+    for(auto it = map.constBegin(); it != map.constEnd(); ++it)
+        sizes.insert(it.key(), it.value());
+    return true;
+}
+
+ThumbnailPackStats ThumbnailCache::stats() {
+    return pack->stats();
+}
+
+ThumbnailCacheStats ThumbnailCache::collectGarbage(qint64 maxBytes, int maxAgeDays, bool dryRun, const std::atomic_bool *cancel) {
+    struct Entry {
+        QByteArray key;
+        qint64 size;
+        quint32 lastUsed;
+        QString sourcePath;
+        QString lastModified;
+    };
+    struct IndexEntry {
+        QByteArray key;
+        qint64 size;
+        QMap<int, QByteArray> sizes;
+    };
+    ThumbnailCacheStats result;
+    if(!dryRun)
+        result.migrated = migrateLegacy(cancel);
+    writer->flush();
+    ThumbnailPackStats before = pack->stats();
+    pack->flushAccessTimes();
+    QList<Entry> entries;
+    QList<IndexEntry> indexes;
+    pack->forEach([&entries, &indexes](const QByteArray &key, const QByteArray &data, quint32 lastUsed) {
+        IndexEntry index { QByteArray(key.constData(), key.size()), data.size(), {} };
+        if(decodeSizeIndex(data, index.sizes)) {
+            indexes.append(index);
+            return;
+        }
+        QMap<QString, QString> text;
+        Entry entry { QByteArray(key.constData(), key.size()), data.size(), lastUsed, "", "" };
+        // Entries keyed by file identity outlive the original path. Leave them to the lru.
+        if(decodeText(data, text) && !text.contains("keyMode")) {
+            entry.sourcePath = text.value("sourcePath");
+            entry.lastModified = text.value("lastModified");
+        }
+        entries.append(entry);
+    });
+
+    QList<QByteArray> toRemove;
+    QList<Entry> kept;
+    qint64 keptBytes = 0;
+    qint64 minTime = maxAgeDays ? QDateTime::currentMSecsSinceEpoch() / 1000 - maxAgeDays * 86400LL : 0;
+    for(auto &entry : entries) {
+        if(cancel && *cancel)
+            return result;
+        bool orphan = false;
+        if(!entry.sourcePath.isEmpty()) {
+            QFileInfo fi(entry.sourcePath);
+            orphan = !fi.exists() || QString::number(fi.lastModified().toMSecsSinceEpoch()) != entry.lastModified;
+        }
+        if(orphan)
+            result.orphans++;
+        if(orphan || entry.lastUsed < minTime) {
+            toRemove.append(entry.key);
         } else {
-            delete thumb;
-            return nullptr;
+            kept.append(entry);
+            keptBytes += entry.size;
+        }
+    }
+    // over the limit: go down to 90% so that this doesn't run on every new thumbnail
+    if(maxBytes && keptBytes > maxBytes) {
+        std::sort(kept.begin(), kept.end(), [](const Entry &a, const Entry &b) {
+            return a.lastUsed < b.lastUsed;
+        });
+        for(int i = 0; i < kept.count() && keptBytes > maxBytes * 9 / 10; i++) {
+            toRemove.append(kept.at(i).key);
+            keptBytes -= kept.at(i).size;
+        }
+    }
+    // Size indexes have no source path of their own. Drop the sizes whose
+    // thumbnails are gone, and the whole index when none are left.
+    // A size added by the writer meanwhile may get dropped too; that only
+    // costs a regular cache miss later.
+    QSet<QByteArray> removedKeys;
+    for(auto &key : toRemove)
+        removedKeys.insert(key);
+    QSet<QByteArray> liveKeys;
+    for(auto &entry : entries) {
+        if(!removedKeys.contains(entry.key))
+            liveKeys.insert(entry.key);
+    }
+    QList<QPair<QByteArray, QByteArray>> rewrite;
+    for(auto &index : indexes) {
+        QMap<int, QByteArray> remaining;
+        for(auto it = index.sizes.constBegin(); it != index.sizes.constEnd(); ++it) {
+            if(liveKeys.contains(it.value()))
+                remaining.insert(it.key(), it.value());
         }
+        if(remaining.isEmpty()) {
+            toRemove.append(index.key);
+        } else {
+            keptBytes += index.size;
+            if(remaining.count() != index.sizes.count())
+                rewrite.append(qMakePair(index.key, encodeSizeIndex(remaining)));
+        }
+    }
+    result.entries = static_cast<quint32>(entries.count() + indexes.count() - toRemove.count());
+    result.bytes = keptBytes;
+    result.fileSize = before.fileSize;
+    if(dryRun || (toRemove.isEmpty() && rewrite.isEmpty())) {
+        if(dryRun) {
+            result.entries = before.entries;
+            result.bytes = before.dataBytes;
+        }
+        return result;
+    }
+    for(auto &key : toRemove) {
+        if(pack->remove(key))
+            result.removed++;
+    }
+    pack->writeBatch(rewrite);
+    pack->compact();
+    ThumbnailPackStats after = pack->stats();
+    result.entries = after.entries;
+    result.fileSize = after.fileSize;
+    result.freedBytes = before.fileSize - after.fileSize;
+    qDebug() << "[ThumbnailCache] removed" << result.removed << "thumbnails," << result.freedBytes / 1024 << "KB freed";
+    return result;
+}
+
+QByteArray ThumbnailCache::encode(const QImage &image) {
+    QImage img = image;
+    switch(img.format()) {
+        case QImage::Format_RGB32:
+        case QImage::Format_ARGB32:
+        case QImage::Format_ARGB32_Premultiplied:
+        case QImage::Format_RGB888:
+        case QImage::Format_Grayscale8:
+            break;
+        default:
+            img = img.convertToFormat(img.hasAlphaChannel() ? QImage::Format_ARGB32 : QImage::Format_RGB32);
+    }
+    // 32bpp is what the thumbnailer produces; qoi is a lot cheaper than zlib
+    PayloadCodec codec = CODEC_RAW;
+    QByteArray pixels;
+    if(QoiCodec::supportsFormat(img.format())) {
+        pixels = QoiCodec::encode(img);
+        codec = CODEC_QOI;
     } else {
+        // rows without padding
+        int lineBytes = img.width() * img.depth() / 8;
+        pixels.resize(lineBytes * img.height());
+        for(int y = 0; y < img.height(); y++)
+            memcpy(pixels.data() + y * lineBytes, img.constScanLine(y), lineBytes);
+        // fastest zlib level; keep it raw when that does not help much
+        QByteArray compressed = qCompress(pixels, 1);
+        if(compressed.size() < pixels.size() * 9 / 10) {
+            pixels = compressed;
+            codec = CODEC_DEFLATE;
+        }
+    }
+    QMap<QString, QString> text;
+    for(auto key : img.textKeys())
+        text.insert(key, img.text(key));
+
+    QByteArray data;
+    QDataStream out(&data, QIODevice::WriteOnly);
+    out.setVersion(QDataStream::Qt_5_12);
+    out << PAYLOAD_MAGIC << static_cast<quint8>(codec)
+        << static_cast<qint32>(img.width()) << static_cast<qint32>(img.height())
+        << static_cast<qint32>(img.format()) << text;
+    out.writeRawData(pixels.constData(), pixels.size());
+    return data;
+}
+
+bool ThumbnailCache::decodeText(const QByteArray &data, QMap<QString, QString> &text) {
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic;
+    quint8 codec;
+    qint32 width, height, format;
+    in >> magic >> codec >> width >> height >> format >> text;
+    return in.status() == QDataStream::Ok && magic == PAYLOAD_MAGIC;
+}
+
+QImage *ThumbnailCache::decode(const QByteArray &data) {
+    QDataStream in(data);
+    in.setVersion(QDataStream::Qt_5_12);
+    quint32 magic;
+    quint8 codec;
+    qint32 width, height, format;
+    QMap<QString, QString> text;
+    in >> magic >> codec >> width >> height >> format >> text;
+    if(in.status() != QDataStream::Ok || magic != PAYLOAD_MAGIC || width <= 0 || height <= 0)
         return nullptr;
+    QImage::Format fmt = static_cast<QImage::Format>(format);
+    if(fmt != QImage::Format_RGB32 && fmt != QImage::Format_ARGB32 && fmt != QImage::Format_ARGB32_Premultiplied &&
+       fmt != QImage::Format_RGB888 && fmt != QImage::Format_Grayscale8)
+    {
+        return nullptr;
+    }
+    qint64 pos = in.device()->pos();
+    QByteArray pixels = QByteArray::fromRawData(data.constData() + pos, static_cast<int>(data.size() - pos));
+    QImage *image = new QImage(width, height, fmt);
+    if(image->isNull()) {
+        delete image;
+        return nullptr;
+    }
+    if(codec == CODEC_QOI) {
+        if(!QoiCodec::decode(pixels, *image)) {
+            delete image;
+            return nullptr;
+        }
+    } else {
+        if(codec == CODEC_DEFLATE)
+            pixels = qUncompress(pixels);
+        int lineBytes = width * image->depth() / 8;
+        if(codec > CODEC_DEFLATE || pixels.size() != static_cast<qint64>(lineBytes) * height) {
+            delete image;
+            return nullptr;
+        }
+        for(int y = 0; y < height; y++)
+            memcpy(image->scanLine(y), pixels.constData() + y * lineBytes, lineBytes);
     }
+    for(auto key : text.keys())
+        image->setText(key, text.value(key));
+    return image;
 }
@@ -4,9 +4,33 @@
 #include <QDir>
 #include <QMutex>
 #include <QDebug>
+#include <QDataStream>
+#include <QFileInfo>
+#include <QSet>
+#include <atomic>
+#include <algorithm>
+#include <memory>
 #include "settings.h"
 #include "sourcecontainers/thumbnail.h"
+#include "components/cache/thumbnailpack.h"
+#include "components/cache/thumbnailwriter.h"
+#include "components/cache/qoicodec.h"
 
+struct ThumbnailCacheStats {
+    quint32 entries = 0;
+    qint64 bytes = 0;      // thumbnail data
+    qint64 fileSize = 0;   // pack file on disk
+    quint32 orphans = 0;   // source file is gone or was modified since
+    quint32 removed = 0;
+    qint64 freedBytes = 0;
+    quint32 migrated = 0;  // old <id>.png files moved into the pack
+};
+
+// Disk cache for thumbnails. Everything lives in a single pack file
+// shared by all instances within the process (see ThumbnailPack).
+// Writes go through a shared background ThumbnailWriter.
+// Thumbnails from older versions (<id>.png files in the cache dir) are moved
+// into the pack when they are read, or all at once by collectGarbage().
 class ThumbnailCache : public QObject
 {
     Q_OBJECT
@@ -15,15 +39,57 @@ public:
 
     void saveThumbnail(QImage *image, QString id);
     QImage* readThumbnail(QString id);
-    QString thumbnailPath(QString id);
+    // only QImage::text() of a cached thumbnail; skips decoding the pixels
+    bool readText(QString id, QMap<QString, QString> &text);
     bool exists(QString id);
+    void removeThumbnail(QString id);
+    // Thumbnail sizes cached for one file (under whatever id the caller picks).
+    // Used to find a larger thumbnail to scale down instead of decoding the file.
+    // Each size remembers the id of its thumbnail, so that collectGarbage() can
+    // drop sizes whose thumbnails are gone.
+    QList<int> sizeIndex(QString id);
+    void addToSizeIndex(QString id, int size, QString thumbnailId);
+    ThumbnailPackStats stats();
+    // waits until all saved thumbnails are in the pack
+    void flush();
+    ThumbnailWriterStats writerStats();
+    // Drops thumbnails of missing / modified files, entries not used for maxAgeDays
+    // and then least recently used ones until the cache fits into maxBytes.
+    // 0 disables the corresponding limit. With dryRun only counts.
+    // Also migrates any remaining old png thumbnails (unless dryRun).
+    // Stats the source files, so it is slow; don't call from the gui thread.
+    ThumbnailCacheStats collectGarbage(qint64 maxBytes, int maxAgeDays, bool dryRun, const std::atomic_bool *cancel = nullptr);
+
+    // pixels + QImage::text() in a form that is quick to read back
+    static QByteArray encode(const QImage &image);
+    static QImage *decode(const QByteArray &data);
+    // size index payload: size -> pack key of the thumbnail
+    static QByteArray encodeSizeIndex(const QMap<int, QByteArray> &sizes);
+    // false if it is not a size index
+    static bool decodeSizeIndex(const QByteArray &data, QMap<int, QByteArray> &sizes);
 
 signals:
 
 public slots:
 
 private:
-    // we are still bottlenecked by disk access anyway
-    QMutex mutex;
     QString cacheDirPath;
+    std::shared_ptr<ThumbnailPack> pack;
+    std::shared_ptr<ThumbnailWriter> writer;
+    static std::shared_ptr<ThumbnailPack> sharedPack(QString path);
+    static std::shared_ptr<ThumbnailWriter> sharedWriter(std::shared_ptr<ThumbnailPack> pack);
+    // only QImage::text() part of the payload
+    static bool decodeText(const QByteArray &data, QMap<QString, QString> &text);
+    QImage *readLegacy(QString id);
+    quint32 migrateLegacy(const std::atomic_bool *cancel);
+
+    enum PayloadCodec : quint8 {
+        CODEC_RAW = 0,
+        CODEC_DEFLATE = 1,
+        CODEC_QOI = 2
+    };
+    static const quint32 PAYLOAD_MAGIC = 0x5448424d; // "THBM"
+    static const quint32 SIZE_INDEX_MAGIC = 0x54485332; // "THS2"
+    // sizes only; nothing to check them against, so these read as empty
+    static const quint32 SIZE_INDEX_MAGIC_V1 = 0x54485349; // "THSI"
 };
@@ -0,0 +1,66 @@
+#include "thumbnailmemorycache.h"
+
+ThumbnailMemoryCache::ThumbnailMemoryCache(qint64 _memoryLimit) : memoryLimit(_memoryLimit), usage(0) {
+}
+
+ThumbnailMemoryCache *ThumbnailMemoryCache::getInstance() {
+    static ThumbnailMemoryCache instance(MEMORY_LIMIT);
+    return &instance;
+}
+
+QString ThumbnailMemoryCache::keyFor(const QString &path, int size, bool crop) {
+    return path + "\n" + QString::number(size) + (crop ? "s" : "");
+}
+
+std::shared_ptr<Thumbnail> ThumbnailMemoryCache::find(const QString &path, int size, bool crop, qint64 modifyTime) {
+    auto found = index.find(keyFor(path, size, crop));
+    if(found == index.end())
+        return nullptr;
+    auto it = found.value();
+    // file was changed since
+    if(it->modifyTime != modifyTime) {
+        remove(it);
+        return nullptr;
+    }
+    entries.splice(entries.begin(), entries, it);
+    return it->thumbnail;
+}
+
+void ThumbnailMemoryCache::insert(const QString &path, int size, bool crop, qint64 modifyTime, std::shared_ptr<Thumbnail> thumbnail) {
+    // failed ones are not worth keeping
+    if(!thumbnail || !thumbnail->pixmap() || thumbnail->pixmap()->isNull())
+        return;
+    auto pixmap = thumbnail->pixmap();
+    qint64 bytes = static_cast<qint64>(pixmap->width()) * pixmap->height() * pixmap->depth() / 8;
+    if(bytes > memoryLimit)
+        return;
+    QString key = keyFor(path, size, crop);
+    auto found = index.find(key);
+    if(found != index.end())
+        remove(found.value());
+    while(!entries.empty() && usage + bytes > memoryLimit)
+        remove(std::prev(entries.end()));
+    entries.push_front({ key, modifyTime, thumbnail, bytes });
+    index.insert(key, entries.begin());
+    usage += bytes;
+}
+
+void ThumbnailMemoryCache::clear() {
+    entries.clear();
+    index.clear();
+    usage = 0;
+}
+
+qint64 ThumbnailMemoryCache::memoryUsage() const {
+    return usage;
+}
+
+int ThumbnailMemoryCache::count() const {
+    return index.count();
+}
+
+void ThumbnailMemoryCache::remove(std::list<Entry>::iterator it) {
+    usage -= it->bytes;
+    index.remove(it->key);
+    entries.erase(it);
+}
@@ -0,0 +1,40 @@
+#pragma once
+
+#include <QString>
+#include <QHash>
+#include <list>
+#include <iterator>
+#include <memory>
+#include "sourcecontainers/thumbnail.h"
+
+// Thumbnails recently shown by any of the directory views, so that switching
+// between the panel and the folder view or scrolling back does not go through
+// the thumbnailer again. Keyed by path, size and crop; an entry is only valid
+// for the file modification time it was made for.
+// Least recently used ones are dropped first.
+// GUI thread only.
+class ThumbnailMemoryCache {
+public:
+    static ThumbnailMemoryCache *getInstance();
+    std::shared_ptr<Thumbnail> find(const QString &path, int size, bool crop, qint64 modifyTime);
+    void insert(const QString &path, int size, bool crop, qint64 modifyTime, std::shared_ptr<Thumbnail> thumbnail);
+    void clear();
+    qint64 memoryUsage() const;
+    int count() const;
+
+private:
+    explicit ThumbnailMemoryCache(qint64 _memoryLimit);
+    struct Entry {
+        QString key;
+        qint64 modifyTime;
+        std::shared_ptr<Thumbnail> thumbnail;
+        qint64 bytes;
+    };
+    std::list<Entry> entries; // most recently used first
+    QHash<QString, std::list<Entry>::iterator> index;
+    qint64 memoryLimit, usage;
+    static QString keyFor(const QString &path, int size, bool crop);
+    void remove(std::list<Entry>::iterator it);
+
+    static const qint64 MEMORY_LIMIT = 128 * 1024 * 1024;
+};
@@ -0,0 +1,612 @@
+#include "thumbnailpack.h"
+
+#include <QSaveFile>
+#include <cstring>
+#include <vector>
+
+namespace {
+const char PACK_MAGIC[8] = { 'Q', 'I', 'M', 'G', 'V', 'T', 'P', 'K' };
+}
+
+ThumbnailPack::ThumbnailPack(QString _path)
+    : path(_path),
+      map(nullptr),
+      mapSize(0),
+      writable(false),
+      changes(0)
+{
+    static_assert(sizeof(Header) == 64, "unexpected ThumbnailPack::Header size");
+    static_assert(sizeof(Slot) == 40, "unexpected ThumbnailPack::Slot size");
+    static_assert(sizeof(RecordHeader) == 24, "unexpected ThumbnailPack::RecordHeader size");
+    QWriteLocker locker(&rwLock);
+    open();
+}
+
+ThumbnailPack::~ThumbnailPack() {
+    QWriteLocker locker(&rwLock);
+    close();
+}
+
+QByteArray ThumbnailPack::keyFor(const QString &id) {
+    return QCryptographicHash::hash(id.toUtf8(), QCryptographicHash::Md5);
+}
+
+bool ThumbnailPack::open() {
+    lockFile.reset(new QLockFile(path + ".lock"));
+    lockFile->setStaleLockTime(0);
+    writable = lockFile->tryLock(0);
+    if(!writable)
+        lockFile.reset();
+    file.setFileName(path);
+    if(writable) {
+        if(!file.open(QIODevice::ReadWrite)) {
+            qDebug() << "[ThumbnailPack] could not open" << path;
+            close();
+            return false;
+        }
+        if(file.size() < static_cast<qint64>(sizeof(Header)) || !remap(file.size()) || !valid()) {
+            if(file.size())
+                qDebug() << "[ThumbnailPack] invalid or outdated pack, recreating" << path;
+            if(!initialize()) {
+                close();
+                return false;
+            }
+        }
+        // left over from a compaction that didn't finish
+        header()->replaced = 0;
+    } else {
+        if(!file.open(QIODevice::ReadOnly) || !remap(file.size()) || !valid()) {
+            close();
+            return false;
+        }
+        qDebug() << "[ThumbnailPack] in use by another instance, opened read-only";
+    }
+    return true;
+}
+
+void ThumbnailPack::close() {
+    if(map && writable && valid())
+        flushTouched();
+    if(map)
+        file.unmap(map);
+    map = nullptr;
+    mapSize = 0;
+    file.close();
+    lockFile.reset();
+    writable = false;
+}
+
+// Writes an empty pack next to the old one and renames it over.
+// Other processes may still have the old file mapped (read-only instances,
+// --gen-thumbs); truncating it in place would crash them on the next read.
+// If the old one was usable it gets flagged, so that they switch to the new one.
+bool ThumbnailPack::initialize() {
+    if(!writable)
+        return false;
+    quint64 indexBytes = static_cast<quint64>(INITIAL_CAPACITY) * sizeof(Slot);
+    qint64 size = sizeof(Header) + indexBytes + GROW_STEP;
+    Header h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, PACK_MAGIC, sizeof(PACK_MAGIC));
+    h.version = VERSION;
+    h.capacity = INITIAL_CAPACITY;
+    h.indexOffset = sizeof(Header);
+    h.dataEnd = sizeof(Header) + indexBytes;
+
+    QSaveFile out(path);
+    if(!out.open(QIODevice::WriteOnly))
+        return false;
+    out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+    out.write(QByteArray(static_cast<int>(indexBytes), 0));
+    if(valid())
+        header()->replaced = 1;
+    // the old file can't be replaced while it is mapped on some platforms
+    if(map)
+        file.unmap(map);
+    map = nullptr;
+    mapSize = 0;
+    file.close();
+    bool committed = out.commit();
+    if(!committed)
+        qDebug() << "[ThumbnailPack] could not replace" << path << out.errorString();
+    if(!file.open(QIODevice::ReadWrite) || !file.resize(size) || !remap(size) || !valid())
+        return false;
+    if(!committed)
+        header()->replaced = 0;
+    return true;
+}
+
+bool ThumbnailPack::remap(qint64 size) {
+    if(map)
+        file.unmap(map);
+    map = nullptr;
+    mapSize = 0;
+    if(size <= 0)
+        return false;
+    map = file.map(0, size);
+    if(!map) {
+        qDebug() << "[ThumbnailPack] mmap failed:" << file.errorString();
+        return false;
+    }
+    mapSize = size;
+    return true;
+}
+
+// makes sure there are this many bytes mapped after dataEnd
+bool ThumbnailPack::reserve(qint64 bytes) {
+    qint64 dataEnd = static_cast<qint64>(header()->dataEnd);
+    if(dataEnd + bytes <= mapSize)
+        return true;
+    qint64 newSize = dataEnd + bytes + qMax(GROW_STEP, mapSize / 4);
+    // can't resize a mapped file on some platforms
+    file.unmap(map);
+    map = nullptr;
+    if(!file.resize(newSize)) {
+        qDebug() << "[ThumbnailPack] could not grow the pack:" << file.errorString();
+        remap(file.size());
+        return false;
+    }
+    return remap(newSize);
+}
+
+bool ThumbnailPack::valid() const {
+    Header h;
+    return loadHeader(h);
+}
+
+// Copies the header and checks it against our own mapping.
+// In a read-only instance the writer process changes the header at any time,
+// so readers work with the copy and check everything they follow against
+// mapSize, never against the live header.
+bool ThumbnailPack::loadHeader(Header &h) const {
+    if(!map || mapSize < static_cast<qint64>(sizeof(Header)))
+        return false;
+    memcpy(&h, map, sizeof(h));
+    const quint64 size = static_cast<quint64>(mapSize);
+    return memcmp(h.magic, PACK_MAGIC, sizeof(PACK_MAGIC)) == 0 &&
+           h.version == VERSION &&
+           h.capacity > 0 &&
+           h.indexOffset >= sizeof(Header) &&
+           h.dataEnd <= size &&
+           h.indexOffset <= h.dataEnd &&
+           static_cast<quint64>(h.capacity) * sizeof(Slot) <= h.dataEnd - h.indexOffset;
+}
+
+// expects the write lock to be held
+// Read-only instances: catches up with the writer, which may have grown the
+// file past our mapping or replaced it with a new one (compact(), initialize()).
+bool ThumbnailPack::refresh() {
+    if(writable)
+        return false;
+    if(!map) {
+        // outdated or missing pack; wait for the writer to recreate it
+        if(reopenTimer.isValid() && reopenTimer.elapsed() < REOPEN_INTERVAL)
+            return false;
+        reopenTimer.start();
+        return open();
+    }
+    Header h;
+    memcpy(&h, map, qMin(static_cast<qint64>(sizeof(h)), mapSize));
+    if(mapSize >= static_cast<qint64>(sizeof(h)) && h.replaced) {
+        close();
+        return open();
+    }
+    return remap(file.size());
+}
+
+ThumbnailPack::Header *ThumbnailPack::header() const {
+    return reinterpret_cast<Header*>(map);
+}
+
+ThumbnailPack::Slot *ThumbnailPack::slotTable() const {
+    return reinterpret_cast<Slot*>(map + header()->indexOffset);
+}
+
+ThumbnailPack::Slot *ThumbnailPack::slotTable(const Header &h) const {
+    return reinterpret_cast<Slot*>(map + h.indexOffset);
+}
+
+quint32 ThumbnailPack::now() {
+    return static_cast<quint32>(QDateTime::currentMSecsSinceEpoch() / 1000);
+}
+
+quint64 ThumbnailPack::recordSize(quint32 length) {
+    // keep everything 8 byte aligned
+    return (sizeof(RecordHeader) + length + 7) & ~static_cast<quint64>(7);
+}
+
+// h must come from loadHeader()
+ThumbnailPack::Slot *ThumbnailPack::findSlot(const Header &h, const QByteArray &key) const {
+    Slot *s = slotTable(h);
+    quint64 hash;
+    memcpy(&hash, key.constData(), sizeof(hash));
+    quint32 i = hash % h.capacity;
+    for(quint32 n = 0; n < h.capacity; n++) {
+        Slot *slot = s + i;
+        if(slot->state == SLOT_EMPTY)
+            return nullptr;
+        if(slot->state == SLOT_USED && memcmp(slot->key, key.constData(), sizeof(slot->key)) == 0)
+            return slot;
+        i = (i + 1) % h.capacity;
+    }
+    return nullptr;
+}
+
+// Appends a new index and moves all entries there. Old one becomes garbage.
+bool ThumbnailPack::growIndex(quint32 capacity) {
+    quint64 indexBytes = static_cast<quint64>(capacity) * sizeof(Slot);
+    if(!reserve(indexBytes))
+        return false;
+    Header *h = header();
+    Slot *oldSlots = slotTable();
+    Slot *newSlots = reinterpret_cast<Slot*>(map + h->dataEnd);
+    memset(newSlots, 0, indexBytes);
+    for(quint32 n = 0; n < h->capacity; n++) {
+        if(oldSlots[n].state != SLOT_USED)
+            continue;
+        quint64 hash;
+        memcpy(&hash, oldSlots[n].key, sizeof(hash));
+        quint32 i = hash % capacity;
+        while(newSlots[i].state != SLOT_EMPTY)
+            i = (i + 1) % capacity;
+        newSlots[i] = oldSlots[n];
+    }
+    h->wastedBytes += static_cast<quint64>(h->capacity) * sizeof(Slot);
+    h->indexOffset = h->dataEnd;
+    h->capacity = capacity;
+    h->tombstones = 0;
+    h->dataEnd += indexBytes;
+    return true;
+}
+
+// Payload of the record the slot points to; nullptr if it doesn't look right
+// or lies outside of our mapping. Pass a copy of the slot, the writer may be
+// changing the original.
+const uchar *ThumbnailPack::recordData(const Slot &slot) const {
+    if(!inMapping(slot))
+        return nullptr;
+    const uchar *record = map + slot.offset;
+    auto rh = reinterpret_cast<const RecordHeader*>(record);
+    if(rh->magic != RECORD_MAGIC || rh->length != slot.length || memcmp(rh->key, slot.key, sizeof(rh->key)))
+        return nullptr;
+    return record + sizeof(RecordHeader);
+}
+
+bool ThumbnailPack::inMapping(const Slot &slot) const {
+    const quint64 size = static_cast<quint64>(mapSize);
+    return slot.offset >= sizeof(Header) &&
+           slot.offset <= size &&
+           recordSize(slot.length) <= size - slot.offset;
+}
+
+// expects the write lock to be held
+void ThumbnailPack::flushTouched() {
+    QMutexLocker touchLocker(&touchMutex);
+    if(touched.isEmpty())
+        return;
+    Header h;
+    if(!loadHeader(h))
+        return;
+    quint32 time = now();
+    for(auto key : touched) {
+        Slot *slot = findSlot(h, key);
+        if(slot)
+            slot->lastUsed = time;
+    }
+    touched.clear();
+    changes++;
+}
+
+bool ThumbnailPack::isOpen() {
+    QReadLocker locker(&rwLock);
+    return map != nullptr;
+}
+
+bool ThumbnailPack::isWritable() {
+    QReadLocker locker(&rwLock);
+    return map && writable;
+}
+
+bool ThumbnailPack::contains(const QByteArray &key) {
+    return read(key, [](const QByteArray&) {});
+}
+
+bool ThumbnailPack::read(const QByteArray &key, const std::function<void(const QByteArray&)> &func) {
+    if(key.size() != 16)
+        return false;
+    for(int attempt = 0; attempt < 2; attempt++) {
+        {
+            QReadLocker locker(&rwLock);
+            Header h;
+            if(map && loadHeader(h) && !h.replaced) {
+                Slot *found = findSlot(h, key);
+                if(!found)
+                    return false;
+                const Slot slot = *found;
+                const uchar *data = recordData(slot);
+                if(data) {
+                    func(QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(slot.length)));
+                    if(writable) {
+                        QMutexLocker touchLocker(&touchMutex);
+                        touched.insert(key);
+                    }
+                    return true;
+                }
+                // a broken record, unless it was written past our mapping
+                if(writable || inMapping(slot))
+                    return false;
+            }
+        }
+        // Read-only instance: the writer has appended past our mapping,
+        // or replaced the file
+        QWriteLocker locker(&rwLock);
+        if(!refresh())
+            return false;
+    }
+    return false;
+}
+
+bool ThumbnailPack::write(const QByteArray &key, const QByteArray &data) {
+    QWriteLocker locker(&rwLock);
+    if(!map || !writable || !valid())
+        return false;
+    flushTouched();
+    return writeLocked(key, data);
+}
+
+int ThumbnailPack::writeBatch(const QList<QPair<QByteArray, QByteArray>> &entries) {
+    QWriteLocker locker(&rwLock);
+    if(!map || !writable || !valid())
+        return 0;
+    flushTouched();
+    int count = 0;
+    for(auto &entry : entries) {
+        if(writeLocked(entry.first, entry.second))
+            count++;
+    }
+    return count;
+}
+
+// expects the write lock to be held
+bool ThumbnailPack::writeLocked(const QByteArray &key, const QByteArray &data) {
+    if(key.size() != 16 || data.isEmpty())
+        return false;
+    changes++;
+    Header *h = header();
+    // keep the load factor under 0.7
+    if((static_cast<quint64>(h->count) + h->tombstones + 1) * 10 > static_cast<quint64>(h->capacity) * 7) {
+        // mostly removed entries: same size, just drop the tombstones
+        quint32 capacity = h->capacity;
+        if((static_cast<quint64>(h->count) + 1) * 10 > static_cast<quint64>(h->capacity) * 5)
+            capacity *= 2;
+        if(!growIndex(capacity))
+            return false;
+    }
+    quint32 length = static_cast<quint32>(data.size());
+    quint64 size = recordSize(length);
+    if(!reserve(size))
+        return false;
+    h = header();
+    quint64 offset = h->dataEnd;
+    RecordHeader rh;
+    rh.magic = RECORD_MAGIC;
+    rh.length = length;
+    memcpy(rh.key, key.constData(), sizeof(rh.key));
+    memcpy(map + offset, &rh, sizeof(rh));
+    memcpy(map + offset + sizeof(rh), data.constData(), length);
+    memset(map + offset + sizeof(rh) + length, 0, size - sizeof(rh) - length);
+    h->dataEnd += size;
+
+    // replace the existing entry, or take the first free slot
+    Slot *s = slotTable();
+    Slot *target = nullptr;
+    quint64 hash;
+    memcpy(&hash, key.constData(), sizeof(hash));
+    quint32 i = hash % h->capacity;
+    for(quint32 n = 0; n < h->capacity; n++) {
+        Slot *slot = s + i;
+        if(slot->state == SLOT_EMPTY) {
+            if(!target)
+                target = slot;
+            break;
+        }
+        if(slot->state == SLOT_REMOVED) {
+            if(!target)
+                target = slot;
+        } else if(memcmp(slot->key, key.constData(), sizeof(slot->key)) == 0) {
+            h->wastedBytes += recordSize(slot->length);
+            slot->offset = offset;
+            slot->length = length;
+            slot->lastUsed = now();
+            return true;
+        }
+        i = (i + 1) % h->capacity;
+    }
+    if(!target)
+        return false;
+    if(target->state == SLOT_REMOVED)
+        h->tombstones--;
+    memcpy(target->key, key.constData(), sizeof(target->key));
+    target->offset = offset;
+    target->length = length;
+    target->state = SLOT_USED;
+    target->lastUsed = now();
+    h->count++;
+    return true;
+}
+
+bool ThumbnailPack::remove(const QByteArray &key) {
+    if(key.size() != 16)
+        return false;
+    QWriteLocker locker(&rwLock);
+    Header current;
+    if(!map || !writable || !loadHeader(current))
+        return false;
+    Slot *slot = findSlot(current, key);
+    if(!slot)
+        return false;
+    Header *h = header();
+    h->wastedBytes += recordSize(slot->length);
+    slot->state = SLOT_REMOVED;
+    h->count--;
+    h->tombstones++;
+    changes++;
+    return true;
+}
+
+void ThumbnailPack::forEach(const std::function<void(const QByteArray&, const QByteArray&, quint32)> &func) {
+    QReadLocker locker(&rwLock);
+    Header h;
+    if(!loadHeader(h))
+        return;
+    const Slot *s = slotTable(h);
+    for(quint32 n = 0; n < h.capacity; n++) {
+        const Slot slot = s[n];
+        if(slot.state != SLOT_USED)
+            continue;
+        const uchar *data = recordData(slot);
+        if(!data)
+            continue;
+        func(QByteArray::fromRawData(reinterpret_cast<const char*>(slot.key), sizeof(slot.key)),
+             QByteArray::fromRawData(reinterpret_cast<const char*>(data), static_cast<int>(slot.length)),
+             slot.lastUsed);
+    }
+}
+
+void ThumbnailPack::flushAccessTimes() {
+    QWriteLocker locker(&rwLock);
+    if(map && writable && valid())
+        flushTouched();
+}
+
+// Writes live records into a new file which then replaces the old one.
+// The copy is made under the read lock, so lookups go on meanwhile; only the
+// swap takes the write lock. If the pack got modified in between, the copy is
+// thrown away and made again.
+bool ThumbnailPack::compact() {
+    QMutexLocker compactLocker(&compactMutex);
+    {
+        QWriteLocker locker(&rwLock);
+        if(!map || !writable || !valid())
+            return false;
+        flushTouched();
+    }
+    for(int attempt = 0; attempt < 3; attempt++) {
+        QSaveFile out(path);
+        quint64 revision;
+        qint64 oldSize;
+        {
+            QReadLocker locker(&rwLock);
+            if(!map || !writable || !valid())
+                return false;
+            revision = changes;
+            oldSize = static_cast<qint64>(header()->dataEnd);
+            if(!writeCompacted(out))
+                return false;
+        }
+        QWriteLocker locker(&rwLock);
+        if(!map || !writable)
+            return false;
+        if(changes != revision) {
+            out.cancelWriting();
+            continue;
+        }
+        // read-only instances reopen the path when they see this
+        header()->replaced = 1;
+        // the old file can't be replaced while it is mapped on some platforms
+        file.unmap(map);
+        map = nullptr;
+        mapSize = 0;
+        file.close();
+        bool committed = out.commit();
+        if(!file.open(QIODevice::ReadWrite) || !remap(file.size()) || !valid()) {
+            qDebug() << "[ThumbnailPack] could not reopen after compaction";
+            if(!file.isOpen() || !initialize()) {
+                close();
+                return false;
+            }
+        }
+        if(!committed) {
+            qDebug() << "[ThumbnailPack] compaction failed:" << out.errorString();
+            header()->replaced = 0;
+            return false;
+        }
+        changes++;
+        reserve(GROW_STEP);
+        qDebug() << "[ThumbnailPack] compacted" << oldSize << "->" << header()->dataEnd << "bytes";
+        return true;
+    }
+    qDebug() << "[ThumbnailPack] pack kept changing, compaction skipped";
+    return false;
+}
+
+// expects the read lock to be held
+bool ThumbnailPack::writeCompacted(QSaveFile &out) const {
+    const Header *h = header();
+    const Slot *oldSlots = slotTable();
+    quint32 capacity = INITIAL_CAPACITY;
+    while(static_cast<quint64>(h->count) * 2 > capacity)
+        capacity *= 2;
+
+    Header newHeader = *h;
+    newHeader.capacity = capacity;
+    newHeader.indexOffset = sizeof(Header);
+    newHeader.wastedBytes = 0;
+    newHeader.count = 0;
+    newHeader.tombstones = 0;
+    newHeader.replaced = 0;
+    std::vector<Slot> newSlots(capacity);
+    memset(newSlots.data(), 0, newSlots.size() * sizeof(Slot));
+    quint64 offset = sizeof(Header) + static_cast<quint64>(capacity) * sizeof(Slot);
+    for(quint32 n = 0; n < h->capacity; n++) {
+        if(oldSlots[n].state != SLOT_USED)
+            continue;
+        quint64 hash;
+        memcpy(&hash, oldSlots[n].key, sizeof(hash));
+        quint32 i = hash % capacity;
+        while(newSlots[i].state != SLOT_EMPTY)
+            i = (i + 1) % capacity;
+        newSlots[i] = oldSlots[n];
+        newSlots[i].offset = offset;
+        offset += recordSize(oldSlots[n].length);
+        newHeader.count++;
+    }
+    newHeader.dataEnd = offset;
+
+    if(!out.open(QIODevice::WriteOnly))
+        return false;
+    out.write(reinterpret_cast<const char*>(&newHeader), sizeof(newHeader));
+    out.write(reinterpret_cast<const char*>(newSlots.data()), newSlots.size() * sizeof(Slot));
+    // same order as above
+    for(quint32 n = 0; n < h->capacity; n++) {
+        if(oldSlots[n].state != SLOT_USED)
+            continue;
+        out.write(reinterpret_cast<const char*>(map + oldSlots[n].offset), recordSize(oldSlots[n].length));
+    }
+    return true;
+}
+
+void ThumbnailPack::compactIfNeeded() {
+    {
+        QReadLocker locker(&rwLock);
+        if(!map || !writable || !valid())
+            return;
+        const Header *h = header();
+        if(static_cast<qint64>(h->wastedBytes) < COMPACT_MIN_WASTE || h->wastedBytes * 2 < h->dataEnd)
+            return;
+    }
+    compact();
+}
+
+ThumbnailPackStats ThumbnailPack::stats() {
+    QReadLocker locker(&rwLock);
+    ThumbnailPackStats s;
+    Header h;
+    if(!loadHeader(h))
+        return s;
+    s.entries = h.count;
+    s.fileSize = mapSize;
+    s.dataBytes = static_cast<qint64>(h.dataEnd - h.wastedBytes);
+    s.wastedBytes = static_cast<qint64>(h.wastedBytes);
+    return s;
+}
@@ -0,0 +1,150 @@
+#pragma once
+
+#include <QString>
+#include <QByteArray>
+#include <QFile>
+#include <QLockFile>
+#include <QReadWriteLock>
+#include <QMutex>
+#include <QSet>
+#include <QList>
+#include <QPair>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QCryptographicHash>
+#include <QDebug>
+#include <functional>
+#include <memory>
+
+class QSaveFile;
+
+struct ThumbnailPackStats {
+    quint32 entries = 0;
+    qint64 fileSize = 0;   // on disk, including preallocated space
+    qint64 dataBytes = 0;  // header, index and records that are still in use
+    qint64 wastedBytes = 0; // overwritten / removed records, old indexes
+};
+
+// Single memory-mapped file holding any number of small blobs (encoded thumbnails).
+//
+// Layout: [header][hash index][records...]
+// Records are only ever appended. The index is an open addressing hash table of
+// fixed size slots; when it fills up a twice larger one is appended after the
+// records and the header is pointed to it. Space taken by replaced records and
+// old indexes is reclaimed by compact(), which rewrites the file.
+// The file uses native byte order; it is a cache, not an exchange format.
+// Each slot also remembers when the entry was last read or written (seconds
+// since epoch), so that the least recently used entries can be evicted.
+// Reads only queue the key; times get written out on the next modification.
+//
+// Only one process can write at a time (lock file next to the pack).
+// Other instances open it read-only; they remap when the writer grows the
+// file and reopen the path when it gets replaced by a new one.
+// Thread safe.
+class ThumbnailPack {
+public:
+    explicit ThumbnailPack(QString _path);
+    ~ThumbnailPack();
+
+    // md5 of the id; what is actually stored in the index
+    static QByteArray keyFor(const QString &id);
+
+    bool isOpen();
+    bool isWritable();
+    bool contains(const QByteArray &key);
+    // Calls func with the stored data while the lock is held.
+    // The data is not copied; it points straight into the mapping.
+    bool read(const QByteArray &key, const std::function<void(const QByteArray&)> &func);
+    bool write(const QByteArray &key, const QByteArray &data);
+    // several writes under one lock; returns how many succeeded
+    int writeBatch(const QList<QPair<QByteArray, QByteArray>> &entries);
+    bool remove(const QByteArray &key);
+    // Calls func for every entry (in no particular order) while the lock is held.
+    // Don't call other methods of the pack from func. Like with read(), key and
+    // data point into the mapping; copy them if they need to outlive the call.
+    void forEach(const std::function<void(const QByteArray &key, const QByteArray &data, quint32 lastUsed)> &func);
+    // writes pending access times into the index
+    void flushAccessTimes();
+    // Rewrites the file without the unused space. Reads are not blocked while
+    // it copies; writes are.
+    bool compact();
+    // compact() when more than half of the file is wasted
+    void compactIfNeeded();
+    ThumbnailPackStats stats();
+
+private:
+    struct Header {
+        char magic[8];
+        quint32 version;
+        quint32 capacity;     // index slots
+        quint64 indexOffset;
+        quint64 dataEnd;      // everything after this is preallocated space
+        quint64 wastedBytes;
+        quint32 count;        // used slots
+        quint32 tombstones;   // removed slots
+        quint32 replaced;     // set on the old file when a new one takes its place
+        char reserved[12];
+    };
+    struct Slot {
+        uchar key[16];
+        quint64 offset;       // of the record
+        quint32 length;       // of the payload
+        quint32 state;
+        quint32 lastUsed;
+        quint32 reserved;
+    };
+    struct RecordHeader {
+        quint32 magic;
+        quint32 length;
+        uchar key[16];
+    };
+    enum SlotState : quint32 {
+        SLOT_EMPTY = 0,
+        SLOT_USED = 1,
+        SLOT_REMOVED = 2
+    };
+
+    QString path;
+    QFile file;
+    std::unique_ptr<QLockFile> lockFile;
+    QReadWriteLock rwLock;
+    uchar *map;
+    qint64 mapSize;
+    bool writable;
+    QMutex touchMutex;
+    QSet<QByteArray> touched;
+    QElapsedTimer reopenTimer;
+    QMutex compactMutex;
+    // bumped by every modification; see compact()
+    quint64 changes;
+
+    bool open();
+    void close();
+    bool initialize();
+    bool remap(qint64 size);
+    bool reserve(qint64 bytes);
+    bool refresh();
+    bool valid() const;
+    bool loadHeader(Header &h) const;
+    Header *header() const;
+    Slot *slotTable() const;
+    Slot *slotTable(const Header &h) const;
+    Slot *findSlot(const Header &h, const QByteArray &key) const;
+    bool growIndex(quint32 capacity);
+    bool writeCompacted(QSaveFile &out) const;
+    bool writeLocked(const QByteArray &key, const QByteArray &data);
+    void flushTouched();
+    const uchar *recordData(const Slot &slot) const;
+    bool inMapping(const Slot &slot) const;
+    static quint64 recordSize(quint32 length);
+    static quint32 now();
+
+    static constexpr quint32 VERSION = 2;
+    static constexpr quint32 RECORD_MAGIC = 0x54485052; // "THPR"
+    static constexpr quint32 INITIAL_CAPACITY = 4096;
+    static constexpr qint64 GROW_STEP = 16 * 1024 * 1024;
+    // don't bother compacting small files
+    static constexpr qint64 COMPACT_MIN_WASTE = 32 * 1024 * 1024;
+    // ms between attempts of a read-only instance to open an unusable pack
+    static constexpr qint64 REOPEN_INTERVAL = 1000;
+};
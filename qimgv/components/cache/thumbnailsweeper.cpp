@@ -0,0 +1,49 @@
+#include "thumbnailsweeper.h"
+
+ThumbnailSweeper::ThumbnailSweeper(QObject *parent) : QObject(parent), cancelFlag(false) {
+    pool.setMaxThreadCount(1);
+}
+
+ThumbnailSweeper::~ThumbnailSweeper() {
+    cancel();
+    pool.waitForDone();
+}
+
+void ThumbnailSweeper::start(bool dryRun) {
+    start(dryRun, settings->thumbnailCacheLimit(), settings->thumbnailCacheMaxAge());
+}
+
+void ThumbnailSweeper::start(bool dryRun, int limit, int maxAge) {
+    if(isRunning())
+        return;
+    cancelFlag = false;
+    qint64 maxBytes = static_cast<qint64>(limit) * 1024 * 1024;
+    pool.start(new ThumbnailSweeperRunnable(this, maxBytes, maxAge, dryRun, &cancelFlag));
+}
+
+bool ThumbnailSweeper::isRunning() {
+    return pool.activeThreadCount() > 0;
+}
+
+void ThumbnailSweeper::cancel() {
+    cancelFlag = true;
+}
+
+//------------------------------------------------------------------------------
+
+ThumbnailSweeperRunnable::ThumbnailSweeperRunnable(ThumbnailSweeper *_sweeper, qint64 _maxBytes, int _maxAgeDays, bool _dryRun, const std::atomic_bool *_cancel)
+    : sweeper(_sweeper),
+      maxBytes(_maxBytes),
+      maxAgeDays(_maxAgeDays),
+      dryRun(_dryRun),
+      cancel(_cancel)
+{
+}
+
+void ThumbnailSweeperRunnable::run() {
+    QThread::currentThread()->setPriority(QThread::LowestPriority);
+    ThumbnailCache cache;
+    ThumbnailCacheStats stats = cache.collectGarbage(maxBytes, maxAgeDays, dryRun, cancel);
+    if(!*cancel)
+        emit sweeper->finished(stats);
+}
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <QObject>
+#include <QRunnable>
+#include <QThread>
+#include <QThreadPool>
+#include <atomic>
+#include "components/cache/thumbnailcache.h"
+
+// Runs ThumbnailCache::collectGarbage() in a low priority background thread,
+// with limits taken from settings.
+class ThumbnailSweeper : public QObject {
+    Q_OBJECT
+public:
+    explicit ThumbnailSweeper(QObject *parent = nullptr);
+    ~ThumbnailSweeper();
+    // does nothing if already running
+    void start(bool dryRun);
+    // same, with limits that aren't saved yet (MB, days)
+    void start(bool dryRun, int limit, int maxAge);
+    bool isRunning();
+    void cancel();
+
+signals:
+    void finished(ThumbnailCacheStats);
+
+private:
+    QThreadPool pool;
+    std::atomic_bool cancelFlag;
+};
+
+class ThumbnailSweeperRunnable : public QRunnable {
+public:
+    ThumbnailSweeperRunnable(ThumbnailSweeper *_sweeper, qint64 _maxBytes, int _maxAgeDays, bool _dryRun, const std::atomic_bool *_cancel);
+    void run() override;
+
+private:
+    ThumbnailSweeper *sweeper;
+    qint64 maxBytes;
+    int maxAgeDays;
+    bool dryRun;
+    const std::atomic_bool *cancel;
+};
@@ -0,0 +1,156 @@
+#include "thumbnailwriter.h"
+#include "components/cache/thumbnailcache.h"
+
+ThumbnailWriter::ThumbnailWriter(std::shared_ptr<ThumbnailPack> _pack)
+    : pack(_pack),
+      stopping(false)
+{
+    setObjectName("ThumbnailWriter");
+    start(QThread::LowPriority);
+}
+
+ThumbnailWriter::~ThumbnailWriter() {
+    mutex.lock();
+    stopping = true;
+    hasWork.wakeAll();
+    hasSpace.wakeAll();
+    mutex.unlock();
+    wait();
+}
+
+void ThumbnailWriter::enqueue(const QString &id, const QImage &image) {
+    QMutexLocker locker(&mutex);
+    if(queue.contains(id)) {
+        queue.insert(id, image);
+        mStats.replaced++;
+        return;
+    }
+    if(order.count() >= MAX_QUEUE) {
+        mStats.stalls++;
+        while(order.count() >= MAX_QUEUE && !stopping)
+            hasSpace.wait(&mutex);
+    }
+    order.append(id);
+    queue.insert(id, image);
+    mStats.maxQueueDepth = qMax(mStats.maxQueueDepth, order.count());
+    hasWork.wakeOne();
+}
+
+bool ThumbnailWriter::pending(const QString &id, QImage &image) {
+    QMutexLocker locker(&mutex);
+    auto it = queue.find(id);
+    if(it != queue.end()) {
+        image = it.value();
+        return true;
+    }
+    it = inFlight.find(id);
+    if(it != inFlight.end()) {
+        image = it.value();
+        return true;
+    }
+    return false;
+}
+
+void ThumbnailWriter::discard(const QString &id) {
+    QMutexLocker locker(&mutex);
+    if(queue.remove(id)) {
+        order.removeOne(id);
+        hasSpace.wakeAll();
+    }
+    // don't let the current batch put it back after the caller removes it
+    while(inFlight.contains(id))
+        done.wait(&mutex);
+}
+
+void ThumbnailWriter::addToSizeIndex(const QString &id, int size, const QByteArray &thumbnailKey) {
+    QMutexLocker locker(&mutex);
+    sizeQueue[id].insert(size, thumbnailKey);
+    hasWork.wakeOne();
+}
+
+QList<int> ThumbnailWriter::pendingSizes(const QString &id) {
+    QMutexLocker locker(&mutex);
+    return sizeQueue.value(id).keys() + sizesInFlight.value(id).keys();
+}
+
+void ThumbnailWriter::flush() {
+    QMutexLocker locker(&mutex);
+    while(!order.isEmpty() || !inFlight.isEmpty() || !sizeQueue.isEmpty() || !sizesInFlight.isEmpty())
+        done.wait(&mutex);
+}
+
+ThumbnailWriterStats ThumbnailWriter::stats() {
+    QMutexLocker locker(&mutex);
+    ThumbnailWriterStats s = mStats;
+    s.queueDepth = order.count();
+    return s;
+}
+
+void ThumbnailWriter::run() {
+    QElapsedTimer timer;
+    forever {
+        mutex.lock();
+        while(order.isEmpty() && sizeQueue.isEmpty() && !stopping)
+            hasWork.wait(&mutex);
+        if(order.isEmpty() && sizeQueue.isEmpty()) {
+            mutex.unlock();
+            break;
+        }
+        QList<QString> ids;
+        QList<QImage> images;
+        while(!order.isEmpty() && ids.count() < MAX_BATCH) {
+            QString id = order.takeFirst();
+            QImage image = queue.take(id);
+            inFlight.insert(id, image);
+            ids.append(id);
+            images.append(image);
+        }
+        sizesInFlight.swap(sizeQueue);
+        hasSpace.wakeAll();
+        mutex.unlock();
+
+        timer.start();
+        QList<QPair<QByteArray, QByteArray>> entries;
+        qint64 bytes = 0;
+        for(int i = 0; i < ids.count(); i++) {
+            QByteArray data = ThumbnailCache::encode(images.at(i));
+            bytes += data.size();
+            entries.append(qMakePair(ThumbnailPack::keyFor(ids.at(i)), data));
+        }
+        // after the thumbnails, so that the index doesn't point to missing ones
+        for(auto it = sizesInFlight.constBegin(); it != sizesInFlight.constEnd(); ++it) {
+            QByteArray key = ThumbnailPack::keyFor(it.key());
+            QMap<int, QByteArray> sizes;
+            pack->read(key, [&sizes](const QByteArray &data) {
+                ThumbnailCache::decodeSizeIndex(data, sizes);
+            });
+            bool changed = false;
+            for(auto size = it.value().constBegin(); size != it.value().constEnd(); ++size) {
+                if(sizes.value(size.key()) != size.value()) {
+                    sizes.insert(size.key(), size.value());
+                    changed = true;
+                }
+            }
+            if(changed)
+                entries.append(qMakePair(key, ThumbnailCache::encodeSizeIndex(sizes)));
+        }
+        qint64 encodeTime = timer.restart();
+        pack->compactIfNeeded();
+        int written = pack->writeBatch(entries);
+        qint64 writeTime = timer.elapsed();
+
+        mutex.lock();
+        inFlight.clear();
+        sizesInFlight.clear();
+        mStats.batches++;
+        mStats.written += written;
+        mStats.bytesWritten += bytes;
+        mStats.encodeTime += encodeTime;
+        mStats.writeTime += writeTime;
+        done.wakeAll();
+        mutex.unlock();
+    }
+    mutex.lock();
+    done.wakeAll();
+    mutex.unlock();
+}
@@ -0,0 +1,67 @@
+#pragma once
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QMap>
+#include <QImage>
+#include <QElapsedTimer>
+#include <QDebug>
+#include <memory>
+#include "components/cache/thumbnailpack.h"
+
+struct ThumbnailWriterStats {
+    int queueDepth = 0;
+    int maxQueueDepth = 0;
+    quint64 written = 0;
+    quint64 replaced = 0;   // superseded by a newer thumbnail with the same id while queued
+    quint64 stalls = 0;     // times a producer had to wait for free space
+    quint64 batches = 0;
+    qint64 bytesWritten = 0;
+    qint64 encodeTime = 0;  // ms
+    qint64 writeTime = 0;   // ms
+};
+
+// Encodes and writes thumbnails to the pack on its own thread, so that the
+// thumbnailer workers only have to decode.
+// Thumbnails go through a bounded queue; enqueue() blocks while it is full.
+// Queued entries with the same id are merged, and they are written in batches
+// under a single pack lock.
+// Size index updates (see ThumbnailCache::sizeIndex()) are queued here as
+// well; being the only one who writes them keeps their read-modify-write safe.
+// Thread safe.
+class ThumbnailWriter : public QThread {
+public:
+    explicit ThumbnailWriter(std::shared_ptr<ThumbnailPack> _pack);
+    // writes out everything that is still queued
+    ~ThumbnailWriter();
+
+    void enqueue(const QString &id, const QImage &image);
+    // queued or currently being written; not in the pack yet
+    bool pending(const QString &id, QImage &image);
+    void discard(const QString &id);
+    // thumbnailKey is the pack key of the thumbnail of that size
+    void addToSizeIndex(const QString &id, int size, const QByteArray &thumbnailKey);
+    // sizes queued for the index, not in the pack yet
+    QList<int> pendingSizes(const QString &id);
+    // blocks until everything queued so far is written
+    void flush();
+    ThumbnailWriterStats stats();
+
+protected:
+    void run() override;
+
+private:
+    std::shared_ptr<ThumbnailPack> pack;
+    QMutex mutex;
+    QWaitCondition hasWork, hasSpace, done;
+    QList<QString> order;
+    QHash<QString, QImage> queue, inFlight;
+    QHash<QString, QMap<int, QByteArray>> sizeQueue, sizesInFlight;
+    bool stopping;
+    ThumbnailWriterStats mStats;
+
+    static const int MAX_QUEUE = 64;
+    static const int MAX_BATCH = 16;
+};
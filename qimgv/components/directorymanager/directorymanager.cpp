@@ -4,7 +4,10 @@ namespace fs = std::filesystem;
 
 DirectoryManager::DirectoryManager() :
     watcher(nullptr),
-    mSortingMode(SORT_NAME)
+    mSortingMode(SORT_NAME),
+    scanner(nullptr),
+    scanId(0),
+    editedDuringScan(false)
 {
     regex.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
     collator.setNumericMode(true);
@@ -14,57 +17,39 @@ DirectoryManager::DirectoryManager() :
     connect(settings, &Settings::settingsChanged, this, &DirectoryManager::readSettings);
 }
 
+DirectoryManager::~DirectoryManager() {
+    if(scanner) {
+        scanner->disconnect(this);
+        scanner->cancel();
+        scanner->wait();
+    }
+}
+
 template< typename T, typename Pred >
 typename std::vector<T>::iterator
 insert_sorted(std::vector<T> & vec, T const& item, Pred pred) {
     return vec.insert(std::upper_bound(vec.begin(), vec.end(), item, pred), item);
 }
 
-bool DirectoryManager::path_entry_compare(const FSEntry &e1, const FSEntry &e2) const {
-    return collator.compare(e1.path, e2.path) < 0;
-};
-
-bool DirectoryManager::path_entry_compare_reverse(const FSEntry &e1, const FSEntry &e2) const {
-    return collator.compare(e1.path, e2.path) > 0;
-};
-
-bool DirectoryManager::name_entry_compare(const FSEntry &e1, const FSEntry &e2) const {
-    return collator.compare(e1.name, e2.name) < 0;
-};
-
-bool DirectoryManager::name_entry_compare_reverse(const FSEntry &e1, const FSEntry &e2) const {
-    return collator.compare(e1.name, e2.name) > 0;
-};
-
-bool DirectoryManager::date_entry_compare(const FSEntry& e1, const FSEntry& e2) const {
-    return e1.modifyTime < e2.modifyTime;
-}
-
-bool DirectoryManager::date_entry_compare_reverse(const FSEntry& e1, const FSEntry& e2) const {
-    return e1.modifyTime > e2.modifyTime;
-}
-
-bool DirectoryManager::size_entry_compare(const FSEntry& e1, const FSEntry& e2) const {
-    return e1.size < e2.size;
-}
-
-bool DirectoryManager::size_entry_compare_reverse(const FSEntry& e1, const FSEntry& e2) const {
-    return e1.size > e2.size;
+bool DirectoryManager::entryLessThan(const FSEntry &e1, const FSEntry &e2, SortingMode mode, const QCollator &collator) {
+    switch(mode) {
+    case SortingMode::SORT_NAME_DESC:
+        return collator.compare(e1.path, e2.path) > 0;
+    case SortingMode::SORT_TIME:
+        return e1.modifyTime < e2.modifyTime;
+    case SortingMode::SORT_TIME_DESC:
+        return e1.modifyTime > e2.modifyTime;
+    case SortingMode::SORT_SIZE:
+        return e1.size < e2.size;
+    case SortingMode::SORT_SIZE_DESC:
+        return e1.size > e2.size;
+    default:
+        return collator.compare(e1.path, e2.path) < 0;
+    }
 }
 
-CompareFunction DirectoryManager::compareFunction() {
-    CompareFunction cmpFn = &DirectoryManager::path_entry_compare;
-    if(mSortingMode == SortingMode::SORT_NAME_DESC)
-        cmpFn = &DirectoryManager::path_entry_compare_reverse;
-    if(mSortingMode == SortingMode::SORT_TIME)
-        cmpFn = &DirectoryManager::date_entry_compare;
-    if(mSortingMode == SortingMode::SORT_TIME_DESC)
-        cmpFn = &DirectoryManager::date_entry_compare_reverse;
-    if(mSortingMode == SortingMode::SORT_SIZE)
-        cmpFn = &DirectoryManager::size_entry_compare;
-    if(mSortingMode == SortingMode::SORT_SIZE_DESC)
-        cmpFn = &DirectoryManager::size_entry_compare_reverse;
-    return cmpFn;
+bool DirectoryManager::entry_compare(const FSEntry &e1, const FSEntry &e2) const {
+    return entryLessThan(e1, e2, mSortingMode, collator);
 }
 
 void DirectoryManager::startFileWatcher(QString directoryPath) {
@@ -102,7 +87,7 @@ void DirectoryManager::readSettings() {
     regex.setPattern(settings->supportedFormatsRegex());
 }
 
-bool DirectoryManager::setDirectory(QString dirPath) {
+bool DirectoryManager::checkDirectory(QString dirPath) const {
     if(dirPath.isEmpty()) {
         return false;
     }
@@ -119,6 +104,13 @@ bool DirectoryManager::setDirectory(QString dirPath) {
         qDebug() << "[DirectoryManager] Error - cannot read directory.";
         return false;
     }
+    return true;
+}
+
+bool DirectoryManager::setDirectory(QString dirPath) {
+    stopScan();
+    if(!checkDirectory(dirPath))
+        return false;
     mListSource = SOURCE_DIRECTORY;
     mDirectoryPath = dirPath;
 
@@ -129,7 +121,81 @@ bool DirectoryManager::setDirectory(QString dirPath) {
     return true;
 }
 
+bool DirectoryManager::setDirectoryAsync(QString dirPath) {
+    stopScan();
+    if(!checkDirectory(dirPath))
+        return false;
+    mListSource = SOURCE_DIRECTORY;
+    mDirectoryPath = dirPath;
+    dirEntryVec.clear();
+    fileEntryVec.clear();
+    editedDuringScan = false;
+    editedPaths.clear();
+
+    scanner = new DirectoryScanner(++scanId, dirPath, regex, mSortingMode);
+    connect(scanner, &DirectoryScanner::entriesFound, this, &DirectoryManager::onScanEntriesFound);
+    connect(scanner, &DirectoryScanner::scanFinished, this, &DirectoryManager::onScanFinished);
+    scanner->start();
+    emit loaded(dirPath);
+    return true;
+}
+
+bool DirectoryManager::isScanning() const {
+    return scanner != nullptr;
+}
+
+// Doesn't wait for the thread, it can be stuck on a slow drive for a while.
+// Whatever is still in the event queue from it is ignored (by scanId).
+void DirectoryManager::stopScan() {
+    if(!scanner)
+        return;
+    scanner->disconnect(this);
+    scanner->cancel();
+    scanner = nullptr;
+    editedPaths.clear();
+}
+
+// While scanning: remembers that the lists were changed from here, and
+// keeps the scan from adding this path again (or back, if it was removed).
+void DirectoryManager::markEdited(const QString &path) {
+    if(!scanner)
+        return;
+    editedDuringScan = true;
+    editedPaths.insert(path);
+}
+
+void DirectoryManager::onScanEntriesFound(int id, std::vector<FSEntry> dirs, std::vector<FSEntry> files) {
+    if(id != scanId || !scanner)
+        return;
+    // already added or removed via insertFileEntry() etc
+    if(!editedPaths.isEmpty()) {
+        auto edited = [this](const FSEntry &e) { return editedPaths.contains(e.path); };
+        dirs.erase(std::remove_if(dirs.begin(), dirs.end(), edited), dirs.end());
+        files.erase(std::remove_if(files.begin(), files.end(), edited), files.end());
+    }
+    dirEntryVec.insert(dirEntryVec.end(), dirs.begin(), dirs.end());
+    fileEntryVec.insert(fileEntryVec.end(), files.begin(), files.end());
+    if(dirs.size() || files.size())
+        emit entriesAdded(dirs.size(), files.size());
+}
+
+void DirectoryManager::onScanFinished(int id, std::vector<FSEntry> dirs, std::vector<FSEntry> files) {
+    if(id != scanId || !scanner)
+        return;
+    scanner = nullptr;
+    editedPaths.clear();
+    if(editedDuringScan) {
+        sortEntryLists();
+    } else {
+        dirEntryVec.swap(dirs);
+        fileEntryVec.swap(files);
+    }
+    startFileWatcher(mDirectoryPath);
+    emit scanFinished(mDirectoryPath);
+}
+
 bool DirectoryManager::setDirectoryRecursive(QString dirPath) {
+    stopScan();
     if(dirPath.isEmpty()) {
         return false;
     }
@@ -183,6 +249,13 @@ QString DirectoryManager::fileNameAt(int index) const {
     return checkFileRange(index) ? fileEntryVec.at(index).name : "";
 }
 
+const FSEntry &DirectoryManager::dirEntryAt(int index) const {
+    if(checkDirRange(index))
+        return dirEntryVec.at(index);
+    else
+        return defaultEntry;
+}
+
 QString DirectoryManager::dirPathAt(int index) const {
     return checkDirRange(index) ? dirEntryVec.at(index).path : "";
 }
@@ -336,8 +409,8 @@ void DirectoryManager::addEntriesFromDirectory(std::vector<FSEntry> &entryVec, Q
                 newEntry.name = name;
                 newEntry.path = path;
                 newEntry.isDirectory = true;
-                //newEntry.size = entry.file_size();
-                //newEntry.modifyTime = entry.last_write_time();
+                // for folder previews
+                newEntry.modifyTime = entry.last_write_time();
             } catch (const std::filesystem::filesystem_error &err) {
                 qDebug() << "[DirectoryManager]" << err.what();
                 continue;
@@ -384,13 +457,14 @@ void DirectoryManager::addEntriesFromDirectoryRecursive(std::vector<FSEntry> &en
 }
 
 void DirectoryManager::sortEntryLists() {
-    std::sort(dirEntryVec.begin(), dirEntryVec.end(), std::bind(compareFunction(), this, std::placeholders::_1, std::placeholders::_2));
-    std::sort(fileEntryVec.begin(), fileEntryVec.end(), std::bind(compareFunction(), this, std::placeholders::_1, std::placeholders::_2));
+    std::sort(dirEntryVec.begin(), dirEntryVec.end(), std::bind(&DirectoryManager::entry_compare, this, std::placeholders::_1, std::placeholders::_2));
+    std::sort(fileEntryVec.begin(), fileEntryVec.end(), std::bind(&DirectoryManager::entry_compare, this, std::placeholders::_1, std::placeholders::_2));
 }
 
 void DirectoryManager::setSortingMode(SortingMode mode) {
     if(mode != mSortingMode) {
         mSortingMode = mode;
+        editedDuringScan = true;
         if(fileEntryVec.size() > 1 || dirEntryVec.size() > 1) {
             sortEntryLists();
             emit sortingChanged();
@@ -414,10 +488,11 @@ bool DirectoryManager::insertFileEntry(const QString &filePath) {
 bool DirectoryManager::forceInsertFileEntry(const QString &filePath) {
     if(!this->isFile(filePath) || containsFile(filePath))
         return false;
+    markEdited(filePath);
     std::filesystem::directory_entry stdEntry(toStdString(filePath));
     QString fileName = QString::fromStdString(stdEntry.path().filename().generic_string()); // isn't it beautiful
     FSEntry FSEntry(filePath, fileName, stdEntry.file_size(), stdEntry.last_write_time(), stdEntry.is_directory());
-    insert_sorted(fileEntryVec, FSEntry, std::bind(compareFunction(), this, std::placeholders::_1, std::placeholders::_2));
+    insert_sorted(fileEntryVec, FSEntry, std::bind(&DirectoryManager::entry_compare, this, std::placeholders::_1, std::placeholders::_2));
     if(!directoryPath().isEmpty()) {
         qDebug() << "fileIns" << filePath << directoryPath();
         emit fileAdded(filePath);
@@ -426,6 +501,8 @@ bool DirectoryManager::forceInsertFileEntry(const QString &filePath) {
 }
 
 void DirectoryManager::removeFileEntry(const QString &filePath) {
+    // may not have been listed yet
+    markEdited(filePath);
     if(!containsFile(filePath))
         return;
     int index = indexOfFile(filePath);
@@ -437,6 +514,7 @@ void DirectoryManager::removeFileEntry(const QString &filePath) {
 void DirectoryManager::updateFileEntry(const QString &filePath) {
     if(!containsFile(filePath))
         return;
+    editedDuringScan = true;
     FSEntry newEntry(filePath);
     int index = indexOfFile(filePath);
     if(fileEntryVec.at(index).modifyTime != newEntry.modifyTime)
@@ -448,6 +526,7 @@ void DirectoryManager::updateFileEntry(const QString &filePath) {
 void DirectoryManager::renameFileEntry(const QString &oldFilePath, const QString &newFileName) {
     QFileInfo fi(oldFilePath);
     QString newFilePath = fi.absolutePath() + "/" + newFileName;
+    markEdited(oldFilePath);
     if(!containsFile(oldFilePath)) {
         if(containsFile(newFilePath))
             updateFileEntry(newFilePath);
@@ -464,13 +543,14 @@ void DirectoryManager::renameFileEntry(const QString &oldFilePath, const QString
         fileEntryVec.erase(fileEntryVec.begin() + replaceIndex);
         emit fileRemoved(newFilePath, replaceIndex);
     }
+    markEdited(newFilePath);
     // remove the old one
     int oldIndex = indexOfFile(oldFilePath);
     fileEntryVec.erase(fileEntryVec.begin() + oldIndex);
     // insert
     std::filesystem::directory_entry stdEntry(toStdString(newFilePath));
     FSEntry FSEntry(newFilePath, newFileName, stdEntry.file_size(), stdEntry.last_write_time(), stdEntry.is_directory());
-    insert_sorted(fileEntryVec, FSEntry, std::bind(compareFunction(), this, std::placeholders::_1, std::placeholders::_2));
+    insert_sorted(fileEntryVec, FSEntry, std::bind(&DirectoryManager::entry_compare, this, std::placeholders::_1, std::placeholders::_2));
     qDebug() << "fileRen" << oldFilePath << newFilePath;
     emit fileRenamed(oldFilePath, oldIndex, newFilePath, indexOfFile(newFilePath));
 }
@@ -480,19 +560,22 @@ void DirectoryManager::renameFileEntry(const QString &oldFilePath, const QString
 bool DirectoryManager::insertDirEntry(const QString &dirPath) {
     if(containsDir(dirPath))
         return false;
+    markEdited(dirPath);
     std::filesystem::directory_entry stdEntry(toStdString(dirPath));
     QString dirName = QString::fromStdString(stdEntry.path().filename().generic_string()); // isn't it beautiful
     FSEntry FSEntry;
     FSEntry.name = dirName;
     FSEntry.path = dirPath;
     FSEntry.isDirectory = true;
-    insert_sorted(dirEntryVec, FSEntry, std::bind(compareFunction(), this, std::placeholders::_1, std::placeholders::_2));
+    FSEntry.modifyTime = stdEntry.last_write_time();
+    insert_sorted(dirEntryVec, FSEntry, std::bind(&DirectoryManager::entry_compare, this, std::placeholders::_1, std::placeholders::_2));
     qDebug() << "dirIns" << dirPath;
     emit dirAdded(dirPath);
     return true;
 }
 
 void DirectoryManager::removeDirEntry(const QString &dirPath) {
+    markEdited(dirPath);
     if(!containsDir(dirPath))
         return;
     int index = indexOfDir(dirPath);
@@ -502,10 +585,12 @@ void DirectoryManager::removeDirEntry(const QString &dirPath) {
 }
 
 void DirectoryManager::renameDirEntry(const QString &oldDirPath, const QString &newDirName) {
+    markEdited(oldDirPath);
     if(!containsDir(oldDirPath))
         return;
     QFileInfo fi(oldDirPath);
     QString newDirPath = fi.absolutePath() + "/" + newDirName;
+    markEdited(newDirPath);
     // remove the old one
     int oldIndex = indexOfDir(oldDirPath);
     dirEntryVec.erase(dirEntryVec.begin() + oldIndex);
@@ -515,7 +600,8 @@ void DirectoryManager::renameDirEntry(const QString &oldDirPath, const QString &
     FSEntry.name = newDirName;
     FSEntry.path = newDirPath;
     FSEntry.isDirectory = true;
-    insert_sorted(dirEntryVec, FSEntry, std::bind(compareFunction(), this, std::placeholders::_1, std::placeholders::_2));
+    FSEntry.modifyTime = stdEntry.last_write_time();
+    insert_sorted(dirEntryVec, FSEntry, std::bind(&DirectoryManager::entry_compare, this, std::placeholders::_1, std::placeholders::_2));
     qDebug() << "dirRen" << oldDirPath << newDirPath;
     emit dirRenamed(oldDirPath, oldIndex, newDirPath, indexOfDir(newDirPath));
 }
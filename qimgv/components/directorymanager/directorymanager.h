@@ -8,6 +8,7 @@
 #include <QDebug>
 #include <QDateTime>
 #include <QRegularExpression>
+#include <QSet>
 
 #include <vector>
 #include <string>
@@ -17,6 +18,7 @@
 
 #include "settings.h"
 #include "watchers/directorywatcher.h"
+#include "directoryscanner.h"
 #include "utils/stuff.h"
 #include "sourcecontainers/fsentry.h"
 
@@ -26,18 +28,20 @@ enum FileListSource { // rename? wip
     SOURCE_LIST
 };
 
-class DirectoryManager;
-
-typedef bool (DirectoryManager::*CompareFunction)(const FSEntry &e1, const FSEntry &e2) const;
-
 //TODO: rename? EntrySomething?
 
 class DirectoryManager : public QObject {
     Q_OBJECT
 public:
     DirectoryManager();
+    ~DirectoryManager();
     // ignored if the same dir is already opened
     bool setDirectory(QString);
+    // Returns right away (after loaded()) with empty lists, which are then
+    // filled in the background; see entriesAdded() and scanFinished().
+    // Entries are unsorted until the scan is done.
+    bool setDirectoryAsync(QString);
+    bool isScanning() const;
     bool setDirectoryRecursive(QString);
     QString directoryPath() const;
     int indexOfFile(QString filePath) const;
@@ -66,6 +70,7 @@ public:
     unsigned long totalCount() const;
     bool containsDir(QString dirPath) const;
     const FSEntry &fileEntryAt(int index) const;
+    const FSEntry &dirEntryAt(int index) const;
     QString dirPathAt(int index) const;
     QString dirNameAt(int index) const;
     bool fileWatcherActive();
@@ -86,6 +91,9 @@ public:
 
     QStringList fileList() const;
 
+    // Sort order of both lists. DirectoryScanner sorts with this as well.
+    static bool entryLessThan(const FSEntry &e1, const FSEntry &e2, SortingMode mode, const QCollator &collator);
+
 private:
     QRegularExpression regex;
     QCollator collator;
@@ -98,16 +106,18 @@ private:
     SortingMode mSortingMode;
     FileListSource mListSource;
     void loadEntryList(QString directoryPath, bool recursive);
-
-    bool path_entry_compare(const FSEntry &e1, const FSEntry &e2) const;
-    bool path_entry_compare_reverse(const FSEntry &e1, const FSEntry &e2) const;
-    bool name_entry_compare(const FSEntry &e1, const FSEntry &e2) const;
-    bool name_entry_compare_reverse(const FSEntry &e1, const FSEntry &e2) const;
-    bool date_entry_compare(const FSEntry &e1, const FSEntry &e2) const;
-    bool date_entry_compare_reverse(const FSEntry &e1, const FSEntry &e2) const;
-    CompareFunction compareFunction();
-    bool size_entry_compare(const FSEntry &e1, const FSEntry &e2) const;
-    bool size_entry_compare_reverse(const FSEntry &e1, const FSEntry &e2) const;
+    bool checkDirectory(QString dirPath) const;
+
+    DirectoryScanner *scanner;
+    int scanId;
+    // lists were changed from here while scanning; the scanner's copy is stale
+    bool editedDuringScan;
+    QSet<QString> editedPaths;
+    void markEdited(const QString &path);
+    void stopScan();
+
+    // with the current sorting mode
+    bool entry_compare(const FSEntry &e1, const FSEntry &e2) const;
     void startFileWatcher(QString directoryPath);
     void stopFileWatcher();
 
@@ -121,9 +131,14 @@ private slots:
     void onFileRemovedExternal(QString fileName);
     void onFileModifiedExternal(QString fileName);
     void onFileRenamedExternal(QString oldFileName, QString newFileName);
+    void onScanEntriesFound(int id, std::vector<FSEntry> dirs, std::vector<FSEntry> files);
+    void onScanFinished(int id, std::vector<FSEntry> dirs, std::vector<FSEntry> files);
 
 signals:
     void loaded(const QString &path);
+    // appended at the end of each list
+    void entriesAdded(int dirCount, int fileCount);
+    void scanFinished(const QString &path);
     void sortingChanged();
     void fileRemoved(QString filePath, int);
     void fileModified(QString filePath);
@@ -0,0 +1,94 @@
+#include "directoryscanner.h"
+#include "directorymanager.h"
+
+namespace fs = std::filesystem;
+
+DirectoryScanner::DirectoryScanner(int _scanId, QString _path, QRegularExpression _filter, SortingMode _mode)
+    : scanId(_scanId),
+      path(_path),
+      filter(_filter),
+      mode(_mode),
+      cancelled(false)
+{
+    setObjectName("DirectoryScanner");
+    collator.setNumericMode(true);
+    connect(this, &QThread::finished, this, &QObject::deleteLater);
+}
+
+void DirectoryScanner::cancel() {
+    cancelled = true;
+}
+
+// same rules as in DirectoryManager::addEntriesFromDirectory()
+void DirectoryScanner::run() {
+    std::vector<FSEntry> dirs, files, batchDirs, batchFiles;
+    QElapsedTimer batchTimer;
+    batchTimer.start();
+    bool firstBatch = true;
+    auto sendBatch = [&]() {
+        dirs.insert(dirs.end(), batchDirs.begin(), batchDirs.end());
+        files.insert(files.end(), batchFiles.begin(), batchFiles.end());
+        emit entriesFound(scanId, std::move(batchDirs), std::move(batchFiles));
+        batchDirs.clear();
+        batchFiles.clear();
+        firstBatch = false;
+        batchTimer.restart();
+    };
+
+    std::error_code ec;
+    fs::directory_iterator it(toStdString(path), ec), end;
+    for(; !ec && it != end; it.increment(ec)) {
+        if(cancelled)
+            return;
+        const auto &entry = *it;
+        QString name = QString::fromStdString(entry.path().filename().generic_string());
+#ifndef Q_OS_WIN32
+        // ignore hidden files
+        if(name.startsWith("."))
+            continue;
+#endif
+        std::error_code typeError;
+        if(entry.is_directory(typeError)) {
+            FSEntry newEntry;
+            newEntry.name = name;
+            newEntry.path = QString::fromStdString(entry.path().generic_string());
+            newEntry.isDirectory = true;
+            std::error_code timeError;
+            newEntry.modifyTime = entry.last_write_time(timeError);
+            batchDirs.emplace_back(newEntry);
+        } else if(filter.match(name).hasMatch()) {
+            FSEntry newEntry;
+            try {
+                newEntry.name = name;
+                newEntry.path = QString::fromStdString(entry.path().generic_string());
+                newEntry.isDirectory = false;
+                newEntry.size = entry.file_size();
+                newEntry.modifyTime = entry.last_write_time();
+            } catch (const std::filesystem::filesystem_error &err) {
+                qDebug() << "[DirectoryScanner]" << err.what();
+                continue;
+            }
+            batchFiles.emplace_back(newEntry);
+        }
+        size_t batchSize = batchDirs.size() + batchFiles.size();
+        if(batchSize && ((firstBatch && batchSize >= FIRST_BATCH_SIZE) || batchTimer.elapsed() >= BATCH_INTERVAL))
+            sendBatch();
+    }
+    if(ec)
+        qDebug() << "[DirectoryScanner]" << path << QString::fromStdString(ec.message());
+    if(cancelled)
+        return;
+    if(batchDirs.size() || batchFiles.size())
+        sendBatch();
+    sortEntries(dirs);
+    sortEntries(files);
+    if(cancelled)
+        return;
+    emit scanFinished(scanId, std::move(dirs), std::move(files));
+}
+
+void DirectoryScanner::sortEntries(std::vector<FSEntry> &entries) {
+    std::sort(entries.begin(), entries.end(), [this](const FSEntry &e1, const FSEntry &e2) {
+        return DirectoryManager::entryLessThan(e1, e2, mode, collator);
+    });
+}
@@ -0,0 +1,51 @@
+#pragma once
+
+#include <QThread>
+#include <QString>
+#include <QCollator>
+#include <QElapsedTimer>
+#include <QRegularExpression>
+#include <QDebug>
+#include <vector>
+#include <atomic>
+#include <filesystem>
+#include <algorithm>
+
+#include "settings.h"
+#include "utils/stuff.h"
+#include "sourcecontainers/fsentry.h"
+
+// Lists a directory on its own thread, so that huge or slow (network)
+// directories don't block the gui.
+// Entries are handed over in batches as they are found, in no particular
+// order. When everything is listed the whole list gets sorted here as well
+// and is handed over once more, sorted.
+// One instance per scan. Nothing is emitted after cancel(); deletes itself
+// when the thread exits.
+class DirectoryScanner : public QThread {
+    Q_OBJECT
+public:
+    DirectoryScanner(int _scanId, QString _path, QRegularExpression _filter, SortingMode _mode);
+    void cancel();
+
+protected:
+    void run() override;
+
+signals:
+    void entriesFound(int scanId, std::vector<FSEntry> dirs, std::vector<FSEntry> files);
+    void scanFinished(int scanId, std::vector<FSEntry> dirs, std::vector<FSEntry> files);
+
+private:
+    int scanId;
+    QString path;
+    QRegularExpression filter;
+    SortingMode mode;
+    QCollator collator;
+    std::atomic_bool cancelled;
+
+    void sortEntries(std::vector<FSEntry> &entries);
+
+    // the first one goes out early so that the view isn't empty for long
+    static constexpr size_t FIRST_BATCH_SIZE = 256;
+    static constexpr int BATCH_INTERVAL = 150; // ms
+};
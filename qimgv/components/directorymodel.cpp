@@ -15,9 +15,18 @@ DirectoryModel::DirectoryModel(QObject *parent) :
     connect(&dirManager, &DirectoryManager::dirRenamed,  this, &DirectoryModel::dirRenamed);
 
     connect(&dirManager, &DirectoryManager::loaded, this, &DirectoryModel::loaded);
+    connect(&dirManager, &DirectoryManager::entriesAdded, this, &DirectoryModel::entriesAdded);
+    connect(&dirManager, &DirectoryManager::scanFinished, this, &DirectoryModel::scanFinished);
     connect(&dirManager, &DirectoryManager::sortingChanged, this, &DirectoryModel::onSortingChanged);
+    connect(&loader, &Loader::previewReady, this, &DirectoryModel::imagePreviewReady);
     connect(&loader, &Loader::loadFinished, this, &DirectoryModel::onImageReady);
     connect(&loader, &Loader::loadFailed, this, &DirectoryModel::loadFailed);
+    connect(settings, &Settings::settingsChanged, this, &DirectoryModel::readSettings);
+    readSettings();
+}
+
+void DirectoryModel::readSettings() {
+    cache.setMemoryLimit(static_cast<qint64>(settings->imageCacheSize()) * 1024 * 1024);
 }
 
 DirectoryModel::~DirectoryModel() {
@@ -53,6 +62,10 @@ const FSEntry &DirectoryModel::fileEntryAt(int index) const {
     return dirManager.fileEntryAt(index);
 }
 
+const FSEntry &DirectoryModel::dirEntryAt(int index) const {
+    return dirManager.dirEntryAt(index);
+}
+
 QString DirectoryModel::fileNameAt(int index) const {
     return dirManager.fileNameAt(index);
 }
@@ -175,9 +188,20 @@ void DirectoryModel::moveFileTo(const QString &srcFile, const QString &destDirPa
 // -----------------------------------------------------------------------------
 bool DirectoryModel::setDirectory(QString path) {
     cache.clear();
+    scaler->clearResultCache();
     return dirManager.setDirectory(path);
 }
 
+bool DirectoryModel::setDirectoryAsync(QString path) {
+    cache.clear();
+    scaler->clearResultCache();
+    return dirManager.setDirectoryAsync(path);
+}
+
+bool DirectoryModel::isScanning() const {
+    return dirManager.isScanning();
+}
+
 void DirectoryModel::unload(int index) {
     QString filePath = this->filePathAt(index);
     cache.remove(filePath);
@@ -187,14 +211,11 @@ void DirectoryModel::unload(QString filePath) {
     cache.remove(filePath);
 }
 
-void DirectoryModel::unloadExcept(QString filePath, bool keepNearby) {
-    QList<QString> list;
-    list << filePath;
-    if(keepNearby)  {
-        list << prevOf(filePath);
-        list << nextOf(filePath);
-    }
-    cache.trimTo(list);
+// unloads least recently used images until the cache fits into its memory budget
+// filePath and everything in keepList (preloaded files) are always kept
+void DirectoryModel::unloadExcept(QString filePath, QList<QString> keepList) {
+    keepList << filePath;
+    cache.trimTo(keepList);
 }
 
 bool DirectoryModel::loaderBusy() const {
@@ -305,9 +326,17 @@ void DirectoryModel::updateImage(QString filePath, std::shared_ptr<Image> img) {
 }
 
 void DirectoryModel::load(QString filePath, bool asyncHint) {
-    if(!containsFile(filePath) || loader.isLoading(filePath))
+    if(!containsFile(filePath))
+        return;
+    // on every path, including cache hits; see Loader::setCurrent()
+    loader.setCurrent(filePath);
+    if(loader.isLoading(filePath)) {
+        // already being preloaded; bump it to the front
+        loader.loadAsyncPriority(filePath);
         return;
-    if(!cache.contains(filePath)) {
+    }
+    auto cached = cache.lookup(filePath);
+    if(!cached) {
         if(asyncHint) {
             loader.loadAsyncPriority(filePath);
         } else {
@@ -320,7 +349,7 @@ void DirectoryModel::load(QString filePath, bool asyncHint) {
             }
         }
     } else {
-        emit imageReady(cache.get(filePath), filePath);
+        emit imageReady(cached, filePath);
     }
 }
 
@@ -336,3 +365,17 @@ void DirectoryModel::preload(QString filePath) {
     if(containsFile(filePath) && !cache.contains(filePath))
         loader.loadAsync(filePath);
 }
+
+// Replaces pending preloads with the new list. Sorted by priority, highest first.
+void DirectoryModel::preload(QList<QString> paths) {
+    loader.cancelExcept(paths);
+    for(int i = 0; i < paths.count(); i++) {
+        if(containsFile(paths.at(i)) && !cache.contains(paths.at(i)))
+            loader.loadAsync(paths.at(i), LOAD_PRIORITY_PRELOAD - i);
+    }
+}
+
+// async loads of the current image will send a reduced version of this size first
+void DirectoryModel::setPreviewSize(QSize size) {
+    loader.setPreviewSize(size);
+}
@@ -17,6 +17,8 @@ public:
 
     void load(QString filePath, bool asyncHint);
     void preload(QString filePath);
+    void preload(QList<QString> paths);
+    void setPreviewSize(QSize size);
 
     int fileCount() const;
     int dirCount() const;
@@ -39,6 +41,9 @@ public:
     void removeDir(const QString &dirPath, bool trash, bool recursive, FileOpResult &result);
 
     bool setDirectory(QString);
+    // lists the directory in the background, see DirectoryManager
+    bool setDirectoryAsync(QString);
+    bool isScanning() const;
 
     void unload(int index);
 
@@ -58,8 +63,9 @@ public:
     bool isLoaded(QString filePath) const;
     void reload(QString filePath);
     QString filePathAt(int index) const;
-    void unloadExcept(QString filePath, bool keepNearby);
+    void unloadExcept(QString filePath, QList<QString> keepList);
     const FSEntry &fileEntryAt(int index) const;
+    const FSEntry &dirEntryAt(int index) const;
 
     int totalCount() const;
     QString dirNameAt(int index) const;
@@ -72,6 +78,7 @@ public:
 
     bool containsDir(QString dirPath) const;
     FileListSource source();
+
 signals:
     void fileRemoved(QString filePath, int index);
     void fileRenamed(QString fromPath, int indexFrom, QString toPath, int indexTo);
@@ -81,9 +88,12 @@ signals:
     void dirRenamed(QString dirPath, int indexFrom, QString toPath, int indexTo);
     void dirAdded(QString dirPath);
     void loaded(QString filePath);
+    void entriesAdded(int dirCount, int fileCount);
+    void scanFinished(QString filePath);
     void loadFailed(const QString &path);
     void sortingChanged(SortingMode);
     void indexChanged(int oldIndex, int index);
+    void imagePreviewReady(std::shared_ptr<const QImage> preview, const QString&);
     void imageReady(std::shared_ptr<Image> img, const QString&);
     void imageUpdated(QString filePath);
 
@@ -94,6 +104,7 @@ private:
     FileListSource fileListSource;
 
 private slots:
+    void readSettings();
     void onImageReady(std::shared_ptr<Image> img, const QString &path);
     void onSortingChanged();
     void onFileAdded(QString filePath);
@@ -2,6 +2,7 @@
 
 DirectoryPresenter::DirectoryPresenter(QObject *parent) : QObject(parent), mShowDirs(false) {
     connect(&thumbnailer, &Thumbnailer::thumbnailReady, this, &DirectoryPresenter::onThumbnailReady);
+    connect(&thumbnailer, &Thumbnailer::folderPreviewReady, this, &DirectoryPresenter::onFolderPreviewReady);
 }
 
 void DirectoryPresenter::unsetModel() {
@@ -12,6 +13,7 @@ void DirectoryPresenter::unsetModel() {
     disconnect(model.get(), &DirectoryModel::dirRemoved,   this, &DirectoryPresenter::onDirRemoved);
     disconnect(model.get(), &DirectoryModel::dirAdded,     this, &DirectoryPresenter::onDirAdded);
     disconnect(model.get(), &DirectoryModel::dirRenamed,   this, &DirectoryPresenter::onDirRenamed);
+    disconnect(model.get(), &DirectoryModel::entriesAdded, this, &DirectoryPresenter::onEntriesAdded);
     model = nullptr;
     // also empty view?
 }
@@ -50,6 +52,8 @@ void DirectoryPresenter::setModel(std::shared_ptr<DirectoryModel> newModel) {
     connect(model.get(), &DirectoryModel::dirRemoved,   this, &DirectoryPresenter::onDirRemoved);
     connect(model.get(), &DirectoryModel::dirAdded,     this, &DirectoryPresenter::onDirAdded);
     connect(model.get(), &DirectoryModel::dirRenamed,   this, &DirectoryPresenter::onDirRenamed);
+    // background directory scan
+    connect(model.get(), &DirectoryModel::entriesAdded, this, &DirectoryPresenter::onEntriesAdded);
 }
 
 void DirectoryPresenter::reloadModel() {
@@ -146,6 +150,18 @@ void DirectoryPresenter::onDirAdded(QString dirPath) {
     view->insertItem(index);
 }
 
+// appended at the end of both lists
+void DirectoryPresenter::onEntriesAdded(int dirCount, int fileCount) {
+    if(!view)
+        return;
+    if(mShowDirs && dirCount)
+        view->insertItems(model->dirCount() - dirCount, dirCount);
+    if(fileCount) {
+        int index = model->fileCount() - fileCount;
+        view->insertItems(mShowDirs ? model->dirCount() + index : index, fileCount);
+    }
+}
+
 bool DirectoryPresenter::showDirs() {
     return mShowDirs;
 }
@@ -179,51 +195,84 @@ QList<QString> DirectoryPresenter::selectedPaths() const {
 void DirectoryPresenter::generateThumbnails(QList<int> indexes, int size, bool crop, bool force) {
     if(!view || !model)
         return;
-    thumbnailer.clearTasks();
-    if(!mShowDirs) {
-        for(int i : indexes)
-            thumbnailer.getThumbnailAsync(model->filePathAt(i), size, crop, force);
-        return;
-    }
+    QList<QString> paths, dirPaths;
+    // shared with the other view; anything in there costs nothing
+    auto memoryCache = ThumbnailMemoryCache::getInstance();
+    auto requestFile = [&](int viewIndex, int fileIndex) {
+        QString path = model->filePathAt(fileIndex);
+        if(!force) {
+            auto thumb = memoryCache->find(path, size, crop, modifyTime(fileIndex));
+            if(thumb) {
+                view->setThumbnail(viewIndex, thumb);
+                return;
+            }
+        }
+        paths.append(path);
+    };
+    QColor folderColor = settings->colorScheme().icons;
     for(int i : indexes) {
-        if(i < model->dirCount()) {
-            // tmp ------------------------------------------------------------
-            // gen thumb for a directory
-            // TODO: optimize & move dir icon loading to shared res; then overlay
-            // the mini-thumbs on top (similar to dolphin)
-            QSvgRenderer svgRenderer;
-            svgRenderer.load(QString(":/res/icons/common/other/folder32-scalable.svg"));
-            int factor = (size * 0.90f) / svgRenderer.defaultSize().width();
-            QPixmap *pixmap = new QPixmap(svgRenderer.defaultSize() * factor);
-            pixmap->fill(Qt::transparent);
-            QPainter pixPainter(pixmap);
-            svgRenderer.render(&pixPainter);
-            pixPainter.end();
-
-            ImageLib::recolor(*pixmap, settings->colorScheme().icons);
-
-            std::shared_ptr<Thumbnail> thumb(new Thumbnail(model->dirNameAt(i),
-                                                           "Folder",
-                                                           size,
-                                                           std::shared_ptr<QPixmap>(pixmap)));
-            // ^----------------------------------------------------------------
-            view->setThumbnail(i, thumb);
+        if(!mShowDirs) {
+            requestFile(i, i);
+        } else if(i < model->dirCount()) {
+            // Folder preview; made in the background
+            QString dirPath = model->dirPathAt(i);
+            auto thumb = force ? nullptr : memoryCache->find(folderPreviewKey(dirPath, folderColor), size, false, dirModifyTime(i));
+            if(thumb)
+                view->setThumbnail(i, thumb);
+            else
+                dirPaths.append(dirPath);
         } else {
-            QString path = model->filePathAt(i - model->dirCount());
-            thumbnailer.getThumbnailAsync(path, size, crop, force);
+            requestFile(i, i - model->dirCount());
         }
     }
+    if(force) {
+        // single item reload; leave the rest alone
+        for(auto path : paths)
+            thumbnailer.getThumbnailAsync(path, size, crop, force);
+    } else {
+        // indexes come in priority order; anything not in the list is no longer needed
+        thumbnailer.requestThumbnails(paths, size, crop, force);
+        thumbnailer.requestFolderPreviews(dirPaths, size, folderColor);
+    }
 }
 
-void DirectoryPresenter::onThumbnailReady(std::shared_ptr<Thumbnail> thumb, QString filePath) {
+void DirectoryPresenter::onThumbnailReady(std::shared_ptr<Thumbnail> thumb, QString filePath, bool crop) {
     if(!view || !model)
         return;
-    int index = model->indexOfFile(std::move(filePath));
+    int index = model->indexOfFile(filePath);
     if(index == -1)
         return;
+    ThumbnailMemoryCache::getInstance()->insert(filePath, thumb->size(), crop, modifyTime(index), thumb);
     view->setThumbnail(mShowDirs ? model->dirCount() + index : index, std::move(thumb));
 }
 
+void DirectoryPresenter::onFolderPreviewReady(std::shared_ptr<Thumbnail> thumb, QString dirPath, QColor color) {
+    if(!view || !model || !mShowDirs)
+        return;
+    int index = model->indexOfDir(dirPath);
+    if(index == -1)
+        return;
+    ThumbnailMemoryCache::getInstance()->insert(folderPreviewKey(dirPath, color), thumb->size(), false, dirModifyTime(index), thumb);
+    // made before a color scheme change; leave the item for the next request
+    if(color != settings->colorScheme().icons)
+        return;
+    view->setThumbnail(index, std::move(thumb));
+}
+
+// as seen by the model; keeps stat() out of the gui thread
+qint64 DirectoryPresenter::modifyTime(int fileIndex) const {
+    return static_cast<qint64>(model->fileEntryAt(fileIndex).modifyTime.time_since_epoch().count());
+}
+
+qint64 DirectoryPresenter::dirModifyTime(int dirIndex) const {
+    return static_cast<qint64>(model->dirEntryAt(dirIndex).modifyTime.time_since_epoch().count());
+}
+
+// previews are tinted with the icon color; keep those apart in the memory cache
+QString DirectoryPresenter::folderPreviewKey(const QString &dirPath, const QColor &color) {
+    return dirPath + "|" + color.name(QColor::HexArgb);
+}
+
 void DirectoryPresenter::onItemActivated(int absoluteIndex) {
     if(!model)
         return;
@@ -293,6 +342,22 @@ void DirectoryPresenter::selectAndFocus(QString path) {
     }
 }
 
+void DirectoryPresenter::selectAndFocus(QList<QString> paths) {
+    if(!model || !view)
+        return;
+    QList<int> indexes;
+    for(auto &path : paths) {
+        if(model->containsDir(path) && showDirs())
+            indexes << model->indexOfDir(path);
+        else if(model->containsFile(path))
+            indexes << (showDirs() ? model->indexOfFile(path) + model->dirCount() : model->indexOfFile(path));
+    }
+    if(indexes.isEmpty())
+        return;
+    view->select(indexes);
+    view->focusOn(indexes.last());
+}
+
 void DirectoryPresenter::selectAndFocus(int absoluteIndex) {
     if(!model || !view)
         return;
@@ -4,13 +4,11 @@
 #include <memory>
 #include "gui/idirectoryview.h"
 #include "components/thumbnailer/thumbnailer.h"
+#include "components/cache/thumbnailmemorycache.h"
 #include "directorymodel.h"
 #include "sharedresources.h"
 #include <QMimeData>
 
-//tmp
-#include <QtSvg/QSvgRenderer>
-
 class DirectoryPresenter : public QObject {
     Q_OBJECT
 public:
@@ -22,6 +20,8 @@ public:
 
     void selectAndFocus(int index);
     void selectAndFocus(QString path);
+    // the last one gets the focus
+    void selectAndFocus(QList<QString> paths);
 
     void onFileRemoved(QString filePath, int index);
     void onFileRenamed(QString fromPath, int indexFrom, QString toPath, int indexTo);
@@ -31,6 +31,7 @@ public:
     void onDirRemoved(QString dirPath, int index);
     void onDirRenamed(QString fromPath, int indexFrom, QString toPath, int indexTo);
     void onDirAdded(QString dirPath);
+    void onEntriesAdded(int dirCount, int fileCount);
 
     bool showDirs();
     void setShowDirs(bool mode);
@@ -50,7 +51,8 @@ public slots:
 
 private slots:
     void generateThumbnails(QList<int>, int, bool, bool);
-    void onThumbnailReady(std::shared_ptr<Thumbnail> thumb, QString filePath);
+    void onThumbnailReady(std::shared_ptr<Thumbnail> thumb, QString filePath, bool crop);
+    void onFolderPreviewReady(std::shared_ptr<Thumbnail> thumb, QString dirPath, QColor color);
     void populateView();
     void onItemActivated(int absoluteIndex);
     void onDraggedOut();
@@ -62,4 +64,7 @@ private:
     std::shared_ptr<DirectoryModel> model = nullptr;
     Thumbnailer thumbnailer;
     bool mShowDirs;
+    qint64 modifyTime(int fileIndex) const;
+    qint64 dirModifyTime(int dirIndex) const;
+    static QString folderPreviewKey(const QString &dirPath, const QColor &color);
 };
@@ -1,8 +1,9 @@
 #include "loader.h"
 
-Loader::Loader() {
+Loader::Loader() : cancelledCount(0), wastedTime(0) {
     pool = new QThreadPool(this);
-    pool->setMaxThreadCount(2);
+    // leave some cores for the gui & scaler
+    pool->setMaxThreadCount(qMax(2, QThread::idealThreadCount() / 2));
 }
 
 void Loader::clearTasks() {
@@ -22,14 +23,69 @@ std::shared_ptr<Image> Loader::load(QString path) {
     return ImageFactory::createImage(path);
 }
 
-// clears all buffered tasks before loading
+// drops all buffered tasks, then loads with the highest priority
+// an already existing task for this path gets promoted instead
+// running background tasks are left alone; see cancelExcept()
 void Loader::loadAsyncPriority(QString path) {
-    clearPool();
-    doLoadAsync(path, 1);
+    for(auto taskPath : tasks.keys()) {
+        auto other = tasks.value(taskPath);
+        if(taskPath == path)
+            continue;
+        if(pool->tryTake(other)) {
+            tasks.remove(taskPath);
+            delete other;
+        } else {
+            // already running; demote so cancelExcept() can drop it if unneeded
+            other->setPriority(LOAD_PRIORITY_BACKGROUND);
+        }
+    }
+    auto task = tasks.value(path, nullptr);
+    if(!task) {
+        doLoadAsync(path, LOAD_PRIORITY_CURRENT);
+        return;
+    }
+    task->setPriority(LOAD_PRIORITY_CURRENT);
+    if(pool->tryTake(task)) {
+        task->setPreviewSize(previewSize);
+        pool->start(task, LOAD_PRIORITY_CURRENT);
+    }
 }
 
 void Loader::loadAsync(QString path) {
-    doLoadAsync(path, 0);
+    doLoadAsync(path, LOAD_PRIORITY_BACKGROUND);
+}
+
+void Loader::loadAsync(QString path, int priority) {
+    doLoadAsync(path, priority);
+}
+
+// Only one file is current. Tasks still at that priority for other files were
+// started for images the user has moved past (possibly huge ones); demote them
+// so that the following cancelExcept() drops them unless they are preloads now.
+void Loader::setCurrent(QString path) {
+    for(auto taskPath : tasks.keys()) {
+        auto task = tasks.value(taskPath);
+        if(taskPath != path && task->priority() >= LOAD_PRIORITY_CURRENT)
+            task->setPriority(LOAD_PRIORITY_BACKGROUND);
+    }
+}
+
+// drops background tasks which are not in the list, including running ones
+void Loader::cancelExcept(QList<QString> paths) {
+    for(auto taskPath : tasks.keys()) {
+        if(tasks.value(taskPath)->priority() < LOAD_PRIORITY_CURRENT && !paths.contains(taskPath))
+            cancelTask(taskPath);
+    }
+}
+
+LoaderStats Loader::stats() const {
+    LoaderStats s;
+    for(auto task : tasks)
+        task->isStarted() ? s.running++ : s.queued++;
+    s.cancelling = cancelledTasks.count();
+    s.cancelled = cancelledCount;
+    s.wastedTime = wastedTime;
+    return s;
 }
 
 void Loader::doLoadAsync(QString path, int priority) {
@@ -37,15 +93,39 @@ void Loader::doLoadAsync(QString path, int priority) {
         return;
     }
 
-    auto runnable = new LoaderRunnable(path);
+    auto runnable = new LoaderRunnable(path, priority);
     runnable->setAutoDelete(false);
+    if(priority == LOAD_PRIORITY_CURRENT)
+        runnable->setPreviewSize(previewSize);
     tasks.insert(path, runnable);
+    connect(runnable, &LoaderRunnable::previewReady, this, &Loader::onPreviewReady, Qt::UniqueConnection);
     connect(runnable, &LoaderRunnable::finished, this, &Loader::onLoadFinished, Qt::UniqueConnection);
     pool->start(runnable, priority);
 }
 
+void Loader::setPreviewSize(QSize size) {
+    previewSize = size;
+}
+
+void Loader::onPreviewReady(std::shared_ptr<const QImage> preview, const QString &path) {
+    auto task = qobject_cast<LoaderRunnable*>(sender());
+    if(cancelledTasks.contains(task) || tasks.value(path) != task)
+        return;
+    emit previewReady(preview, path);
+}
+
 void Loader::onLoadFinished(std::shared_ptr<Image> image, const QString &path) {
-    auto task = tasks.take(path);
+    auto task = qobject_cast<LoaderRunnable*>(sender());
+    if(cancelledTasks.remove(task)) {
+        wastedTime += task->elapsed();
+        LoaderStats s = stats();
+        qDebug() << "[Loader] dropped" << path << "after" << task->elapsed() << "ms;"
+                 << s.queued << "queued," << s.running << "running," << s.cancelling << "cancelling;"
+                 << s.cancelled << "cancelled so far," << s.wastedTime << "ms wasted";
+        delete task;
+        return;
+    }
+    tasks.remove(path);
     delete task;
     if(!image)
         emit loadFailed(path);
@@ -54,11 +134,21 @@ void Loader::onLoadFinished(std::shared_ptr<Image> image, const QString &path) {
 }
 
 void Loader::clearPool() {
-    QHashIterator<QString, LoaderRunnable*> i(tasks);
-    while (i.hasNext()) {
-        i.next();
-        if(pool->tryTake(i.value())) {
-            delete tasks.take(i.key());
-        }
+    for(auto taskPath : tasks.keys())
+        cancelTask(taskPath);
+}
+
+// Removes the task if it did not start yet.
+// Otherwise tell it to stop; decoder will bail out on the next read.
+void Loader::cancelTask(QString path) {
+    auto task = tasks.take(path);
+    if(!task)
+        return;
+    cancelledCount++;
+    if(pool->tryTake(task)) {
+        delete task;
+    } else {
+        task->cancel();
+        cancelledTasks.insert(task);
     }
 }
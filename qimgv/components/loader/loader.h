@@ -1,9 +1,25 @@
 #pragma once
 
 #include <QThreadPool>
+#include <QThread>
+#include <QSet>
 #include "components/cache/thumbnailcache.h"
 #include "loaderrunnable.h"
 
+enum LoadPriority {
+    LOAD_PRIORITY_BACKGROUND = 0,
+    LOAD_PRIORITY_PRELOAD    = 50, // minus position in the preload list
+    LOAD_PRIORITY_CURRENT    = 100
+};
+
+struct LoaderStats {
+    int queued = 0;
+    int running = 0;
+    int cancelling = 0; // cancelled, but the decoder has not returned yet
+    quint64 cancelled = 0;
+    qint64 wastedTime = 0; // ms spent on decodes that were thrown away
+};
+
 class Loader : public QObject {
     Q_OBJECT
 public:
@@ -11,20 +27,34 @@ public:
     std::shared_ptr<Image> load(QString path);
     void loadAsyncPriority(QString path);
     void loadAsync(QString path);
+    void loadAsync(QString path, int priority);
+    void setCurrent(QString path);
+    void cancelExcept(QList<QString> paths);
 
     void clearTasks();
     bool isBusy() const;
     bool isLoading(QString path);
+    LoaderStats stats() const;
+    // screen-sized preview for the priority loads; empty disables it
+    void setPreviewSize(QSize size);
 private:
     QHash<QString, LoaderRunnable*> tasks;
-    QThreadPool *pool;    
+    // running tasks we have given up on; deleted when they return
+    QSet<LoaderRunnable*> cancelledTasks;
+    QThreadPool *pool;
+    quint64 cancelledCount;
+    qint64 wastedTime;
+    QSize previewSize;
     void clearPool();
+    void cancelTask(QString path);
     void doLoadAsync(QString path, int priority);
 
 signals:
+    void previewReady(std::shared_ptr<const QImage>, const QString &path);
     void loadFinished(std::shared_ptr<Image>, const QString &path);
     void loadFailed(const QString &path);
 
 private slots:
+    void onPreviewReady(std::shared_ptr<const QImage>, const QString&);
     void onLoadFinished(std::shared_ptr<Image>, const QString&);
 };
@@ -2,13 +2,50 @@
 
 #include <QElapsedTimer>
 
-LoaderRunnable::LoaderRunnable(QString _path) : path(_path) {
+LoaderRunnable::LoaderRunnable(QString _path, int _priority)
+    : path(_path),
+      mPriority(_priority),
+      cancelFlag(new std::atomic_bool(false)),
+      started(false),
+      mElapsed(0)
+{
 }
 
 void LoaderRunnable::run() {
-    //QElapsedTimer t;
-    //t.start();
-    auto image = ImageFactory::createImage(path);
-    //qDebug() << "L: " << t.elapsed();
+    started = true;
+    QElapsedTimer t;
+    t.start();
+    if(previewSize.isValid()) {
+        auto preview = ImageFactory::createPreview(path, previewSize);
+        if(preview && !cancelFlag->load())
+            emit previewReady(preview, path);
+    }
+    auto image = ImageFactory::createImage(path, cancelFlag);
+    mElapsed = t.elapsed();
+    //qDebug() << "L: " << mElapsed;
     emit finished(image, path);
 }
+
+int LoaderRunnable::priority() const {
+    return mPriority;
+}
+
+void LoaderRunnable::setPriority(int _priority) {
+    mPriority = _priority;
+}
+
+void LoaderRunnable::cancel() {
+    *cancelFlag = true;
+}
+
+bool LoaderRunnable::isStarted() const {
+    return started;
+}
+
+qint64 LoaderRunnable::elapsed() const {
+    return mElapsed;
+}
+
+void LoaderRunnable::setPreviewSize(QSize size) {
+    previewSize = size;
+}
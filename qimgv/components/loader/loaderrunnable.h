@@ -2,17 +2,31 @@
 
 #include <QObject>
 #include <QRunnable>
+#include <atomic>
 #include "utils/imagefactory.h"
 
 class LoaderRunnable: public QObject, public QRunnable
 {
     Q_OBJECT
 public:
-    LoaderRunnable(QString _path);
+    LoaderRunnable(QString _path, int _priority);
     void run();
+    int priority() const;
+    void setPriority(int _priority);
+    void cancel();
+    bool isStarted() const;
+    qint64 elapsed() const;
+    // if set, a reduced version is decoded & sent first. set before start
+    void setPreviewSize(QSize size);
 private:
     QString path;
+    int mPriority;
+    QSize previewSize;
+    std::shared_ptr<std::atomic_bool> cancelFlag;
+    std::atomic_bool started;
+    std::atomic<qint64> mElapsed;
 signals:
+    void previewReady(std::shared_ptr<const QImage>, QString);
     void finished(std::shared_ptr<Image>, QString);
     void failed(QString);
 };
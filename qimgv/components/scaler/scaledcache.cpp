@@ -0,0 +1,75 @@
+#include "scaledcache.h"
+
+ScaledCache::ScaledCache(qint64 _memoryLimit) : memoryLimit(_memoryLimit), usage(0) {
+}
+
+bool ScaledCache::isCacheable(const ScalerRequest &req) {
+    return req.image && req.image->type() == STATIC;
+}
+
+bool ScaledCache::find(const ScalerRequest &req, QPixmap &result) {
+    removeStale();
+    if(!isCacheable(req))
+        return false;
+    auto source = req.image->getImage();
+    for(int i = 0; i < entries.count(); i++) {
+        const Entry &e = entries.at(i);
+        if(e.image == req.image.get() && e.size == req.size && e.filter == req.filter &&
+           e.source.lock() == source)
+        {
+            result = e.pixmap;
+            entries.move(i, 0);
+            return true;
+        }
+    }
+    return false;
+}
+
+void ScaledCache::insert(const ScalerRequest &req, const QPixmap &pixmap) {
+    removeStale();
+    if(!isCacheable(req) || pixmap.isNull())
+        return;
+    // image was edited while scaling; this result is useless
+    auto source = req.source.lock();
+    if(!source || source != req.image->getImage())
+        return;
+    qint64 bytes = static_cast<qint64>(pixmap.width()) * pixmap.height() * pixmap.depth() / 8;
+    if(bytes > memoryLimit)
+        return;
+    for(int i = 0; i < entries.count(); i++) {
+        const Entry &e = entries.at(i);
+        if(e.image == req.image.get() && e.size == req.size && e.filter == req.filter) {
+            removeAt(i);
+            break;
+        }
+    }
+    while(!entries.isEmpty() && usage + bytes > memoryLimit)
+        removeAt(entries.count() - 1);
+    entries.prepend({ req.image.get(), source, req.size, req.filter, pixmap, bytes });
+    usage += bytes;
+}
+
+void ScaledCache::clear() {
+    entries.clear();
+    usage = 0;
+}
+
+qint64 ScaledCache::memoryUsage() const {
+    return usage;
+}
+
+int ScaledCache::count() const {
+    return entries.count();
+}
+
+void ScaledCache::removeStale() {
+    for(int i = entries.count() - 1; i >= 0; i--) {
+        if(entries.at(i).source.expired())
+            removeAt(i);
+    }
+}
+
+void ScaledCache::removeAt(int index) {
+    usage -= entries.at(index).bytes;
+    entries.removeAt(index);
+}
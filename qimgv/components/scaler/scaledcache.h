@@ -0,0 +1,35 @@
+#pragma once
+
+#include <QPixmap>
+#include <QList>
+#include "scalerrequest.h"
+
+// Recently produced scaling results. Least recently used ones are dropped first.
+// Entries are tied to the exact QImage that was scaled, so they go stale on their
+// own when the image gets edited or unloaded.
+// GUI thread only.
+class ScaledCache {
+public:
+    explicit ScaledCache(qint64 _memoryLimit);
+    // only static images are cached
+    static bool isCacheable(const ScalerRequest &req);
+    bool find(const ScalerRequest &req, QPixmap &result);
+    void insert(const ScalerRequest &req, const QPixmap &pixmap);
+    void clear();
+    qint64 memoryUsage() const;
+    int count() const;
+
+private:
+    struct Entry {
+        const Image *image;
+        std::weak_ptr<const QImage> source;
+        QSize size;
+        ScalingFilter filter;
+        QPixmap pixmap;
+        qint64 bytes;
+    };
+    QList<Entry> entries; // most recently used first
+    qint64 memoryLimit, usage;
+    void removeStale();
+    void removeAt(int index);
+};
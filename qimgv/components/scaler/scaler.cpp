@@ -4,8 +4,9 @@
  * 1 request comes
  * 2 we run it
  * 3a if during scaling no new requests came, we return the result and forget about it. end.
- * 3b if some requests did come, by the end of current task we dispose of its result,
- *    start the last task that came and ignore the middle ones.
+ * 3b if some requests did come, the current task is cancelled. Scaling stops
+ *    after the row it is working on, then we start the last task that came
+ *    and ignore the middle ones.
  */
 
 Scaler::Scaler(Cache *_cache, QObject *parent)
@@ -13,7 +14,11 @@ Scaler::Scaler(Cache *_cache, QObject *parent)
       buffered(false),
       running(false),
       currentRequestTimestamp(0),
-      cache(_cache)
+      cache(_cache),
+      resultCache(RESULT_CACHE_SIZE),
+      requestCounter(0),
+      lastHitSerial(0),
+      prescaling(false)
 {
     sem = new QSemaphore(1);
     pool = new QThreadPool(this);
@@ -24,9 +29,28 @@ Scaler::Scaler(Cache *_cache, QObject *parent)
     connect(runnable, &ScalerRunnable::started, this, &Scaler::onTaskStart, Qt::DirectConnection);
     connect(runnable, &ScalerRunnable::finished, this, &Scaler::onTaskFinish, Qt::DirectConnection);
     connect(this, &Scaler::acceptScalingResult, this, &Scaler::slotForwardScaledResult, Qt::QueuedConnection);
+
+    prescalePool = new QThreadPool(this);
+    prescalePool->setMaxThreadCount(1);
+    prescaleRunnable = new ScalerRunnable();
+    prescaleRunnable->setAutoDelete(false);
+    connect(prescaleRunnable, &ScalerRunnable::finished, this, &Scaler::onPrescaleFinished, Qt::QueuedConnection);
 }
 
 void Scaler::requestScaled(ScalerRequest req) {
+    req.serial = ++requestCounter;
+    QPixmap cached;
+    if(resultCache.find(req, cached)) {
+        sem->acquire(1);
+        // whatever is running or queued now is older than this
+        lastHitSerial = req.serial;
+        if(running)
+            runnable->cancel();
+        sem->release(1);
+        // right away, so that a freshly opened image gets it before the first paint
+        emit scalingFinished(new QPixmap(cached), req);
+        return;
+    }
     sem->acquire(1);
     if(!running) {
 //////////////////////////////////
@@ -74,6 +98,9 @@ void Scaler::requestScaled(ScalerRequest req) {
                 buffered = true;
             }
         }
+        // result of the running task would be thrown away anyway
+        if(!(bufferedRequest == startedRequest))
+            runnable->cancel();
     }
     sem->release(1);
 }
@@ -86,6 +113,11 @@ void Scaler::onTaskStart(ScalerRequest req) {
         buffered = false;
     }
     startedRequest = req;
+    // something newer came in while we were queued
+    if(buffered || req.serial < lastHitSerial)
+        runnable->cancel();
+    else
+        runnable->resetCancel();
   //qDebug() << "onTaskStart(): " << req.image->name();
     sem->release(1);
 }
@@ -108,7 +140,8 @@ void Scaler::onTaskFinish(QImage *scaled, ScalerRequest req) {
         sem->release(1);
     } else {
         sem->release(1);
-        emit acceptScalingResult(scaled, req);
+        if(scaled)
+            emit acceptScalingResult(scaled, req);
     }
 }
 
@@ -120,10 +153,58 @@ void Scaler::slotForwardScaledResult(QImage *image, ScalerRequest req) {
     QPixmap *pixmap = new QPixmap();
     *pixmap = QPixmap::fromImage(*image);
     delete image;
+    resultCache.insert(req, *pixmap);
+    // a cached result was shown after this one was requested
+    if(req.serial < lastHitSerial) {
+        delete pixmap;
+        return;
+    }
     emit scalingFinished(pixmap, req);
 }
 
+void Scaler::clearResultCache() {
+    resultCache.clear();
+}
+
 void Scaler::startRequest(ScalerRequest req) {
     runnable->setRequest(req);
     pool->start(runnable);
 }
+
+void Scaler::prescale(QList<ScalerRequest> requests) {
+    prescaleQueue.clear();
+    QPixmap cached;
+    for(auto req : requests) {
+        if(!ScaledCache::isCacheable(req) || resultCache.find(req, cached))
+            continue;
+        prescaleQueue.append(req);
+    }
+    if(prescaling) {
+        int index = prescaleQueue.indexOf(prescaleCurrent);
+        if(index >= 0)
+            prescaleQueue.removeAt(index);
+        else
+            prescaleRunnable->cancel();
+    } else {
+        startPrescale();
+    }
+}
+
+void Scaler::startPrescale() {
+    if(prescaling || prescaleQueue.isEmpty())
+        return;
+    prescaling = true;
+    prescaleCurrent = prescaleQueue.takeFirst();
+    prescaleRunnable->resetCancel();
+    prescaleRunnable->setRequest(prescaleCurrent);
+    prescalePool->start(prescaleRunnable);
+}
+
+void Scaler::onPrescaleFinished(QImage *image, ScalerRequest req) {
+    prescaling = false;
+    if(image) {
+        resultCache.insert(req, QPixmap::fromImage(*image));
+        delete image;
+    }
+    startPrescale();
+}
@@ -7,11 +7,16 @@
 #include "components/cache/cache.h"
 #include "scalerrequest.h"
 #include "scalerrunnable.h"
+#include "scaledcache.h"
 
 class Scaler : public QObject {
     Q_OBJECT
 public:
     explicit Scaler(Cache *_cache, QObject *parent = nullptr);
+    void clearResultCache();
+    // Scales these in the background so that later requests are served from cache.
+    // Replaces the previous list.
+    void prescale(QList<ScalerRequest> requests);
 
 signals:
     void scalingFinished(QPixmap* result, ScalerRequest request);
@@ -26,6 +31,7 @@ private slots:
     void onTaskFinish(QImage* scaled, ScalerRequest req);
     void slotStartBufferedRequest();
     void slotForwardScaledResult(QImage *image, ScalerRequest req);
+    void onPrescaleFinished(QImage *image, ScalerRequest req);
 
 private:
     QThreadPool *pool;
@@ -35,8 +41,20 @@ private:
     ScalerRequest bufferedRequest, startedRequest;
 
     Cache *cache;
+    ScaledCache resultCache;
+    // both are only written from the gui thread
+    quint64 requestCounter, lastHitSerial;
+    const qint64 RESULT_CACHE_SIZE = 128 * 1024 * 1024;
 
     void startRequest(ScalerRequest req);
 
+    // background pre-scaling, gui thread only
+    QThreadPool *prescalePool;
+    ScalerRunnable *prescaleRunnable;
+    QList<ScalerRequest> prescaleQueue;
+    ScalerRequest prescaleCurrent;
+    bool prescaling;
+    void startPrescale();
+
     QSemaphore *sem;
 };
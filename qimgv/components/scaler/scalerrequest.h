@@ -7,12 +7,16 @@
 
 class ScalerRequest {
 public:
-    ScalerRequest() : image(nullptr), size(QSize(0,0)), filter(QI_FILTER_BILINEAR) { }
-    ScalerRequest(std::shared_ptr<Image> _image, QSize _size, QString _path, ScalingFilter _filter) : image(_image), size(_size), path(_path), filter(_filter) {}
+    ScalerRequest() : image(nullptr), size(QSize(0,0)), filter(QI_FILTER_BILINEAR), serial(0) { }
+    ScalerRequest(std::shared_ptr<Image> _image, QSize _size, QString _path, ScalingFilter _filter) : image(_image), size(_size), path(_path), filter(_filter), serial(0) {}
     std::shared_ptr<Image> image;
     QSize size;
     QString path;
     ScalingFilter filter;
+    // set by Scaler; newer requests have higher numbers
+    quint64 serial;
+    // image data that was actually scaled. set by ScalerRunnable
+    std::weak_ptr<const QImage> source;
 
     bool operator==(const ScalerRequest &another) const {
         if(another.image == image && another.size == size && another.filter == filter)
@@ -2,23 +2,37 @@
 
 #include <QElapsedTimer>
 
-ScalerRunnable::ScalerRunnable() {
+ScalerRunnable::ScalerRunnable() : cancelFlag(false) {
 }
 
 void ScalerRunnable::setRequest(ScalerRequest r) {
     req = r;
 }
 
+void ScalerRunnable::cancel() {
+    cancelFlag = true;
+}
+
+void ScalerRunnable::resetCancel() {
+    cancelFlag = false;
+}
+
 void ScalerRunnable::run() {
     emit started(req);
     //QElapsedTimer t;
     //t.start();
     QImage *scaled = nullptr;
+    auto source = req.image->getImage();
+    req.source = source;
     if(req.filter == 0 || (req.size.width() > req.image->width() && !settings->smoothUpscaling())) {
-        scaled = ImageLib::scaled(req.image->getImage(), req.size, QI_FILTER_NEAREST);
+        scaled = ImageLib::scaled(source, req.size, QI_FILTER_NEAREST);
     } else {
-        scaled = ImageLib::scaled(req.image->getImage(), req.size, req.filter);
+        // when downscaling start from the nearest larger mipmap instead of full size
+        auto staticImage = std::dynamic_pointer_cast<ImageStatic>(req.image);
+        if(staticImage && req.size.width() < source->width())
+            source = staticImage->getMipmap(req.size);
+        scaled = ImageLib::scaledCancellable(source, req.size, req.filter, &cancelFlag);
     }
-    //qDebug() << ">> " << req.size << ": " << t.elapsed();
+    //qDebug() << ">> " << req.size << ": " << t.elapsed() << (scaled ? "" : "(cancelled)");
     emit finished(scaled, req);
 }
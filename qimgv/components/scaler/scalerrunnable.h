@@ -4,7 +4,9 @@
 #include <QRunnable>
 #include <QThread>
 #include <QDebug>
+#include <atomic>
 #include "components/cache/cache.h"
+#include "sourcecontainers/imagestatic.h"
 #include "scalerrequest.h"
 #include "utils/imagelib.h"
 #include "settings.h"
@@ -16,11 +18,15 @@ public:
     explicit ScalerRunnable();
     void setRequest(ScalerRequest r);
     void run();
+    // abort the current run as soon as possible; finished() is emitted with nullptr
+    void cancel();
+    void resetCancel();
 signals:
     void started(ScalerRequest);
     void finished(QImage*, ScalerRequest);
 
 private:
     ScalerRequest req;
+    std::atomic_bool cancelFlag;
     const float CMPL_FALLBACK_THRESHOLD = 70.0; // equivalent of ~ 5000x3500 @ 32bpp
 };
@@ -0,0 +1,104 @@
+#include "folderpreviewrunnable.h"
+
+#include <QApplication>
+
+FolderPreviewRunnable::FolderPreviewRunnable(ThumbnailCache* _cache, ThumbnailTaskQueue *_queue, QRegularExpression _filter, VideoThumbnailHelperPool *_videoHelpers) :
+    cache(_cache),
+    queue(_queue),
+    filter(_filter),
+    videoHelpers(_videoHelpers)
+{
+}
+
+void FolderPreviewRunnable::run() {
+    ThumbnailTask task;
+    while(queue->take(task)) {
+        std::shared_ptr<Thumbnail> thumbnail = generate(cache, task.path, task.size, task.color, filter, task.cancel.get(), videoHelpers);
+        queue->finish(task, thumbnail != nullptr);
+        if(thumbnail)
+            emit taskEnd(thumbnail, task.path, task.color);
+    }
+}
+
+QString FolderPreviewRunnable::generateIdString(QString dirPath, int size, QColor color) {
+    QString queryStr = "folder:" + dirPath + QString::number(size) + color.name(QColor::HexArgb);
+    return QString(QCryptographicHash::hash(queryStr.toUtf8(), QCryptographicHash::Md5).toHex());
+}
+
+std::shared_ptr<Thumbnail> FolderPreviewRunnable::generate(ThumbnailCache *cache, QString dirPath, int size, QColor color, const QRegularExpression &filter,
+                                                           const std::atomic_bool *cancel, VideoThumbnailHelperPool *videoHelpers)
+{
+    if(cancel && *cancel)
+        return nullptr;
+    QFileInfo info(dirPath);
+    // changes when files are added / removed / renamed; good enough
+    QString time = QString::number(info.lastModified().toMSecsSinceEpoch());
+    QString id = generateIdString(dirPath, size, color);
+    std::unique_ptr<QImage> image;
+
+    if(cache) {
+        image.reset(cache->readThumbnail(id));
+        if(image && image->text("lastModified") != time)
+            image.reset(nullptr);
+    }
+
+    if(!image) {
+        QImage icon = shrRes->folderIcon(size, color);
+        QStringList files = previewFiles(dirPath, filter, cancel);
+        if(cancel && *cancel)
+            return nullptr;
+        image.reset(new QImage(icon));
+        // The icon is 32x24 units; everything below the tab (y >= 3) is the body.
+        // Up to 2x2 tiles in the middle of it.
+        int unit = qMax(1, icon.width() / 32);
+        int gap = unit;
+        int tileSize = qMax(1, (17 * unit - gap) / 2);
+        QPoint origin((icon.width() - tileSize * 2 - gap) / 2,
+                      3 * unit + (21 * unit - tileSize * 2 - gap) / 2);
+        QPainter p(image.get());
+        p.setRenderHint(QPainter::SmoothPixmapTransform);
+        int drawn = 0;
+        for(auto &file : files) {
+            auto thumb = ThumbnailerRunnable::generate(cache, file, tileSize, true, false, cancel, videoHelpers);
+            if(!thumb)
+                return nullptr;
+            if(!thumb->pixmap() || thumb->pixmap()->isNull())
+                continue;
+            QRect rect(origin.x() + (drawn % 2) * (tileSize + gap),
+                       origin.y() + (drawn / 2) * (tileSize + gap),
+                       tileSize, tileSize);
+            // thumbnails are cropped to a square; just scale to the tile
+            p.drawImage(rect, thumb->pixmap()->toImage());
+            if(++drawn == PREVIEW_COUNT)
+                break;
+        }
+        p.end();
+        image->setText("lastModified", time);
+        image->setText("sourcePath", dirPath);
+        if(cache)
+            cache->saveThumbnail(image.get(), id);
+    }
+    auto && tmpPixmap = new QPixmap(image->size());
+    *tmpPixmap = QPixmap::fromImage(*image);
+    tmpPixmap->setDevicePixelRatio(qApp->devicePixelRatio());
+    std::shared_ptr<QPixmap> pixmapPtr(tmpPixmap);
+    std::shared_ptr<Thumbnail> thumbnail(new Thumbnail(info.fileName(), "Folder", size, pixmapPtr));
+    return thumbnail;
+}
+
+// First few supported files by name. Only looks at the first MAX_SCAN
+// entries so that huge folders don't take forever.
+QStringList FolderPreviewRunnable::previewFiles(QString dirPath, const QRegularExpression &filter, const std::atomic_bool *cancel) {
+    QStringList paths;
+    QDirIterator it(dirPath, QDir::Files | QDir::Readable);
+    int scanned = 0;
+    while(it.hasNext() && scanned++ < MAX_SCAN) {
+        if(cancel && *cancel)
+            break;
+        it.next();
+        if(filter.match(it.fileName()).hasMatch())
+            paths.append(it.filePath());
+    }
+    std::sort(paths.begin(), paths.end());
+    return paths;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <QRunnable>
+#include <QDirIterator>
+#include <QRegularExpression>
+#include <QCryptographicHash>
+#include <QPainter>
+#include "sourcecontainers/thumbnail.h"
+#include "components/cache/thumbnailcache.h"
+#include "components/thumbnailer/thumbnailtaskqueue.h"
+#include "components/thumbnailer/thumbnailerrunnable.h"
+#include "sharedresources.h"
+#include "settings.h"
+#include <memory>
+
+// Worker; makes folder previews from the queue until it is empty.
+// A preview is the folder icon with thumbnails of the first few images
+// inside it drawn on top. Cached like the regular thumbnails, and
+// remade when the folder modification time changes.
+class FolderPreviewRunnable : public QObject, public QRunnable {
+    Q_OBJECT
+public:
+    FolderPreviewRunnable(ThumbnailCache* _cache, ThumbnailTaskQueue *_queue, QRegularExpression _filter, VideoThumbnailHelperPool *_videoHelpers);
+    void run();
+    // Returns nullptr if *cancel got set before it was done.
+    // Color is that of the folder icon; read it on the gui thread.
+    static std::shared_ptr<Thumbnail> generate(ThumbnailCache *cache, QString dirPath, int size, QColor color, const QRegularExpression &filter,
+                                               const std::atomic_bool *cancel = nullptr, VideoThumbnailHelperPool *videoHelpers = nullptr);
+
+private:
+    static QString generateIdString(QString dirPath, int size, QColor color);
+    static QStringList previewFiles(QString dirPath, const QRegularExpression &filter, const std::atomic_bool *cancel);
+    ThumbnailCache* cache = nullptr;
+    ThumbnailTaskQueue *queue;
+    QRegularExpression filter;
+    VideoThumbnailHelperPool *videoHelpers;
+
+    static const int PREVIEW_COUNT = 4;
+    // give up looking for images after this many entries
+    static const int MAX_SCAN = 500;
+
+signals:
+    void taskEnd(std::shared_ptr<Thumbnail>, QString, QColor);
+};
@@ -0,0 +1,85 @@
+#include "thumbnailbatch.h"
+
+ThumbnailBatch::ThumbnailBatch(QStringList _paths, QList<int> _sizes, bool _crop, int _threads)
+    : paths(_paths),
+      sizes(_sizes),
+      crop(_crop),
+      videoHelpers(qMax(1, _threads)),
+      next(0),
+      cancelled(false)
+{
+    pool.setMaxThreadCount(qMax(1, _threads));
+    mStats.files = paths.count();
+}
+
+ThumbnailBatch::~ThumbnailBatch() {
+    cancel();
+    pool.waitForDone();
+}
+
+void ThumbnailBatch::run(const std::function<void(const ThumbnailBatchStats&)> &progress, int interval) {
+    timer.start();
+    for(int i = 0; i < pool.maxThreadCount(); i++)
+        pool.start(new ThumbnailBatchRunnable(this));
+    while(!pool.waitForDone(interval)) {
+        if(progress)
+            progress(stats());
+    }
+    // everything that is still queued for writing
+    cache.flush();
+    mutex.lock();
+    mStats.interrupted = cancelled && mStats.processed < mStats.files;
+    mutex.unlock();
+}
+
+void ThumbnailBatch::cancel() {
+    cancelled = true;
+}
+
+ThumbnailBatchStats ThumbnailBatch::stats() {
+    QMutexLocker locker(&mutex);
+    ThumbnailBatchStats s = mStats;
+    s.elapsed = timer.isValid() ? timer.elapsed() : 0;
+    return s;
+}
+
+void ThumbnailBatch::process(const QString &path) {
+    auto result = ThumbnailerRunnable::cacheSizes(&cache, path, sizes, crop, &cancelled, &videoHelpers);
+    if(result == ThumbnailerRunnable::CACHE_CANCELLED)
+        return;
+    qint64 bytes = (result == ThumbnailerRunnable::CACHE_GENERATED) ? QFileInfo(path).size() : 0;
+    QMutexLocker locker(&mutex);
+    mStats.processed++;
+    switch(result) {
+    case ThumbnailerRunnable::CACHE_SKIPPED:
+        mStats.skipped++;
+        break;
+    case ThumbnailerRunnable::CACHE_GENERATED:
+        mStats.generated++;
+        mStats.bytesRead += bytes;
+        break;
+    case ThumbnailerRunnable::CACHE_FAILED:
+        mStats.failed++;
+        mStats.failedPaths.append(path);
+        break;
+    case ThumbnailerRunnable::CACHE_UNSUPPORTED:
+        mStats.unsupported++;
+        break;
+    case ThumbnailerRunnable::CACHE_CANCELLED:
+        break;
+    }
+}
+
+//------------------------------------------------------------------------------
+
+ThumbnailBatchRunnable::ThumbnailBatchRunnable(ThumbnailBatch *_batch) : batch(_batch) {
+}
+
+void ThumbnailBatchRunnable::run() {
+    while(!batch->cancelled) {
+        int i = batch->next++;
+        if(i >= batch->paths.count())
+            break;
+        batch->process(batch->paths.at(i));
+    }
+}
@@ -0,0 +1,68 @@
+#pragma once
+
+#include <QThreadPool>
+#include <QRunnable>
+#include <QStringList>
+#include <QFileInfo>
+#include <QElapsedTimer>
+#include <QMutex>
+#include <atomic>
+#include <functional>
+#include "components/thumbnailer/thumbnailerrunnable.h"
+#include "components/cache/thumbnailcache.h"
+
+struct ThumbnailBatchStats {
+    int files = 0;
+    int processed = 0;
+    int skipped = 0;      // already in the cache
+    int generated = 0;
+    int failed = 0;
+    int unsupported = 0;
+    qint64 bytesRead = 0; // size of the generated files
+    qint64 elapsed = 0;   // ms
+    bool interrupted = false;
+    QStringList failedPaths;
+};
+
+// Headless thumbnail generation for a list of files (--gen-thumbs).
+// Each file is decoded once for all sizes, and files that already have valid
+// thumbnails are skipped without decoding, so an interrupted run can simply be
+// started again.
+class ThumbnailBatch {
+public:
+    ThumbnailBatch(QStringList _paths, QList<int> _sizes, bool _crop, int _threads);
+    ~ThumbnailBatch();
+    // Blocks until done or cancelled. Calls progress from the calling thread
+    // every interval ms.
+    void run(const std::function<void(const ThumbnailBatchStats&)> &progress, int interval);
+    // thread safe; files that are already being worked on are stopped as well
+    // and are not counted as processed
+    void cancel();
+    ThumbnailBatchStats stats();
+
+private:
+    friend class ThumbnailBatchRunnable;
+    QStringList paths;
+    QList<int> sizes;
+    bool crop;
+    QThreadPool pool;
+    ThumbnailCache cache;
+    VideoThumbnailHelperPool videoHelpers;
+    QElapsedTimer timer;
+    std::atomic_int next;
+    std::atomic_bool cancelled;
+    QMutex mutex;
+    ThumbnailBatchStats mStats;
+
+    void process(const QString &path);
+};
+
+// Worker; takes the next file until there are none left
+class ThumbnailBatchRunnable : public QRunnable {
+public:
+    explicit ThumbnailBatchRunnable(ThumbnailBatch *_batch);
+    void run() override;
+
+private:
+    ThumbnailBatch *batch;
+};
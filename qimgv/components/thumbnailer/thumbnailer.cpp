@@ -8,19 +8,28 @@ Thumbnailer::Thumbnailer() {
     if(threads > globalThreads)
         threads = globalThreads;
     pool->setMaxThreadCount(threads);
+    queue = new ThumbnailTaskQueue(threads);
+    // mostly waiting on the disk; don't let it take all the threads
+    folderQueue = new ThumbnailTaskQueue(qMax(1, threads / 2));
+    // each one is a libmpv instance
+    videoHelpers = new VideoThumbnailHelperPool(qMax(1, threads / 2));
+    folderPreviewFilter.setPattern(settings->supportedFormatsRegex());
+    folderPreviewFilter.setPatternOptions(QRegularExpression::CaseInsensitiveOption);
 }
 
 Thumbnailer::~Thumbnailer() {
-    pool->clear();
+    queue->cancelAll();
+    folderQueue->cancelAll();
     pool->waitForDone();
+    delete queue;
+    delete folderQueue;
+    delete videoHelpers;
+    delete cache;
 }
 
 void Thumbnailer::waitForDone() {
     pool->waitForDone();
-}
-
-void Thumbnailer::clearTasks() {
-    pool->clear();
+    cache->flush();
 }
 
 std::shared_ptr<Thumbnail> Thumbnailer::getThumbnail(QString filePath, int size) {
@@ -28,23 +37,57 @@ std::shared_ptr<Thumbnail> Thumbnailer::getThumbnail(QString filePath, int size)
 }
 
 void Thumbnailer::getThumbnailAsync(QString path, int size, bool crop, bool force) {
-    if(!runningTasks.contains(path, size))
-        startThumbnailerThread(path, size, crop, force);
+    ThumbnailTask task;
+    task.path = path;
+    task.size = size;
+    task.crop = crop;
+    task.force = force;
+    startWorkers(queue->addTask(task));
+}
+
+void Thumbnailer::requestThumbnails(QList<QString> paths, int size, bool crop, bool force) {
+    QList<ThumbnailTask> tasks;
+    for(auto path : paths) {
+        ThumbnailTask task;
+        task.path = path;
+        task.size = size;
+        task.crop = crop;
+        task.force = force;
+        tasks.append(task);
+    }
+    startWorkers(queue->setTasks(tasks));
+}
+
+void Thumbnailer::requestFolderPreviews(QList<QString> dirPaths, int size, QColor color) {
+    QList<ThumbnailTask> tasks;
+    for(auto path : dirPaths) {
+        ThumbnailTask task;
+        task.path = path;
+        task.size = size;
+        task.color = color;
+        tasks.append(task);
+    }
+    startFolderWorkers(folderQueue->setTasks(tasks));
 }
 
-void Thumbnailer::startThumbnailerThread(QString filePath, int size, bool crop, bool force) {
-    auto runnable = new ThumbnailerRunnable(settings->useThumbnailCache() ? cache : nullptr, filePath, size, crop, force);
-    connect(runnable, &ThumbnailerRunnable::taskStart, this, &Thumbnailer::onTaskStart);
-    connect(runnable, &ThumbnailerRunnable::taskEnd, this, &Thumbnailer::onTaskEnd);
-    runnable->setAutoDelete(true);
-    pool->start(runnable);
+void Thumbnailer::startWorkers(int count) {
+    for(int i = 0; i < count; i++) {
+        auto runnable = new ThumbnailerRunnable(settings->useThumbnailCache() ? cache : nullptr, queue, videoHelpers);
+        connect(runnable, &ThumbnailerRunnable::taskEnd, this, &Thumbnailer::onTaskEnd);
+        runnable->setAutoDelete(true);
+        pool->start(runnable);
+    }
 }
 
-void Thumbnailer::onTaskStart(QString filePath, int size) {
-    runningTasks.insert(filePath, size);
+void Thumbnailer::startFolderWorkers(int count) {
+    for(int i = 0; i < count; i++) {
+        auto runnable = new FolderPreviewRunnable(settings->useThumbnailCache() ? cache : nullptr, folderQueue, folderPreviewFilter, videoHelpers);
+        connect(runnable, &FolderPreviewRunnable::taskEnd, this, &Thumbnailer::folderPreviewReady);
+        runnable->setAutoDelete(true);
+        pool->start(runnable);
+    }
 }
 
-void Thumbnailer::onTaskEnd(std::shared_ptr<Thumbnail> thumbnail, QString filePath) {
-    runningTasks.remove(filePath, thumbnail->size());
-    emit thumbnailReady(thumbnail, filePath);
+void Thumbnailer::onTaskEnd(std::shared_ptr<Thumbnail> thumbnail, QString filePath, bool crop) {
+    emit thumbnailReady(thumbnail, filePath, crop);
 }
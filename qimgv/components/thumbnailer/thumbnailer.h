@@ -2,6 +2,8 @@
 
 #include <QThreadPool>
 #include "components/thumbnailer/thumbnailerrunnable.h"
+#include "components/thumbnailer/folderpreviewrunnable.h"
+#include "components/thumbnailer/thumbnailtaskqueue.h"
 #include "components/cache/thumbnailcache.h"
 #include "settings.h"
 
@@ -11,23 +13,31 @@ class Thumbnailer : public QObject
 public:
     explicit Thumbnailer();
     ~Thumbnailer();
+    // synchronous; videos go through a one-off mpv process
     static std::shared_ptr<Thumbnail> getThumbnail(QString filePath, int size);
-    void clearTasks();
     void waitForDone();
 
 public slots:
     void getThumbnailAsync(QString path, int size, bool crop, bool force);
+    // Replaces whatever is queued. Paths go in priority order, most important first.
+    // Thumbnails that are being generated for paths not in the list get cancelled.
+    void requestThumbnails(QList<QString> paths, int size, bool crop, bool force);
+    // Same as requestThumbnails(), for folder previews. Separate queue.
+    void requestFolderPreviews(QList<QString> dirPaths, int size, QColor color);
 
 private:
     ThumbnailCache *cache;
     QThreadPool *pool;
-    void startThumbnailerThread(QString filePath, int size, bool crop, bool force);
-    QMultiMap<QString, int> runningTasks;
+    ThumbnailTaskQueue *queue, *folderQueue;
+    VideoThumbnailHelperPool *videoHelpers;
+    QRegularExpression folderPreviewFilter;
+    void startWorkers(int count);
+    void startFolderWorkers(int count);
 
 private slots:
-    void onTaskStart(QString filePath, int size);
-    void onTaskEnd(std::shared_ptr<Thumbnail> thumbnail, QString filePath);
+    void onTaskEnd(std::shared_ptr<Thumbnail> thumbnail, QString filePath, bool crop);
 
 signals:
-    void thumbnailReady(std::shared_ptr<Thumbnail> thumbnail, QString filePath);
+    void thumbnailReady(std::shared_ptr<Thumbnail> thumbnail, QString filePath, bool crop);
+    void folderPreviewReady(std::shared_ptr<Thumbnail> thumbnail, QString dirPath, QColor color);
 };
@@ -2,19 +2,21 @@
 
 #include <memory>
 
-ThumbnailerRunnable::ThumbnailerRunnable(ThumbnailCache* _cache, QString _path, int _size, bool _crop, bool _force) :
-    path(_path),
-    size(_size),
-    crop(_crop),
-    force(_force),
-    cache(_cache)
+ThumbnailerRunnable::ThumbnailerRunnable(ThumbnailCache* _cache, ThumbnailTaskQueue *_queue, VideoThumbnailHelperPool *_videoHelpers) :
+    cache(_cache),
+    queue(_queue),
+    videoHelpers(_videoHelpers)
 {
 }
 
 void ThumbnailerRunnable::run() {
-    emit taskStart(path, size);
-    std::shared_ptr<Thumbnail> thumbnail = generate(cache, path, size, crop, force);
-    emit taskEnd(thumbnail, path);
+    ThumbnailTask task;
+    while(queue->take(task)) {
+        std::shared_ptr<Thumbnail> thumbnail = generate(cache, task.path, task.size, task.crop, task.force, task.cancel.get(), videoHelpers);
+        queue->finish(task, thumbnail != nullptr);
+        if(thumbnail)
+            emit taskEnd(thumbnail, task.path, task.crop);
+    }
 }
 
 QString ThumbnailerRunnable::generateIdString(QString path, int size, bool crop) {
@@ -25,17 +27,53 @@ QString ThumbnailerRunnable::generateIdString(QString path, int size, bool crop)
     return queryStr;
 }
 
-std::shared_ptr<Thumbnail> ThumbnailerRunnable::generate(ThumbnailCache* cache, QString path, int size, bool crop, bool force) {
+std::shared_ptr<Thumbnail> ThumbnailerRunnable::generate(ThumbnailCache* cache, QString path, int size, bool crop, bool force,
+                                                         const std::atomic_bool *cancel, VideoThumbnailHelperPool *videoHelpers)
+{
+    if(cancel && *cancel)
+        return nullptr;
     DocumentInfo imgInfo(path);
     QString thumbnailId = generateIdString(path, size, crop);
     std::unique_ptr<QImage> image;
 
     QString time = QString::number(imgInfo.lastModified().toMSecsSinceEpoch());
 
+    // id that doesn't depend on the path (if enabled)
+    QString identityId;
+    QString keyBase = path;
+    if(cache) {
+        QString identity = fileIdentity(path);
+        if(!identity.isEmpty()) {
+            identityId = generateIdString(identity, size, crop);
+            keyBase = identity;
+        }
+    }
+
     if(!force && cache) {
-        image.reset(cache->readThumbnail(thumbnailId));
+        if(!identityId.isEmpty()) {
+            image.reset(cache->readThumbnail(identityId));
+            // content keys stay valid after a copy / touch, which changes mtime
+            if(image && settings->thumbnailKeyMode() == THUMB_KEY_CONTENT)
+                image->setText("lastModified", time);
+        }
+        if(!image) {
+            // entry from before the key mode was changed
+            image.reset(cache->readThumbnail(thumbnailId));
+            if(image && !identityId.isEmpty()) {
+                if(image->text("lastModified") == time) {
+                    image->setText("keyMode", QString::number(settings->thumbnailKeyMode()));
+                    cache->saveThumbnail(image.get(), identityId);
+                }
+                cache->removeThumbnail(thumbnailId);
+            }
+        }
         if(image && image->text("lastModified") != time)
             image.reset(nullptr);
+        // zooming the folder view; scale down a larger one
+        if(!image) {
+            bool checkTime = (identityId.isEmpty() || settings->thumbnailKeyMode() != THUMB_KEY_CONTENT);
+            image = deriveFromLarger(cache, keyBase, size, crop, time, checkTime);
+        }
     }
 
     if(!image) {
@@ -43,35 +81,25 @@ std::shared_ptr<Thumbnail> ThumbnailerRunnable::generate(ThumbnailCache* cache,
             std::shared_ptr<Thumbnail> thumbnail(new Thumbnail(imgInfo.fileName(), "", size, nullptr));
             return thumbnail;
         }
-        std::pair<QImage*, QSize> pair;
-        if(imgInfo.type() == VIDEO)
-            pair = createVideoThumbnail(path, size, crop);
-        else
-            pair = createThumbnail(imgInfo.filePath(), imgInfo.format().toStdString().c_str(), size, crop);
-
-        if (!pair.first)
+        // scrolled away while we were checking the cache
+        if(cancel && *cancel)
+            return nullptr;
+        QSize originalSize;
+        image = createImage(imgInfo, size, crop, cancel, videoHelpers, originalSize);
+        if (!image) {
+            if(cancel && *cancel)
+                return nullptr;
             return  std::make_shared<Thumbnail>(imgInfo.fileName(), "", size, nullptr);
-
-        image.reset(pair.first);
-        QSize originalSize = pair.second;
-
-        image = ImageLib::exifRotated(std::move(image), imgInfo.exifOrientation());
-
-        // put in image info
-        image->setText("originalWidth", QString::number(originalSize.width()));
-        image->setText("originalHeight", QString::number(originalSize.height()));
-        image->setText("lastModified", time);
-
-        if(imgInfo.type() == ANIMATED)
-            image->setText("label", " [a]");
-        else if(imgInfo.type() == VIDEO)
-            image->setText("label", " [v]");
+        }
+        setImageInfo(image.get(), imgInfo, originalSize, time, !identityId.isEmpty());
 
         if(cache) {
             // save thumbnail if it makes sense
-            // FIXME: avoid too much i/o
-            if(originalSize.width() > size || originalSize.height() > size || imgInfo.type() == VIDEO)
-                cache->saveThumbnail(image.get(), thumbnailId);
+            if(originalSize.width() > size || originalSize.height() > size || imgInfo.type() == VIDEO) {
+                QString savedId = identityId.isEmpty() ? thumbnailId : identityId;
+                cache->saveThumbnail(image.get(), savedId);
+                cache->addToSizeIndex(generateIdString("sizes:" + keyBase, 0, crop), size, savedId);
+            }
         }
     }
     auto && tmpPixmap = new QPixmap(image->size());
@@ -93,6 +121,134 @@ std::shared_ptr<Thumbnail> ThumbnailerRunnable::generate(ThumbnailCache* cache,
     return thumbnail;
 }
 
+// Makes sure all sizes are in the cache, decoding the file at most once:
+// the largest missing size is generated and the rest are scaled down from it.
+// Thumbnails of files smaller than the smallest size are still saved for that
+// size; their original size then tells which of the other sizes aren't needed.
+ThumbnailerRunnable::CacheResult ThumbnailerRunnable::cacheSizes(ThumbnailCache *cache, QString path, QList<int> sizes, bool crop,
+                                                                 const std::atomic_bool *cancel, VideoThumbnailHelperPool *videoHelpers)
+{
+    if(cancel && *cancel)
+        return CACHE_CANCELLED;
+    DocumentInfo imgInfo(path);
+    if(imgInfo.type() == DocumentType::NONE)
+        return CACHE_UNSUPPORTED;
+    QString time = QString::number(imgInfo.lastModified().toMSecsSinceEpoch());
+    QString identity = fileIdentity(path);
+    QString keyBase = identity.isEmpty() ? path : identity;
+    bool checkTime = (identity.isEmpty() || settings->thumbnailKeyMode() != THUMB_KEY_CONTENT);
+
+    std::sort(sizes.begin(), sizes.end(), std::greater<int>());
+    QSize originalSize;
+    QList<int> missing;
+    for(auto size : sizes) {
+        QMap<QString, QString> text;
+        if(cache->readText(generateIdString(keyBase, size, crop), text) &&
+           (!checkTime || text.value("lastModified") == time))
+        {
+            originalSize = QSize(text.value("originalWidth").toInt(), text.value("originalHeight").toInt());
+        } else {
+            missing.append(size);
+        }
+    }
+    if(originalSize.isValid() && imgInfo.type() != VIDEO) {
+        // these would just be copies of the smaller one
+        for(int i = missing.count() - 1; i >= 0; i--) {
+            if(originalSize.width() <= missing.at(i) && originalSize.height() <= missing.at(i) && missing.at(i) != sizes.last())
+                missing.removeAt(i);
+        }
+    }
+    if(missing.isEmpty())
+        return CACHE_SKIPPED;
+    if(cancel && *cancel)
+        return CACHE_CANCELLED;
+
+    std::unique_ptr<QImage> image = createImage(imgInfo, missing.first(), crop, cancel, videoHelpers, originalSize);
+    if(!image)
+        return (cancel && *cancel) ? CACHE_CANCELLED : CACHE_FAILED;
+    setImageInfo(image.get(), imgInfo, originalSize, time, !identity.isEmpty());
+    for(auto size : missing) {
+        bool needed = originalSize.width() > size || originalSize.height() > size ||
+                      imgInfo.type() == VIDEO || size == sizes.last();
+        if(!needed)
+            continue;
+        if(size == missing.first()) {
+            cache->saveThumbnail(image.get(), generateIdString(keyBase, size, crop));
+        } else {
+            QImage scaled = image->scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation);
+            for(auto key : image->textKeys())
+                scaled.setText(key, image->text(key));
+            cache->saveThumbnail(&scaled, generateIdString(keyBase, size, crop));
+        }
+        cache->addToSizeIndex(generateIdString("sizes:" + keyBase, 0, crop), size, generateIdString(keyBase, size, crop));
+    }
+    return CACHE_GENERATED;
+}
+
+// device/inode or content hash, depending on settings. Empty for path keys
+QString ThumbnailerRunnable::fileIdentity(QString path) {
+    auto keyMode = settings->thumbnailKeyMode();
+    if(keyMode == THUMB_KEY_FILE_ID)
+        return FileIdentity::fileId(path);
+    else if(keyMode == THUMB_KEY_CONTENT)
+        return FileIdentity::contentHash(path);
+    return "";
+}
+
+// Decodes the file (or its embedded preview / a video frame) into a thumbnail
+// of the given size, exif-rotated. originalSize is the size of the source.
+std::unique_ptr<QImage> ThumbnailerRunnable::createImage(const DocumentInfo &imgInfo, int size, bool crop, const std::atomic_bool *cancel,
+                                                        VideoThumbnailHelperPool *videoHelpers, QSize &originalSize)
+{
+    std::pair<QImage*, QSize> pair(nullptr, QSize());
+    int orientation = imgInfo.exifOrientation();
+    if(imgInfo.type() == VIDEO)
+        pair = createVideoThumbnail(imgInfo.filePath(), size, crop, cancel, videoHelpers);
+    else if(imgInfo.type() == STATIC && ExifPreview::isSupportedFormat(imgInfo.format()))
+        pair = createPreviewThumbnail(imgInfo.filePath(), size, crop, orientation);
+    if(!pair.first && imgInfo.type() != VIDEO)
+        pair = createThumbnail(imgInfo.filePath(), imgInfo.format().toStdString().c_str(), size, crop);
+    if(!pair.first)
+        return nullptr;
+    originalSize = pair.second;
+    return ImageLib::exifRotated(std::unique_ptr<QImage>(pair.first), orientation);
+}
+
+void ThumbnailerRunnable::setImageInfo(QImage *image, const DocumentInfo &imgInfo, QSize originalSize, QString time, bool identityKey) {
+    image->setText("originalWidth", QString::number(originalSize.width()));
+    image->setText("originalHeight", QString::number(originalSize.height()));
+    image->setText("lastModified", time);
+    // for the garbage collector
+    image->setText("sourcePath", imgInfo.filePath());
+    if(identityKey)
+        image->setText("keyMode", QString::number(settings->thumbnailKeyMode()));
+
+    if(imgInfo.type() == ANIMATED)
+        image->setText("label", " [a]");
+    else if(imgInfo.type() == VIDEO)
+        image->setText("label", " [v]");
+}
+
+// Smallest cached thumbnail above the requested size, scaled down.
+// These are not saved; scaling is about as fast as reading them back.
+std::unique_ptr<QImage> ThumbnailerRunnable::deriveFromLarger(ThumbnailCache *cache, QString keyBase, int size, bool crop, QString time, bool checkTime) {
+    std::unique_ptr<QImage> result;
+    for(auto cachedSize : cache->sizeIndex(generateIdString("sizes:" + keyBase, 0, crop))) {
+        if(cachedSize <= size)
+            continue;
+        std::unique_ptr<QImage> larger(cache->readThumbnail(generateIdString(keyBase, cachedSize, crop)));
+        if(!larger || (checkTime && larger->text("lastModified") != time))
+            continue;
+        result.reset(new QImage(larger->scaled(size, size, Qt::KeepAspectRatio, Qt::SmoothTransformation)));
+        for(auto key : larger->textKeys())
+            result->setText(key, larger->text(key));
+        if(!checkTime)
+            result->setText("lastModified", time);
+        break;
+    }
+    return result;
+}
+
 ThumbnailerRunnable::~ThumbnailerRunnable() {
 }
 
@@ -159,7 +315,63 @@ std::pair<QImage*, QSize> ThumbnailerRunnable::createThumbnail(QString path, con
     return std::make_pair(result, originalSize);
 }
 
-std::pair<QImage*, QSize> ThumbnailerRunnable::createVideoThumbnail(QString path, int size, bool squared) {
+// Scales down a preview embedded into the file instead of decoding the whole thing.
+// Sets orientation if the file has it and the image reader didn't know.
+std::pair<QImage*, QSize> ThumbnailerRunnable::createPreviewThumbnail(QString path, int size, bool squared, int &orientation) {
+    ExifPreviewData preview = ExifPreview::find(path, size, squared);
+    if(preview.data.isEmpty())
+        return std::make_pair(nullptr, QSize());
+    QBuffer buffer(&preview.data);
+    QImageReader reader(&buffer);
+    // orientation of the main image is applied later
+    reader.setAutoTransform(false);
+    Qt::AspectRatioMode ARMode = squared?
+                (Qt::KeepAspectRatioByExpanding):(Qt::KeepAspectRatio);
+    QSize scaledSize = preview.size.scaled(size, size, ARMode);
+    reader.setScaledSize(scaledSize);
+    if(squared) {
+        QRect clip(0, 0, size, size);
+        QRect scaledRect(QPoint(0,0), scaledSize);
+        clip.moveCenter(scaledRect.center());
+        reader.setScaledClipRect(clip);
+    }
+    QImage *result = new QImage();
+    if(!reader.read(result) || result->isNull()) {
+        delete result;
+        return std::make_pair(nullptr, QSize());
+    }
+    if(orientation <= 0 && preview.orientation > 0)
+        orientation = preview.orientation;
+    return std::make_pair(result, preview.originalSize);
+}
+
+std::pair<QImage*, QSize> ThumbnailerRunnable::createVideoThumbnail(QString path, int size, bool squared, const std::atomic_bool *cancel,
+                                                                    VideoThumbnailHelperPool *videoHelpers)
+{
+    // persistent helper process if there is one
+    if(!videoHelpers || !VideoThumbnailHelper::isAvailable())
+        return createVideoThumbnailMpv(path, size, squared, cancel);
+    VideoThumbnailHelper *helper = videoHelpers->acquire(cancel);
+    if(!helper)
+        return std::make_pair(nullptr, QSize());
+    QImage frame;
+    QSize sourceSize;
+    auto result = helper->thumbnail(path, size, squared, cancel, frame, sourceSize);
+    videoHelpers->release(helper);
+    switch(result) {
+    case VideoThumbnailHelper::RESULT_OK:
+        return std::make_pair(new QImage(frame), sourceSize);
+    case VideoThumbnailHelper::RESULT_ERROR:
+    case VideoThumbnailHelper::RESULT_CANCELLED:
+        return std::make_pair(nullptr, QSize());
+    case VideoThumbnailHelper::RESULT_UNAVAILABLE:
+        break;
+    }
+    return createVideoThumbnailMpv(path, size, squared, cancel);
+}
+
+// fallback: one mpv process per file
+std::pair<QImage*, QSize> ThumbnailerRunnable::createVideoThumbnailMpv(QString path, int size, bool squared, const std::atomic_bool *cancel) {
     QProcess process;
     process.setProcessChannelMode(QProcess::SeparateChannels);
     QString vf = "--vf=scale=w=%size%:h=%size%:force_original_aspect_ratio=decrease:flags=fast_bilinear" +
@@ -195,7 +407,15 @@ std::pair<QImage*, QSize> ThumbnailerRunnable::createVideoThumbnail(QString path
         return std::make_pair(nullptr, *(new QSize()));
     }
 
-    process.waitForFinished();
+    while(!process.waitForFinished(50)) {
+        if(process.state() == QProcess::NotRunning)
+            break;
+        if(cancel && *cancel) {
+            process.kill();
+            process.waitForFinished();
+            return std::make_pair(nullptr, QSize());
+        }
+    }
     QByteArray sout = process.readAllStandardOutput();
     QByteArray serr = process.readAllStandardError();
 
@@ -7,29 +7,53 @@
 #include <ctime>
 #include "sourcecontainers/thumbnail.h"
 #include "components/cache/thumbnailcache.h"
+#include "components/thumbnailer/thumbnailtaskqueue.h"
+#include "components/thumbnailer/videothumbnailhelper.h"
 #include "utils/imagefactory.h"
 #include "utils/imagelib.h"
+#include "utils/fileidentity.h"
+#include "utils/exifpreview.h"
 #include "settings.h"
 #include <memory>
 #include <QImageWriter>
 
+// Worker; generates thumbnails from the queue until it is empty.
 class ThumbnailerRunnable : public QObject, public QRunnable {
     Q_OBJECT
 public:
-    ThumbnailerRunnable(ThumbnailCache* _cache, QString _path, int _size, bool _crop, bool _force);
+    ThumbnailerRunnable(ThumbnailCache* _cache, ThumbnailTaskQueue *_queue, VideoThumbnailHelperPool *_videoHelpers);
     ~ThumbnailerRunnable();
     void run();
-    static std::shared_ptr<Thumbnail> generate(ThumbnailCache *cache, QString path, int size, bool crop, bool force);
+    // Returns nullptr if *cancel got set before the expensive part.
+    // Without videoHelpers videos are done by a one-off mpv process.
+    static std::shared_ptr<Thumbnail> generate(ThumbnailCache *cache, QString path, int size, bool crop, bool force,
+                                               const std::atomic_bool *cancel = nullptr, VideoThumbnailHelperPool *videoHelpers = nullptr);
+
+    enum CacheResult {
+        CACHE_SKIPPED,     // everything was already there
+        CACHE_GENERATED,
+        CACHE_FAILED,
+        CACHE_UNSUPPORTED, // not an image / video
+        CACHE_CANCELLED
+    };
+    // For batch generation; does not produce a Thumbnail
+    static CacheResult cacheSizes(ThumbnailCache *cache, QString path, QList<int> sizes, bool crop,
+                                  const std::atomic_bool *cancel = nullptr, VideoThumbnailHelperPool *videoHelpers = nullptr);
 private:
     static QString generateIdString(QString path, int size, bool crop);
+    static QString fileIdentity(QString path);
+    static std::unique_ptr<QImage> createImage(const DocumentInfo &imgInfo, int size, bool crop, const std::atomic_bool *cancel,
+                                               VideoThumbnailHelperPool *videoHelpers, QSize &originalSize);
+    static void setImageInfo(QImage *image, const DocumentInfo &imgInfo, QSize originalSize, QString time, bool identityKey);
+    static std::unique_ptr<QImage> deriveFromLarger(ThumbnailCache *cache, QString keyBase, int size, bool crop, QString time, bool checkTime);
     static std::pair<QImage*, QSize> createThumbnail(QString path, const char* format, int size, bool crop);
-    static std::pair<QImage*, QSize> createVideoThumbnail(QString path, int size, bool crop);
-    QString path;
-    int size;
-    bool crop, force;
+    static std::pair<QImage*, QSize> createVideoThumbnail(QString path, int size, bool crop, const std::atomic_bool *cancel, VideoThumbnailHelperPool *videoHelpers);
+    static std::pair<QImage*, QSize> createVideoThumbnailMpv(QString path, int size, bool crop, const std::atomic_bool *cancel);
+    static std::pair<QImage*, QSize> createPreviewThumbnail(QString path, int size, bool crop, int &orientation);
     ThumbnailCache* cache = nullptr;
+    ThumbnailTaskQueue *queue;
+    VideoThumbnailHelperPool *videoHelpers;
 
 signals:
-    void taskStart(QString, int);
-    void taskEnd(std::shared_ptr<Thumbnail>, QString);
+    void taskEnd(std::shared_ptr<Thumbnail>, QString, bool);
 };
@@ -0,0 +1,111 @@
+#include "thumbnailtaskqueue.h"
+
+ThumbnailTaskQueue::ThumbnailTaskQueue(int _maxWorkers)
+    : workers(0),
+      maxWorkers(qMax(_maxWorkers, 1))
+{
+}
+
+// expects the mutex to be held
+int ThumbnailTaskQueue::spawnCount() {
+    int count = qMin(pending.count(), maxWorkers - workers);
+    if(count < 0)
+        count = 0;
+    workers += count;
+    return count;
+}
+
+// expects the mutex to be held
+// The running one has stale data (file was edited etc.), so it is stopped.
+// finish() puts the new task at the front of the queue.
+void ThumbnailTaskQueue::requestRerun(const TaskKey &key, ThumbnailTask task) {
+    task.cancel = std::make_shared<std::atomic_bool>(false);
+    rerun.insert(key, task);
+    *running[key].cancel = true;
+}
+
+int ThumbnailTaskQueue::setTasks(const QList<ThumbnailTask> &tasks) {
+    QMutexLocker locker(&mutex);
+    QSet<TaskKey> wanted;
+    pending.clear();
+    for(auto task : tasks) {
+        TaskKey key(task.path, task.size);
+        if(wanted.contains(key))
+            continue;
+        wanted.insert(key);
+        auto it = running.find(key);
+        if(it != running.end()) {
+            if(task.force)
+                requestRerun(key, task);
+            else if(!rerun.contains(key))
+                *it.value().cancel = false;
+            continue;
+        }
+        task.cancel = std::make_shared<std::atomic_bool>(false);
+        pending.append(task);
+    }
+    for(auto it = running.begin(); it != running.end(); ++it) {
+        if(!wanted.contains(it.key())) {
+            *it.value().cancel = true;
+            rerun.remove(it.key());
+        }
+    }
+    return spawnCount();
+}
+
+int ThumbnailTaskQueue::addTask(const ThumbnailTask &task) {
+    QMutexLocker locker(&mutex);
+    TaskKey key(task.path, task.size);
+    if(running.contains(key)) {
+        if(task.force)
+            requestRerun(key, task);
+        return 0;
+    }
+    ThumbnailTask newTask = task;
+    newTask.cancel = std::make_shared<std::atomic_bool>(false);
+    for(auto &queued : pending) {
+        if(queued.path == task.path && queued.size == task.size) {
+            // already queued; a forced one takes its place
+            if(task.force)
+                queued = newTask;
+            return 0;
+        }
+    }
+    pending.append(newTask);
+    return spawnCount();
+}
+
+void ThumbnailTaskQueue::cancelAll() {
+    QMutexLocker locker(&mutex);
+    pending.clear();
+    rerun.clear();
+    for(auto &task : running)
+        *task.cancel = true;
+}
+
+bool ThumbnailTaskQueue::take(ThumbnailTask &task) {
+    QMutexLocker locker(&mutex);
+    while(!pending.isEmpty()) {
+        task = pending.takeFirst();
+        TaskKey key(task.path, task.size);
+        // same file requested again while it was in progress
+        if(running.contains(key))
+            continue;
+        running.insert(key, task);
+        return true;
+    }
+    workers--;
+    return false;
+}
+
+void ThumbnailTaskQueue::finish(const ThumbnailTask &task, bool done) {
+    QMutexLocker locker(&mutex);
+    TaskKey key(task.path, task.size);
+    running.remove(key);
+    // the worker that calls this picks it up next
+    if(rerun.contains(key))
+        pending.prepend(rerun.take(key));
+    // cancelled, but then requested again before we noticed; retry first thing
+    else if(!done && !*task.cancel)
+        pending.prepend(task);
+}
@@ -0,0 +1,59 @@
+#pragma once
+
+#include <QString>
+#include <QList>
+#include <QMap>
+#include <QSet>
+#include <QPair>
+#include <QMutex>
+#include <QColor>
+#include <atomic>
+#include <memory>
+
+struct ThumbnailTask {
+    QString path;
+    int size = 0;
+    bool crop = false;
+    bool force = false;
+    QColor color; // folder previews
+    std::shared_ptr<std::atomic_bool> cancel;
+};
+
+// Pending thumbnail tasks in priority order (first = most important), plus the
+// ones currently being worked on.
+// Workers pull tasks from here until it runs dry, so the order can be changed
+// at any time without restarting anything.
+// Thread safe.
+class ThumbnailTaskQueue {
+public:
+    explicit ThumbnailTaskQueue(int _maxWorkers);
+
+    // Replaces the pending tasks. Running tasks that are not in the list get
+    // cancelled; those that are keep running (and get un-cancelled).
+    // Forced tasks are an exception: the running one is cancelled and the
+    // task runs again right after it.
+    // Returns how many new workers should be started.
+    int setTasks(const QList<ThumbnailTask> &tasks);
+    // Appends to the end unless already queued or running. A forced task
+    // replaces the queued one (see setTasks() for running ones).
+    int addTask(const ThumbnailTask &task);
+    // drops pending tasks and cancels running ones
+    void cancelAll();
+
+    // For workers. Returns false when there is nothing left; the worker must exit then.
+    bool take(ThumbnailTask &task);
+    // done = false if the task was stopped because of cancellation
+    void finish(const ThumbnailTask &task, bool done);
+
+private:
+    typedef QPair<QString, int> TaskKey;
+    QMutex mutex;
+    QList<ThumbnailTask> pending;
+    QMap<TaskKey, ThumbnailTask> running;
+    // forced requests that came in while the same task was running
+    QMap<TaskKey, ThumbnailTask> rerun;
+    int workers, maxWorkers;
+
+    int spawnCount();
+    void requestRerun(const TaskKey &key, ThumbnailTask task);
+};
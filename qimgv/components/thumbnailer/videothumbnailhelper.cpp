@@ -0,0 +1,194 @@
+#include "videothumbnailhelper.h"
+
+VideoThumbnailHelper::VideoThumbnailHelper() {
+}
+
+VideoThumbnailHelper::~VideoThumbnailHelper() {
+    stop();
+}
+
+QString VideoThumbnailHelper::helperPath() {
+    static const QString path = []() {
+        QStringList dirs;
+#ifdef _WIN32
+        QString name = "qimgv_thumbnailer_mpv.exe";
+        dirs << QApplication::applicationDirPath() + "/plugins";
+        dirs << QApplication::applicationDirPath() + "/../plugins/player_mpv";
+#else
+        QString name = "qimgv_thumbnailer_mpv";
+        QDir libPath(QApplication::applicationDirPath() + "/../lib/qimgv");
+        dirs << (libPath.makeAbsolute() ? libPath.path() : ".") << "/usr/lib/qimgv" << "/usr/lib64/qimgv";
+        dirs << QApplication::applicationDirPath() + "/../plugins/player_mpv";
+#endif
+        for(auto dir : dirs) {
+            QFileInfo fi(dir + "/" + name);
+            if(fi.isFile() && fi.isExecutable())
+                return fi.absoluteFilePath();
+        }
+        return QString();
+    }();
+    return path;
+}
+
+bool VideoThumbnailHelper::isAvailable() {
+    return !helperPath().isEmpty();
+}
+
+void VideoThumbnailHelper::attach() {
+    if(process)
+        process->moveToThread(QThread::currentThread());
+}
+
+void VideoThumbnailHelper::detach() {
+    if(process)
+        process->moveToThread(nullptr);
+}
+
+bool VideoThumbnailHelper::start() {
+    if(process && process->state() == QProcess::Running)
+        return true;
+    if(!isAvailable())
+        return false;
+    process.reset(new QProcess());
+    process->setProcessChannelMode(QProcess::SeparateChannels);
+    process->setReadChannel(QProcess::StandardOutput);
+    // we don't read it; don't let it fill up the pipe
+    process->setStandardErrorFile(QProcess::nullDevice());
+    process->start(helperPath(), QStringList());
+    if(!process->waitForStarted()) {
+        qDebug() << "[VideoThumbnailHelper] could not start" << helperPath();
+        process.reset();
+        return false;
+    }
+    return true;
+}
+
+void VideoThumbnailHelper::stop() {
+    if(!process)
+        return;
+    if(process->state() == QProcess::Running) {
+        process->closeWriteChannel();
+        if(!process->waitForFinished(500)) {
+            process->kill();
+            process->waitForFinished(500);
+        }
+    }
+    process.reset();
+}
+
+bool VideoThumbnailHelper::waitForLine(QByteArray &line, const std::atomic_bool *cancel, QElapsedTimer &timer) {
+    while(!process->canReadLine()) {
+        if((cancel && *cancel) || timer.hasExpired(TIMEOUT) || process->state() != QProcess::Running)
+            return false;
+        process->waitForReadyRead(50);
+    }
+    line = process->readLine().trimmed();
+    return true;
+}
+
+bool VideoThumbnailHelper::waitForBytes(QByteArray &data, qint64 count, const std::atomic_bool *cancel, QElapsedTimer &timer) {
+    data.reserve(static_cast<int>(count));
+    while(data.size() < count) {
+        data.append(process->read(count - data.size()));
+        if(data.size() == count)
+            break;
+        if((cancel && *cancel) || timer.hasExpired(TIMEOUT) || process->state() != QProcess::Running)
+            return false;
+        process->waitForReadyRead(50);
+    }
+    return true;
+}
+
+VideoThumbnailHelper::Result VideoThumbnailHelper::thumbnail(const QString &path, int size, bool crop, const std::atomic_bool *cancel,
+                                                             QImage &image, QSize &sourceSize)
+{
+    // can't be sent over the line based protocol
+    if(path.contains('\n') || path.contains('\r'))
+        return RESULT_UNAVAILABLE;
+    if(!start())
+        return RESULT_UNAVAILABLE;
+    QElapsedTimer timer;
+    timer.start();
+    QByteArray request = QByteArray::number(size) + (crop ? " 1 " : " 0 ") + path.toUtf8() + "\n";
+    process->write(request);
+
+    QByteArray line;
+    if(!waitForLine(line, cancel, timer)) {
+        // Hung, crashed or cancelled. Either way its state is unknown now, so restart it next time.
+        bool cancelled = cancel && *cancel;
+        if(!cancelled)
+            qDebug() << "[VideoThumbnailHelper] no response for" << path;
+        stop();
+        return cancelled ? RESULT_CANCELLED : RESULT_UNAVAILABLE;
+    }
+    if(line.startsWith("error"))
+        return RESULT_ERROR;
+    if(!line.startsWith("ok ")) {
+        stop();
+        return RESULT_UNAVAILABLE;
+    }
+    // "ok key=value key=value ..."
+    QMap<QByteArray, qint64> fields;
+    for(auto field : line.mid(3).split(' ')) {
+        int separator = field.indexOf('=');
+        if(separator > 0)
+            fields.insert(field.left(separator), field.mid(separator + 1).toLongLong());
+    }
+    int width = static_cast<int>(fields.value("width"));
+    int height = static_cast<int>(fields.value("height"));
+    qint64 bytes = fields.value("bytes");
+    if(width <= 0 || height <= 0 || bytes != static_cast<qint64>(width) * height * 3) {
+        stop();
+        return RESULT_UNAVAILABLE;
+    }
+    QByteArray pixels;
+    if(!waitForBytes(pixels, bytes, cancel, timer)) {
+        bool cancelled = cancel && *cancel;
+        stop();
+        return cancelled ? RESULT_CANCELLED : RESULT_UNAVAILABLE;
+    }
+    image = QImage(reinterpret_cast<const uchar*>(pixels.constData()), width, height, width * 3, QImage::Format_RGB888).copy();
+    sourceSize = QSize(static_cast<int>(fields.value("source_width")), static_cast<int>(fields.value("source_height")));
+    return RESULT_OK;
+}
+
+//------------------------------------------------------------------------------
+
+VideoThumbnailHelperPool::VideoThumbnailHelperPool(int _maxCount)
+    : count(0),
+      maxCount(qMax(1, _maxCount))
+{
+}
+
+VideoThumbnailHelperPool::~VideoThumbnailHelperPool() {
+    for(auto helper : idle) {
+        helper->attach();
+        delete helper;
+    }
+}
+
+VideoThumbnailHelper *VideoThumbnailHelperPool::acquire(const std::atomic_bool *cancel) {
+    QMutexLocker locker(&mutex);
+    while(idle.isEmpty() && count >= maxCount) {
+        if(cancel && *cancel)
+            return nullptr;
+        released.wait(&mutex, 50);
+    }
+    VideoThumbnailHelper *helper;
+    if(!idle.isEmpty()) {
+        helper = idle.takeLast();
+    } else {
+        helper = new VideoThumbnailHelper();
+        count++;
+    }
+    locker.unlock();
+    helper->attach();
+    return helper;
+}
+
+void VideoThumbnailHelperPool::release(VideoThumbnailHelper *helper) {
+    helper->detach();
+    QMutexLocker locker(&mutex);
+    idle.append(helper);
+    released.wakeOne();
+}
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <QProcess>
+#include <QImage>
+#include <QApplication>
+#include <QFileInfo>
+#include <QDir>
+#include <QElapsedTimer>
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QList>
+#include <QDebug>
+#include <atomic>
+#include <memory>
+
+// Client for qimgv_thumbnailer_mpv (see plugins/player_mpv/src/thumbnailhelper.cpp),
+// a long-running process that decodes video frames for thumbnails.
+// Not thread safe; borrow one from VideoThumbnailHelperPool.
+class VideoThumbnailHelper {
+public:
+    VideoThumbnailHelper();
+    ~VideoThumbnailHelper();
+
+    enum Result {
+        RESULT_OK,
+        RESULT_ERROR,        // helper could not decode this file
+        RESULT_UNAVAILABLE,  // no helper / it crashed or hung; use something else
+        RESULT_CANCELLED
+    };
+    // image is RGB888 and fits into size x size (padded to it with crop)
+    Result thumbnail(const QString &path, int size, bool crop, const std::atomic_bool *cancel,
+                     QImage &image, QSize &sourceSize);
+
+    static bool isAvailable();
+    // QProcess may only be used from the thread it belongs to. The pool
+    // detaches a helper from the worker thread when it is returned, and the
+    // next user pulls it into its own thread.
+    void attach();
+    void detach();
+
+private:
+    std::unique_ptr<QProcess> process;
+    bool start();
+    void stop();
+    bool waitForLine(QByteArray &line, const std::atomic_bool *cancel, QElapsedTimer &timer);
+    bool waitForBytes(QByteArray &data, qint64 count, const std::atomic_bool *cancel, QElapsedTimer &timer);
+    static QString helperPath();
+
+    static const int TIMEOUT = 20000; // ms, per file
+};
+
+// Owns the helper processes, so that they get stopped by their owner
+// (Thumbnailer, ThumbnailBatch) instead of whenever a pool thread exits, and
+// limits how many of them run at once.
+// Thread safe.
+class VideoThumbnailHelperPool {
+public:
+    explicit VideoThumbnailHelperPool(int _maxCount);
+    // all helpers must have been released by now
+    ~VideoThumbnailHelperPool();
+    // Waits until a helper is free. Returns nullptr if *cancel gets set meanwhile.
+    VideoThumbnailHelper *acquire(const std::atomic_bool *cancel);
+    void release(VideoThumbnailHelper *helper);
+
+private:
+    QMutex mutex;
+    QWaitCondition released;
+    QList<VideoThumbnailHelper*> idle;
+    int count, maxCount;
+};
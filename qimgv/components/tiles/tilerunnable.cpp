@@ -0,0 +1,22 @@
+#include "tilerunnable.h"
+
+TileRunnable::TileRunnable(QString _path, QByteArray _format, QRect _rect, QSize _scaledSize, quint64 _key)
+    : path(_path),
+      format(_format),
+      rect(_rect),
+      scaledSize(_scaledSize),
+      key(_key)
+{
+}
+
+void TileRunnable::run() {
+    QImageReader r(path, format.constData());
+    // clip is applied first, then the clipped part is scaled down
+    r.setClipRect(rect);
+    r.setScaledSize(scaledSize);
+    QImage tile;
+    // null image on failure
+    if(!r.read(&tile) || tile.size() != scaledSize)
+        tile = QImage();
+    emit finished(tile, key);
+}
@@ -0,0 +1,23 @@
+#pragma once
+
+#include <QObject>
+#include <QRunnable>
+#include <QImageReader>
+
+// decodes a single region of an image
+class TileRunnable : public QObject, public QRunnable
+{
+    Q_OBJECT
+public:
+    TileRunnable(QString _path, QByteArray _format, QRect _rect, QSize _scaledSize, quint64 _key);
+    void run();
+signals:
+    void finished(QImage, quint64);
+
+private:
+    QString path;
+    QByteArray format;
+    QRect rect;
+    QSize scaledSize;
+    quint64 key;
+};
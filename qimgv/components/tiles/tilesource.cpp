@@ -0,0 +1,143 @@
+#include "tilesource.h"
+
+TileSource::TileSource(QString _path, QByteArray _format, QSize _size)
+    : path(_path),
+      format(_format),
+      mSize(_size),
+      mMemoryUsage(0),
+      memoryLimit(MIN_CACHE_SIZE),
+      accessCounter(0)
+{
+}
+
+// tasks which are already running will delete themselves when done
+TileSource::~TileSource() {
+    for(auto task : pending) {
+        if(decoderPool()->tryTake(task))
+            delete task;
+    }
+}
+
+// shared by all sources so closing an image never waits for its decodes
+QThreadPool *TileSource::decoderPool() {
+    static QThreadPool *pool = nullptr;
+    if(!pool) {
+        pool = new QThreadPool(qApp);
+        pool->setMaxThreadCount(QThread::idealThreadCount());
+    }
+    return pool;
+}
+
+QSize TileSource::size() const {
+    return mSize;
+}
+
+qint64 TileSource::memoryUsage() const {
+    return mMemoryUsage;
+}
+
+QList<Tile> TileSource::tiles(QRect area, qreal scale) {
+    QList<Tile> result;
+    area = area.intersected(QRect(QPoint(0, 0), mSize));
+    if(area.isEmpty())
+        return result;
+    int level = levelForScale(scale);
+    int step = TILE_SIZE << level; // in source pixels
+    int firstCol = area.left() / step, lastCol = area.right() / step;
+    int firstRow = area.top() / step, lastRow = area.bottom() / step;
+    QPoint center((firstCol + lastCol) / 2, (firstRow + lastRow) / 2);
+    QSet<quint64> wanted;
+    for(int row = firstRow; row <= lastRow; row++) {
+        for(int col = firstCol; col <= lastCol; col++)
+            wanted.insert(tileKey(level, col, row));
+    }
+    // drop whatever did not start yet and is now offscreen
+    for(auto key : pending.keys()) {
+        auto task = pending.value(key);
+        if(!wanted.contains(key) && decoderPool()->tryTake(task)) {
+            pending.remove(key);
+            delete task;
+        }
+    }
+    for(int row = firstRow; row <= lastRow; row++) {
+        for(int col = firstCol; col <= lastCol; col++) {
+            quint64 key = tileKey(level, col, row);
+            if(cache.contains(key)) {
+                auto &cached = cache[key];
+                cached.lastAccess = ++accessCounter;
+                // null pixmap means it failed to decode; skip
+                if(!cached.pixmap.isNull())
+                    result.append({ key, cached.rect, cached.pixmap });
+                continue;
+            }
+            if(pending.contains(key))
+                continue;
+            QRect rect = QRect(col * step, row * step, step, step).intersected(QRect(QPoint(0, 0), mSize));
+            QSize scaledSize(qMax(1, rect.width() >> level), qMax(1, rect.height() >> level));
+            auto task = new TileRunnable(path, format, rect, scaledSize, key);
+            task->setAutoDelete(false);
+            connect(task, &TileRunnable::finished, this, &TileSource::onTileDecoded);
+            connect(task, &TileRunnable::finished, task, &QObject::deleteLater);
+            pending.insert(key, task);
+            // from the center outwards
+            int priority = -(qAbs(col - center.x()) + qAbs(row - center.y()));
+            decoderPool()->start(task, priority);
+        }
+    }
+    // keep a few screens worth of tiles around for panning back & forth
+    memoryLimit = qMax(MIN_CACHE_SIZE, 3ll * wanted.count() * TILE_SIZE * TILE_SIZE * 4);
+    trimCache(wanted);
+    return result;
+}
+
+void TileSource::onTileDecoded(QImage image, quint64 key) {
+    if(!pending.remove(key))
+        return;
+    int level = static_cast<int>(key >> 56);
+    int row = static_cast<int>((key >> 28) & 0xFFFFFFF);
+    int col = static_cast<int>(key & 0xFFFFFFF);
+    int step = TILE_SIZE << level;
+    CachedTile tile;
+    tile.rect = QRect(col * step, row * step, step, step).intersected(QRect(QPoint(0, 0), mSize));
+    tile.lastAccess = ++accessCounter;
+    if(image.isNull())
+        qDebug() << "TileSource: could not decode" << tile.rect << "of" << path;
+    else
+        tile.pixmap = QPixmap::fromImage(image);
+    mMemoryUsage += static_cast<qint64>(tile.pixmap.width()) * tile.pixmap.height() * tile.pixmap.depth() / 8;
+    cache.insert(key, tile);
+    if(!tile.pixmap.isNull())
+        emit tileReady();
+}
+
+// smallest level which is still sharp at this scale
+int TileSource::levelForScale(qreal scale) const {
+    if(scale >= 1.0)
+        return 0;
+    int level = static_cast<int>(std::floor(std::log2(1.0 / scale)));
+    return qBound(0, level, MAX_LEVEL);
+}
+
+// evicts least recently used tiles until we are within the limit
+void TileSource::trimCache(const QSet<quint64> &keep) {
+    while(mMemoryUsage > memoryLimit) {
+        quint64 lruKey = 0;
+        quint64 lruAccess = std::numeric_limits<quint64>::max();
+        for(auto i = cache.constBegin(); i != cache.constEnd(); ++i) {
+            if(!keep.contains(i.key()) && i.value().lastAccess < lruAccess) {
+                lruKey = i.key();
+                lruAccess = i.value().lastAccess;
+            }
+        }
+        if(lruAccess == std::numeric_limits<quint64>::max())
+            break;
+        auto tile = cache.take(lruKey);
+        mMemoryUsage -= static_cast<qint64>(tile.pixmap.width()) * tile.pixmap.height() * tile.pixmap.depth() / 8;
+    }
+}
+
+quint64 TileSource::tileKey(int level, int col, int row) {
+    return (static_cast<quint64>(level) << 56) |
+           (static_cast<quint64>(row) << 28) |
+            static_cast<quint64>(col);
+}
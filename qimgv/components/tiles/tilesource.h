@@ -0,0 +1,61 @@
+#pragma once
+
+#include <QObject>
+#include <QThreadPool>
+#include <QThread>
+#include <QCoreApplication>
+#include <QPixmap>
+#include <QHash>
+#include <QSet>
+#include <QDebug>
+#include <cmath>
+#include <limits>
+#include "tilerunnable.h"
+
+struct Tile {
+    quint64 key;
+    QRect rect;     // area of the source image
+    QPixmap pixmap; // that area downscaled to the tile's level
+};
+
+// Decodes & caches parts of an image which is too large to be kept in memory whole.
+// Tiles are arranged in levels; level n is the image downscaled by 2^n.
+// Only what's visible is decoded, so memory use depends on the screen size.
+class TileSource : public QObject {
+    Q_OBJECT
+public:
+    TileSource(QString _path, QByteArray _format, QSize _size);
+    ~TileSource();
+    QSize size() const;
+    // Returns decoded tiles for the area (source coordinates) at the given display scale.
+    // Missing ones are queued; queued tiles which are not needed anymore get dropped.
+    QList<Tile> tiles(QRect area, qreal scale);
+    qint64 memoryUsage() const;
+
+signals:
+    void tileReady();
+
+private slots:
+    void onTileDecoded(QImage image, quint64 key);
+
+private:
+    struct CachedTile {
+        QRect rect;
+        QPixmap pixmap;
+        quint64 lastAccess;
+    };
+    QString path;
+    QByteArray format;
+    QSize mSize;
+    QHash<quint64, TileRunnable*> pending;
+    QHash<quint64, CachedTile> cache;
+    qint64 mMemoryUsage, memoryLimit;
+    quint64 accessCounter;
+    int levelForScale(qreal scale) const;
+    void trimCache(const QSet<quint64> &keep);
+    static quint64 tileKey(int level, int col, int row);
+    static QThreadPool *decoderPool();
+    const int TILE_SIZE = 512;
+    const int MAX_LEVEL = 8;
+    const qint64 MIN_CACHE_SIZE = 64 * 1024 * 1024;
+};
@@ -39,6 +39,7 @@ void Core::readSettings() {
     loopSlideshow = settings->loopSlideshow();
     folderEndAction = settings->folderEndAction();
     slideshowTimer.setInterval(settings->slideshowInterval());
+    preloadPolicy.setDepth(settings->preloadAhead(), settings->preloadBehind());
     bool showDirs = (settings->folderViewMode() == FV_EXT_FOLDERS);
     if(folderViewPresenter.showDirs() != showDirs)
         folderViewPresenter.setShowDirs(showDirs);
@@ -73,6 +74,12 @@ void Core::attachModel(DirectoryModel *_model) {
 
 void Core::initComponents() {
     attachModel(new DirectoryModel());
+    // clean up the thumbnail cache once per session, after things settle down
+    if(settings->useThumbnailCache()) {
+        QTimer::singleShot(30000, this, [this]() {
+            thumbnailSweeper.start(false);
+        });
+    }
 }
 
 void Core::connectComponents() {
@@ -124,7 +131,10 @@ void Core::connectComponents() {
     connect(model.get(), &DirectoryModel::fileRenamed,    this, &Core::onFileRenamed);
     connect(model.get(), &DirectoryModel::fileModified,   this, &Core::onFileModified);
     connect(model.get(), &DirectoryModel::loaded,         this, &Core::onModelLoaded);
+    connect(model.get(), &DirectoryModel::entriesAdded,   this, &Core::updateInfoString);
+    connect(model.get(), &DirectoryModel::scanFinished,   this, &Core::onModelScanFinished);
     connect(model.get(), &DirectoryModel::imageReady,     this, &Core::onModelItemReady);
+    connect(model.get(), &DirectoryModel::imagePreviewReady, this, &Core::onModelPreviewReady);
     connect(model.get(), &DirectoryModel::imageUpdated,   this, &Core::onModelItemUpdated);
     connect(model.get(), &DirectoryModel::sortingChanged, this, &Core::onModelSortingChanged);
     connect(model.get(), &DirectoryModel::loadFailed,     this, &Core::onLoadFailed);
@@ -328,6 +338,26 @@ void Core::onModelLoaded() {
         syncRandomizer();
 }
 
+// lists are sorted now, and complete
+void Core::onModelScanFinished() {
+    // file that was opened before its directory was listed
+    if(state.currentImg && !model->isLoaded(state.currentFilePath))
+        model->updateImage(state.currentFilePath, state.currentImg);
+    // views are repopulated in sorted order; keep whatever was selected meanwhile
+    auto thumbPanelSelection = thumbPanelPresenter.selectedPaths();
+    auto folderViewSelection = folderViewPresenter.selectedPaths();
+    onModelLoaded();
+    thumbPanelPresenter.selectAndFocus(thumbPanelSelection);
+    folderViewPresenter.selectAndFocus(folderViewSelection);
+    if(!state.selectAfterScan.isEmpty()) {
+        if(folderViewSelection.isEmpty())
+            folderViewPresenter.selectAndFocus(state.selectAfterScan);
+        state.selectAfterScan = "";
+        loadFirst();
+    }
+    updateInfoString();
+}
+
 void Core::onDirectoryViewFileActivated(QString filePath) {
     // we aren`t using async load so it won't flicker with empty view
     enableDocumentView(false);
@@ -1015,7 +1045,13 @@ void Core::showResizeDialog() {
 // ---------------------------------------------------------------- image operations
 
 std::shared_ptr<ImageStatic> Core::getEditableImage(const QString &filePath) {
-    return std::dynamic_pointer_cast<ImageStatic>(model->getImage(filePath));
+    auto img = std::dynamic_pointer_cast<ImageStatic>(model->getImage(filePath));
+    // only a reduced copy is in memory
+    if(img && img->isTiled()) {
+        mw->showMessage(tr("Editing is not supported for images this large"));
+        return nullptr;
+    }
+    return img;
 }
 
 template<typename... Args>
@@ -1224,7 +1260,8 @@ void Core::print() {
 
 void Core::scalingRequest(QSize size, ScalingFilter filter) {
     // filter out an unnecessary scale request at statup
-    if(mw->isVisible() && state.hasActiveImage) {
+    // skip while a preview is displayed; we will get another request for the full image
+    if(mw->isVisible() && state.hasActiveImage && !state.showingPreview) {
         std::shared_ptr<Image> forScale = model->getImage(state.currentFilePath);
         if(forScale) {
             model->scaler->requestScaled(ScalerRequest(forScale, size, state.currentFilePath, filter));
@@ -1244,7 +1281,11 @@ void Core::onScalingFinished(QPixmap *scaled, ScalerRequest req) {
 // reset state; clear cache; etc
 void Core::reset() {
     state.hasActiveImage = false;
+    state.showingPreview = false;
     state.currentFilePath = "";
+    state.selectAfterScan = "";
+    state.preloadPaths.clear();
+    preloadPolicy.reset();
     model->setDirectory("");
 }
 
@@ -1268,7 +1309,8 @@ bool Core::loadPath(QString path) {
         qDebug() << "Could not open path: " << path;
         return false;
     }
-    if(!state.delayModel && !setDirectory(state.directoryPath))
+    // folders are listed in the background; big ones can take a while
+    if(!state.delayModel && !setDirectory(state.directoryPath, fileInfo.isDir()))
         return false;
 
     // load file / folderview
@@ -1302,10 +1344,10 @@ bool Core::loadPath(QString path) {
     }
 }
 
-bool Core::setDirectory(QString path) {
+bool Core::setDirectory(QString path, bool async) {
     if(model->directoryPath() != path) {
         this->reset();
-        if(!model->setDirectory(path)) {
+        if(!(async ? model->setDirectoryAsync(path) : model->setDirectory(path))) {
             mw->showError(tr("Could not load folder: ") + path);
             return false;
         }
@@ -1320,13 +1362,19 @@ bool Core::loadFileIndex(int index, bool async, bool preload) {
     auto entry = model->fileEntryAt(index);
     if(entry.path.isEmpty())
         return false;
+    int oldIndex = model->indexOfFile(state.currentFilePath);
+    preloadPolicy.step(oldIndex, index);
     state.currentFilePath = entry.path;
-    model->unloadExcept(entry.path, preload);
-    model->load(entry.path, async);
+    state.preloadPaths.clear();
     if(preload) {
-        model->preload(model->nextOf(entry.path));
-        model->preload(model->prevOf(entry.path));
+        for(auto i : preloadPolicy.indexes(index, model->fileCount()))
+            state.preloadPaths << model->filePathAt(i);
     }
+    model->unloadExcept(entry.path, state.preloadPaths);
+    model->setPreviewSize(mw->previewSize());
+    model->load(entry.path, async);
+    // also drops the outdated ones (e.g. when user changes direction)
+    model->preload(state.preloadPaths);
     thumbPanelPresenter.selectAndFocus(entry.path);
     folderViewPresenter.selectAndFocus(entry.path);
     updateInfoString();
@@ -1341,6 +1389,10 @@ void Core::loadParentDir() {
     QFileInfo parentDir(currentDir.absolutePath());
     if(parentDir.exists() && parentDir.isReadable())
         loadPath(parentDir.absoluteFilePath());
+    if(model->isScanning()) {
+        state.selectAfterScan = currentDir.absoluteFilePath();
+        return;
+    }
     folderViewPresenter.selectAndFocus(currentDir.absoluteFilePath());
     loadFirst();
 }
@@ -1514,14 +1566,46 @@ void Core::onModelItemReady(std::shared_ptr<Image> img, const QString &path) {
             state.delayModel = false;
             QTimer::singleShot(40, this, SLOT(modelDelayLoad()));
         }
-        model->unloadExcept(state.currentFilePath, settings->usePreloader());
+        model->unloadExcept(state.currentFilePath, state.preloadPaths);
+        prescalePreloaded();
+    } else if(state.preloadPaths.contains(path)) {
+        prescalePreloaded();
+    }
+}
+
+// Scale loaded neighbours to the size they will be shown at, so that
+// the viewer gets the final result from cache on the first paint.
+void Core::prescalePreloaded() {
+    ScalingFilter filter = mw->scalingFilter();
+    QList<ScalerRequest> requests;
+    if(filter != QI_FILTER_NEAREST) {
+        for(auto path : state.preloadPaths) {
+            if(!model->isLoaded(path))
+                continue;
+            auto img = model->getImage(path);
+            auto staticImg = std::dynamic_pointer_cast<ImageStatic>(img);
+            if(!staticImg || staticImg->isTiled())
+                continue;
+            QSize size = mw->prescaleSize(img->size());
+            if(!size.isEmpty())
+                requests.append(ScalerRequest(img, size, path, filter));
+        }
     }
+    model->scaler->prescale(requests);
+}
+
+// Reduced version of the image that is still loading. Replaced in onModelItemReady()
+void Core::onModelPreviewReady(std::shared_ptr<const QImage> preview, const QString &path) {
+    if(path != state.currentFilePath || model->isLoaded(path))
+        return;
+    state.showingPreview = true;
+    mw->showImage(std::unique_ptr<QPixmap>(new QPixmap(QPixmap::fromImage(*preview))));
 }
 
+// the image is added to the model in onModelScanFinished()
 void Core::modelDelayLoad() {
-    model->setDirectory(state.directoryPath);
+    model->setDirectoryAsync(state.directoryPath);
     mw->setDirectoryPath(state.directoryPath);
-    model->updateImage(state.currentFilePath, state.currentImg);
     updateInfoString();
 }
 
@@ -1542,13 +1626,15 @@ void Core::onModelSortingChanged(SortingMode mode) {
 
 void Core::guiSetImage(std::shared_ptr<Image> img) {
     state.hasActiveImage = true;
+    state.showingPreview = false;
     if(!img) {
         mw->showMessage(tr("Error: could not load image."));
         return;
     }
     DocumentType type = img->type();
     if(type == STATIC) {
-        mw->showImage(img->getPixmap());
+        auto staticImg = std::dynamic_pointer_cast<ImageStatic>(img);
+        mw->showImage(img->getPixmap(), staticImg->tileSource());
     } else if(type == ANIMATED) {
         auto animated = dynamic_cast<ImageAnimated *>(img.get());
         mw->showAnimation(animated->getMovie());
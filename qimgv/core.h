@@ -13,8 +13,10 @@
 #include "components/directorymodel.h"
 #include "components/directorypresenter.h"
 #include "components/scriptmanager/scriptmanager.h"
+#include "components/cache/thumbnailsweeper.h"
 #include "gui/mainwindow.h"
 #include "utils/randomizer.h"
+#include "utils/preloadpolicy.h"
 #include "gui/dialogs/printdialog.h"
 
 #ifdef __GLIBC__
@@ -24,8 +26,12 @@
 struct State {
     bool hasActiveImage = false;
     bool delayModel = false;
+    bool showingPreview = false;
     QString currentFilePath = "";
     QString directoryPath = "";
+    // selected once the directory listing is done
+    QString selectAfterScan = "";
+    QList<QString> preloadPaths;
     std::shared_ptr<Image> currentImg;
 };
 
@@ -69,7 +75,7 @@ private:
 
     void rotateByDegrees(int degrees);
     void reset();
-    bool setDirectory(QString path);
+    bool setDirectory(QString path, bool async = false);
 
     QDrag *mDrag;
     QMimeData *getMimeDataForImage(std::shared_ptr<Image> img, MimeDataTarget target);
@@ -78,9 +84,13 @@ private:
     Randomizer randomizer;
     void syncRandomizer();
 
+    PreloadPolicy preloadPolicy;
+    ThumbnailSweeper thumbnailSweeper;
+
     void attachModel(DirectoryModel *_model);
     QString selectedPath();
     void guiSetImage(std::shared_ptr<Image> img);
+    void prescalePreloaded();
     QTimer slideshowTimer;
 
     void startSlideshowTimer();
@@ -107,6 +117,7 @@ private slots:
     void jumpToFirst();
     void jumpToLast();
     void onModelItemReady(std::shared_ptr<Image>, const QString&);
+    void onModelPreviewReady(std::shared_ptr<const QImage>, const QString&);
     void onModelItemUpdated(QString fileName);
     void onModelSortingChanged(SortingMode mode);
     void onLoadFailed(const QString &path);
@@ -158,6 +169,7 @@ private slots:
     void onDropIn(const QMimeData *mimeData, QObject* source);
     void toggleShuffle();
     void onModelLoaded();
+    void onModelScanFinished();
     void outputError(const FileOpResult &error) const;
     void showOpenDialog();
     void showInDirectory();
@@ -1,4 +1,5 @@
 #include "thumbnailview.h"
+#include <algorithm>
 
 ThumbnailView::ThumbnailView(Qt::Orientation _orientation, QWidget *parent)
     : QGraphicsView(parent),
@@ -9,6 +10,7 @@ ThumbnailView::ThumbnailView(Qt::Orientation _orientation, QWidget *parent)
       mThumbnailSize(120),
       rangeSelection(false),
       selectMode(ACTIVATE_BY_PRESS),
+      mItemCount(0),
       lastScrollFrameTime(0),
       scrollTimeLine(nullptr)
 {
@@ -132,14 +134,16 @@ void ThumbnailView::setDirectoryPath(QString path) {
 
 void ThumbnailView::select(QList<int> indices) {
     for(auto i : mSelection)
-        thumbnails.at(i)->setHighlighted(false);
+        if(auto widget = widgetAt(i))
+            widget->setHighlighted(false);
     QList<int>::iterator it = indices.begin();
     while(it != indices.end()) {
         // sanity check
         if(*it < 0 || *it >= itemCount()) {
             it = indices.erase(it);
         } else {
-            thumbnails.at(*it)->setHighlighted(true);
+            if(auto widget = widgetAt(*it))
+                widget->setHighlighted(true);
             ++it;
         }
     }
@@ -159,7 +163,8 @@ void ThumbnailView::deselect(int index) {
             return;
     if(mSelection.count() > 1) {
         mSelection.removeAll(index);
-        thumbnails.at(index)->setHighlighted(false);
+        if(auto widget = widgetAt(index))
+            widget->setHighlighted(false);
     }
 }
 
@@ -189,7 +194,8 @@ QList<int> ThumbnailView::selection() {
 
 void ThumbnailView::clearSelection() {
     for(auto i : mSelection)
-        thumbnails.at(i)->setHighlighted(false);
+        if(auto widget = widgetAt(i))
+            widget->setHighlighted(false);
     mSelection.clear();
 }
 
@@ -201,7 +207,7 @@ int ThumbnailView::lastSelected() {
 }
 
 int ThumbnailView::itemCount() {
-    return thumbnails.count();
+    return mItemCount;
 }
 
 void ThumbnailView::show() {
@@ -231,48 +237,11 @@ void ThumbnailView::populate(int newCount) {
     QElapsedTimer t;
     t.start();
     if(newCount >= 0) {
-        /* test this later
-        // reuse existing items
-        auto currentCount = thumbnails.count();
-        if(currentCount > newCount) {
-            qDebug() << this << "removing";
-            for(auto i = currentCount - 1; i >= newCount; i--) {
-                //removeItemFromLayout(i); // slow. is this needed?
-                delete thumbnails.takeLast();
-            }
-            // reset existing
-            QList<ThumbnailWidget*>::iterator i;
-            for(i = thumbnails.begin(); i != thumbnails.end(); ++i)
-                (*i)->reset();
-        } else if(currentCount <= newCount) {
-            // reset existing
-            QList<ThumbnailWidget*>::iterator i;
-            for(i = thumbnails.begin(); i != thumbnails.end(); ++i)
-                (*i)->reset();
-            qDebug() << this << "adding";
-            for(auto i = currentCount; i < newCount; i++) {
-                ThumbnailWidget *widget = createThumbnailWidget();
-                widget->setThumbnailSize(mThumbnailSize);
-                thumbnails.append(widget);
-                addItemToLayout(widget, i);
-            }
-        }
-        */
-
-        if(newCount == thumbnails.count()) {
-            QList<ThumbnailWidget*>::iterator i;
-            for (i = thumbnails.begin(); i != thumbnails.end(); ++i) {
-                (*i)->reset();
-            }
-        } else {
-            removeAll();
-            for(int i = 0; i < newCount; i++) {
-                ThumbnailWidget *widget = createThumbnailWidget();
-                widget->setThumbnailSize(mThumbnailSize);
-                thumbnails.append(widget);
-                addItemToLayout(widget, i);
-            }
-        }
+        // widgets get bound to the new items on the next update
+        for(auto widget : widgets)
+            releaseWidget(widget);
+        widgets.clear();
+        mItemCount = newCount;
     }
     updateLayout();
     fitSceneToContents();
@@ -285,21 +254,26 @@ void ThumbnailView::populate(int newCount) {
 }
 
 void ThumbnailView::addItem() {
-    insertItem(thumbnails.count());
+    insertItem(mItemCount);
 }
 
 // insert at index
 void ThumbnailView::insertItem(int index) {
-    ThumbnailWidget *widget = createThumbnailWidget();
-    thumbnails.insert(index, widget);
-    addItemToLayout(widget, index);
-    updateLayout();
-    fitSceneToContents();
+    insertItems(index, 1);
+}
 
+void ThumbnailView::insertItems(int index, int count) {
+    if(index < 0 || index > mItemCount || count <= 0)
+        return;
     auto newSelection = mSelection;
+    clearSelection();
+    shiftWidgets(index, count);
+    mItemCount += count;
+    fitSceneToContents();
+
     for(int i=0; i < newSelection.count(); i++) {
         if(index <= newSelection[i])
-            newSelection[i]++;
+            newSelection[i] += count;
     }
     select(newSelection);
 
@@ -311,8 +285,10 @@ void ThumbnailView::removeItem(int index) {
     if(checkRange(index)) {
         auto newSelection = mSelection;
         clearSelection();
-        removeItemFromLayout(index);
-        delete thumbnails.takeAt(index);
+        if(auto widget = widgets.take(index))
+            releaseWidget(widget);
+        shiftWidgets(index + 1, -1);
+        mItemCount--;
         fitSceneToContents();
         newSelection.removeAll(index);
         for(int i=0; i < newSelection.count(); i++) {
@@ -330,9 +306,9 @@ void ThumbnailView::removeItem(int index) {
 void ThumbnailView::reloadItem(int index) {
     if(!checkRange(index))
         return;
-    auto thumb = thumbnails.at(index);
-    if(thumb->isLoaded)
-        thumb->unsetThumbnail();
+    auto widget = widgetAt(index);
+    if(widget && widget->isLoaded)
+        widget->unsetThumbnail();
     emit thumbnailsRequested(QList<int>() << index, static_cast<int>(qApp->devicePixelRatio() * mThumbnailSize), mCropThumbnails, true);
 }
 
@@ -354,59 +330,134 @@ void ThumbnailView::setDrawScrollbarIndicator(bool mode) {
 
 void ThumbnailView::setThumbnail(int pos, std::shared_ptr<Thumbnail> thumb) {
     if(thumb && thumb->size() == floor(mThumbnailSize * qApp->devicePixelRatio()) && checkRange(pos)) {
-        thumbnails.at(pos)->setThumbnail(thumb);
+        // nothing to do if the item has scrolled away;
+        // it will be requested again (and served from memory) when it gets back
+        if(auto widget = widgetAt(pos))
+            widget->setThumbnail(thumb);
     }
 }
 
 void ThumbnailView::unloadAllThumbnails() {
-    for(int i = 0; i < thumbnails.count(); i++) {
-        thumbnails.at(i)->unsetThumbnail();
+    for(auto widget : widgets)
+        widget->unsetThumbnail();
+}
+
+ThumbnailWidget *ThumbnailView::widgetAt(int index) {
+    return widgets.value(index, nullptr);
+}
+
+int ThumbnailView::indexAt(QPoint pos) {
+    QPointF scenePos = mapToScene(pos);
+    int first, last;
+    itemRange(QRectF(scenePos, QSizeF(1, 1)), first, last);
+    for(int i = first; i <= last; i++) {
+        if(itemRect(i).contains(scenePos))
+            return i;
+    }
+    return -1;
+}
+
+void ThumbnailView::updateWidgets() {
+    // visible area plus one screen in each direction,
+    // so that there is something to show right away when scrolling
+    QRectF area = mapToScene(viewport()->geometry()).boundingRect();
+    if(mOrientation == Qt::Horizontal)
+        area.adjust(-area.width(), 0, area.width(), 0);
+    else
+        area.adjust(0, -area.height(), 0, area.height());
+    int first, last;
+    itemRange(area, first, last);
+    for(auto it = widgets.begin(); it != widgets.end();) {
+        if(it.key() < first || it.key() > last) {
+            releaseWidget(it.value());
+            it = widgets.erase(it);
+        } else {
+            ++it;
+        }
     }
+    if(last < first)
+        return;
+    QSet<int> selected;
+    for(auto index : mSelection)
+        selected.insert(index);
+    for(int i = first; i <= last; i++) {
+        ThumbnailWidget *widget = widgets.value(i, nullptr);
+        if(!widget) {
+            if(!spareWidgets.isEmpty()) {
+                widget = spareWidgets.takeLast();
+            } else {
+                widget = createThumbnailWidget();
+                scene.addItem(widget);
+            }
+            widget->setHighlighted(selected.contains(i));
+            widget->setVisible(true);
+            widgets.insert(i, widget);
+        }
+        widget->setPos(itemRect(i).topLeft());
+    }
+}
+
+void ThumbnailView::releaseWidget(ThumbnailWidget *widget) {
+    widget->reset();
+    widget->setDropHovered(false);
+    widget->setVisible(false);
+    spareWidgets.append(widget);
+}
+
+void ThumbnailView::shiftWidgets(int from, int delta) {
+    QHash<int, ThumbnailWidget*> shifted;
+    for(auto it = widgets.begin(); it != widgets.end(); ++it)
+        shifted.insert((it.key() >= from) ? it.key() + delta : it.key(), it.value());
+    widgets.swap(shifted);
+}
+
+void ThumbnailView::clearWidgets() {
+    qDeleteAll(widgets);
+    widgets.clear();
+    qDeleteAll(spareWidgets);
+    spareWidgets.clear();
 }
 
 void ThumbnailView::loadVisibleThumbnails() {
     loadTimer.stop();
+    updateWidgets();
     if(isVisible() && !blockThumbnailLoading) {
         QRectF visRect = mapToScene(viewport()->geometry()).boundingRect();
-        QRectF offRectBack;
-        QRectF offRectFront;
-        if(mOrientation == Qt::Horizontal) {
-            offRectBack  = QRectF(visRect.left() - offscreenPreloadArea, visRect.top(),
-                                  offscreenPreloadArea, visRect.height());
-            offRectFront = QRectF(visRect.right(), visRect.top(),
-                                  offscreenPreloadArea, visRect.height());
-        } else {
-            offRectBack  = QRectF(visRect.left(), visRect.top() - offscreenPreloadArea,
-                                  visRect.width(), offscreenPreloadArea);
-            offRectFront = QRectF(visRect.left(), visRect.bottom(),
-                                  visRect.width(), offscreenPreloadArea);
-        }
-        QList<QGraphicsItem *>visibleItems;
-        if(lastScrollDirection == SCROLL_FORWARDS)
-            visibleItems = scene.items(visRect, Qt::IntersectsItemBoundingRect, Qt::AscendingOrder);
+        QRectF loadRect;
+        if(mOrientation == Qt::Horizontal)
+            loadRect = visRect.adjusted(-offscreenPreloadArea, 0, offscreenPreloadArea, 0);
         else
-            visibleItems = scene.items(visRect, Qt::IntersectsItemBoundingRect, Qt::DescendingOrder);
-        visibleItems.append(scene.items(offRectBack,  Qt::IntersectsItemBoundingRect, Qt::DescendingOrder));
-        visibleItems.append(scene.items(offRectFront, Qt::IntersectsItemBoundingRect, Qt::AscendingOrder));
-        // select
+            loadRect = visRect.adjusted(0, -offscreenPreloadArea, 0, offscreenPreloadArea);
+        // Items without a widget are requested too; the presenter keeps
+        // the results in memory until they are scrolled into view.
         QList<int> loadList;
-        for(int i = 0; i < visibleItems.count(); i++) {
-            ThumbnailWidget* widget = qgraphicsitem_cast<ThumbnailWidget*>(visibleItems.at(i));
-            if(widget && !widget->isLoaded) {
-                int idx = thumbnails.indexOf(widget);
-                if(!loadList.contains(idx))
-                    loadList.append(idx);
-            }
-        }
-        // load
-        if(loadList.count())
-            emit thumbnailsRequested(loadList, static_cast<int>(qApp->devicePixelRatio() * mThumbnailSize), mCropThumbnails, false);
-        // unload offscreen
-        if(settings->unloadThumbs()) {
-            for(int i = 0; i < thumbnails.count(); i++)
-                if(!visibleItems.contains(thumbnails.at(i)))
-                    thumbnails.at(i)->unsetThumbnail();
+        int first, last;
+        itemRange(loadRect, first, last);
+        for(int i = first; i <= last; i++) {
+            ThumbnailWidget *widget = widgetAt(i);
+            if(!widget || !widget->isLoaded)
+                loadList.append(i);
         }
+        // Priority: on screen first, then by distance from the viewport center.
+        // Stuff behind the scroll direction counts as twice as far.
+        QPointF center = visRect.center();
+        auto priority = [&](int idx) {
+            QRectF rect = itemRect(idx);
+            qreal distance = (mOrientation == Qt::Horizontal) ? rect.center().x() - center.x()
+                                                              : rect.center().y() - center.y();
+            if(lastScrollDirection == SCROLL_BACKWARDS)
+                distance = -distance;
+            if(distance < 0)
+                distance *= -2;
+            if(!visRect.intersects(rect))
+                distance += 4 * offscreenPreloadArea;
+            return distance;
+        };
+        std::stable_sort(loadList.begin(), loadList.end(), [&](int a, int b) {
+            return priority(a) < priority(b);
+        });
+        // Load. Sent even when empty so that the presenter can drop what's no longer needed
+        emit thumbnailsRequested(loadList, static_cast<int>(qApp->devicePixelRatio() * mThumbnailSize), mCropThumbnails, false);
     }
 }
 
@@ -448,27 +499,32 @@ bool ThumbnailView::atSceneEnd() {
 }
 
 bool ThumbnailView::checkRange(int pos) {
-    return pos >= 0 && pos < thumbnails.count();
+    return pos >= 0 && pos < mItemCount;
 }
 
 void ThumbnailView::updateLayout() {
-
+    // all items are the same size
+    ThumbnailWidget *widget = createThumbnailWidget();
+    cellSize = widget->boundingRect().size();
+    delete widget;
 }
 
 // fit scene to it's contents size
 void ThumbnailView::fitSceneToContents() {
     QPointF center;
+    QSizeF contents = contentsSize();
     if(this->mOrientation == Qt::Vertical) {
-        int height = qMax((int)scene.itemsBoundingRect().height(), this->height());
+        int height = qMax((int)contents.height(), this->height());
         scene.setSceneRect(QRectF(0,0, this->width(), height));
         center = mapToScene(viewport()->rect().center());
         QGraphicsView::centerOn(0, center.y() + 1);
     } else {
-        int width = qMax((int)scene.itemsBoundingRect().width(), this->width());
+        int width = qMax((int)contents.width(), this->width());
         scene.setSceneRect(QRectF(0,0, width, this->height()));
         center = mapToScene(viewport()->rect().center());
         QGraphicsView::centerOn(center.x() + 1, 0);
     }
+    updateWidgets();
 }
 
 //################### scrolling ######################
@@ -522,32 +578,26 @@ void ThumbnailView::scrollByItem(int delta) {
     int minScroll = qMin(thumbnailSize() / 2, 100);
     // grab fully visible thumbs
     QRectF visRect = mapToScene(viewport()->geometry()).boundingRect().adjusted(-minScroll,-minScroll,minScroll,minScroll);
-    QList<QGraphicsItem *> visibleItems;
-    visibleItems = scene.items(visRect, Qt::ContainsItemBoundingRect, Qt::AscendingOrder);
-    if(thumbnails.isEmpty() || visibleItems.isEmpty())
+    int first, last;
+    itemRange(visRect, first, last);
+    while(first <= last && !visRect.contains(itemRect(first)))
+        first++;
+    while(last >= first && !visRect.contains(itemRect(last)))
+        last--;
+    if(last < first)
         return;
-    int target = 0;
     // select scroll target
-    if(delta > 0) { // up / left
-        ThumbnailWidget* widget = qgraphicsitem_cast<ThumbnailWidget*>(visibleItems.first());
-        if(!widget)
-            return;
-        target = thumbnails.indexOf(widget) - 1;
-    } else { // down / right
-        ThumbnailWidget* widget = qgraphicsitem_cast<ThumbnailWidget*>(visibleItems.last());
-        if(!widget)
-            return;
-        target = thumbnails.indexOf(widget) + 1;
-    }
-    scrollToItem(target);
+    if(delta > 0) // up / left
+        scrollToItem(first - 1);
+    else // down / right
+        scrollToItem(last + 1);
 }
 
 void ThumbnailView::scrollToItem(int index) {
     if(!checkRange(index))
         return;
-    ThumbnailWidget *item = thumbnails.at(index);
     QRectF sceneRect = mapToScene(viewport()->rect()).boundingRect();
-    QRectF itemRect = item->mapRectToScene(item->rect());
+    QRectF itemRect = this->itemRect(index);
     bool visible = sceneRect.contains(itemRect);
     if(!visible) {
         int delta = 0;
@@ -626,9 +676,8 @@ void ThumbnailView::scrollSmooth(int angleDelta) {
 void ThumbnailView::mousePressEvent(QMouseEvent *event) {
     mouseReleaseSelect = false;
     dragStartPos = QPoint(0,0);
-    ThumbnailWidget *item = dynamic_cast<ThumbnailWidget*>(itemAt(event->pos()));
-    if(item) {
-        int index = thumbnails.indexOf(item);
+    int index = indexAt(event->pos());
+    if(index != -1) {
         if(event->button() == Qt::LeftButton) {
             if(event->modifiers() & Qt::ControlModifier) {
                 if(!selection().contains(index))
@@ -661,8 +710,8 @@ void ThumbnailView::mouseMoveEvent(QMouseEvent *event) {
     if(event->buttons() != Qt::LeftButton || !selection().count())
         return;
     if(QLineF(dragStartPos, event->pos()).length() >= 40) {
-        auto *item = dynamic_cast<ThumbnailWidget*>(itemAt(dragStartPos));
-        if(item && selection().contains(thumbnails.indexOf(item)))
+        int index = indexAt(dragStartPos);
+        if(index != -1 && selection().contains(index))
             emit draggedOut();
     }
 }
@@ -670,19 +719,17 @@ void ThumbnailView::mouseMoveEvent(QMouseEvent *event) {
 void ThumbnailView::mouseReleaseEvent(QMouseEvent *event) {
     QGraphicsView::mouseReleaseEvent(event);
     if(mouseReleaseSelect && QLineF(dragStartPos, event->pos()).length() < 40) {
-        ThumbnailWidget *item = dynamic_cast<ThumbnailWidget*>(itemAt(event->pos()));
-        if(item) {
-            int index = thumbnails.indexOf(item);
+        int index = indexAt(event->pos());
+        if(index != -1)
             select(index);
-        }
     }
 }
 
 void ThumbnailView::mouseDoubleClickEvent(QMouseEvent *event) {
     if(event->button() == Qt::LeftButton) {
-        ThumbnailWidget *item = dynamic_cast<ThumbnailWidget*>(itemAt(event->pos()));
-        if(item) {
-            emit itemActivated(thumbnails.indexOf(item));
+        int index = indexAt(event->pos());
+        if(index != -1) {
+            emit itemActivated(index);
             return;
         }
     }
@@ -1,9 +1,11 @@
 #pragma once
 
-/* This class manages QGraphicsScene, ThumbnailWidget list,
+/* This class manages QGraphicsScene, ThumbnailWidgets,
  * scrolling, requesting and setting thumbnails.
- * It doesn't do actual positioning of thumbnails within the scene.
- * (But maybe it should?)
+ * Only items around the viewport have a widget; the widgets are reused
+ * while scrolling, so the item count doesn't matter much.
+ * All items are the same size and their positions are calculated from
+ * the index; it doesn't do the actual math though.
  *
  * Usage: subclass, implement layout-related stuff
  */
@@ -17,6 +19,8 @@
 #include <QTimer>
 #include <QElapsedTimer>
 #include <QScreen>
+#include <QHash>
+#include <QSet>
 
 #include "gui/customwidgets/thumbnailwidget.h"
 #include "gui/idirectoryview.h"
@@ -62,6 +66,7 @@ public slots:
     virtual void populate(int count) override;
     virtual void setThumbnail(int pos, std::shared_ptr<Thumbnail> thumb) override;
     virtual void insertItem(int index) override;
+    virtual void insertItems(int index, int count) override;
     virtual void removeItem(int index) override;
     virtual void reloadItem(int index) override;
     virtual void setDragHover(int index) override;
@@ -84,7 +89,11 @@ private:
     bool mCropThumbnails, mouseReleaseSelect;
     ThumbnailSelectMode selectMode;
     QPoint dragStartPos;
-    ThumbnailWidget* dragTarget;
+    QList<ThumbnailWidget*> spareWidgets;
+
+    void releaseWidget(ThumbnailWidget *widget);
+    // adds delta to the index of every widget starting from index "from"
+    void shiftWidgets(int from, int delta);
 
     void createScrollTimeLine();
     QElapsedTimer scrollFrameTimer;
@@ -94,7 +103,10 @@ private:
 
 protected:
     QGraphicsScene scene;
-    QList<ThumbnailWidget*> thumbnails;
+    // item index -> widget, for the items near the viewport
+    QHash<int, ThumbnailWidget*> widgets;
+    int mItemCount;
+    QSizeF cellSize;
     QScrollBar *scrollBar;
     QTimeLine *scrollTimeLine;
     QPointF viewportCenter;
@@ -120,11 +132,23 @@ protected:
     bool atSceneEnd();
 
     bool checkRange(int pos);
+    // nullptr if the item is too far from the viewport
+    ThumbnailWidget *widgetAt(int index);
+    // index of the item under a viewport position, or -1
+    int indexAt(QPoint pos);
+    // Gives widgets to the items around the viewport, takes them from the rest
+    void updateWidgets();
+    // Deletes all widgets; new ones are made on the next update.
+    // For when their style or size changes.
+    void clearWidgets();
 
     virtual ThumbnailWidget *createThumbnailWidget() = 0;
-    virtual void addItemToLayout(ThumbnailWidget* widget, int pos) = 0;
-    virtual void removeItemFromLayout(int pos) = 0;
-    virtual void removeAll() = 0;
+    // scene rect of the item
+    virtual QRectF itemRect(int index) = 0;
+    // first & last item that can intersect the rect; last < first if none
+    virtual void itemRange(const QRectF &rect, int &first, int &last) = 0;
+    virtual QSizeF contentsSize() = 0;
+    // updates cellSize; call when widget style or size changes
     virtual void updateLayout();
     virtual void fitSceneToContents();
     virtual void updateScrollbarIndicator() = 0;
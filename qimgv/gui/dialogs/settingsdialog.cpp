@@ -74,11 +74,15 @@ SettingsDialog::SettingsDialog(QWidget *parent) :
     //ui->novideoInfoLabel->setHidden(true);
 #endif
 
+    // item data holds the ScalingFilter value; some of them are optional
+    ui->scalingQualityComboBox->setItemData(0, QI_FILTER_NEAREST);
+    ui->scalingQualityComboBox->setItemData(1, QI_FILTER_BILINEAR);
 #ifdef USE_OPENCV
-    ui->scalingQualityComboBox->addItem("Bilinear+sharpen (OpenCV)");
-    ui->scalingQualityComboBox->addItem("Bicubic (OpenCV)");
-    ui->scalingQualityComboBox->addItem("Bicubic+sharpen (OpenCV)");
+    ui->scalingQualityComboBox->addItem("Bilinear+sharpen (OpenCV)", QI_FILTER_CV_BILINEAR_SHARPEN);
+    ui->scalingQualityComboBox->addItem("Bicubic (OpenCV)", QI_FILTER_CV_CUBIC);
+    ui->scalingQualityComboBox->addItem("Bicubic+sharpen (OpenCV)", QI_FILTER_CV_CUBIC_SHARPEN);
 #endif
+    ui->scalingQualityComboBox->addItem("Lanczos-3", QI_FILTER_LANCZOS);
 
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
     ui->memoryLimitSpinBox->setEnabled(false);
@@ -111,8 +115,23 @@ SettingsDialog::SettingsDialog(QWidget *parent) :
     langs.insert("system", "System language");
     ui->langComboBox->insertItem(0, "System language");
 
+    connect(ui->thumbnailCacheCleanButton, &QPushButton::clicked, [this]() {
+        updateThumbnailCacheStats(true);
+    });
+    connect(&thumbnailSweeper, &ThumbnailSweeper::finished, this, [this](ThumbnailCacheStats stats) {
+        QString text = tr("%n thumbnail(s), %1 MB", "", static_cast<int>(stats.entries))
+                .arg(QString::number(stats.bytes / (1024.0 * 1024.0), 'f', 1));
+        if(stats.removed)
+            text.append(tr(", %1 removed").arg(stats.removed));
+        else if(stats.orphans)
+            text.append(tr(", %1 orphaned").arg(stats.orphans));
+        ui->thumbnailCacheStatsLabel->setText(text);
+        ui->thumbnailCacheCleanButton->setEnabled(true);
+    });
+
     connect(this, &SettingsDialog::settingsChanged, settings, &Settings::sendChangeNotification);
     readSettings();
+    updateThumbnailCacheStats(false);
 
     adjustSizeToContents();
 }
@@ -121,6 +140,15 @@ SettingsDialog::~SettingsDialog() {
     delete ui;
 }
 //------------------------------------------------------------------------------
+void SettingsDialog::updateThumbnailCacheStats(bool clean) {
+    if(thumbnailSweeper.isRunning())
+        return;
+    ui->thumbnailCacheStatsLabel->setText(tr("Scanning cache..."));
+    ui->thumbnailCacheCleanButton->setEnabled(false);
+    // use the limits from the dialog, not the saved ones
+    thumbnailSweeper.start(!clean, ui->thumbnailCacheLimitSpinBox->value(), ui->thumbnailCacheMaxAgeSpinBox->value());
+}
+//------------------------------------------------------------------------------
 // an attempt to force minimum width to fit contents
 void SettingsDialog::adjustSizeToContents() {
     // general tab
@@ -174,7 +202,12 @@ void SettingsDialog::readSettings() {
     ui->transparencyGridCheckBox->setChecked(settings->transparencyGrid());
     ui->enableSmoothScrollCheckBox->setChecked(settings->enableSmoothScroll());
     ui->usePreloaderCheckBox->setChecked(settings->usePreloader());
+    ui->preloadAheadSpinBox->setValue(settings->preloadAhead());
+    ui->preloadBehindSpinBox->setValue(settings->preloadBehind());
     ui->useThumbnailCacheCheckBox->setChecked(settings->useThumbnailCache());
+    ui->thumbnailKeyModeComboBox->setCurrentIndex(settings->thumbnailKeyMode());
+    ui->thumbnailCacheLimitSpinBox->setValue(settings->thumbnailCacheLimit());
+    ui->thumbnailCacheMaxAgeSpinBox->setValue(settings->thumbnailCacheMaxAge());
     ui->smoothUpscalingCheckBox->setChecked(settings->smoothUpscaling());
     ui->expandImageCheckBox->setChecked(settings->expandImage());
     ui->expandImagesGroupContents->setEnabled(settings->expandImage());
@@ -205,7 +238,6 @@ void SettingsDialog::readSettings() {
     ui->slideshowIntervalSpinBox->setValue(settings->slideshowInterval());
     ui->imageScrollingComboBox->setCurrentIndex(settings->imageScrolling());
     ui->saveOverlayCheckBox->setChecked(settings->showSaveOverlay());
-    ui->unloadThumbsCheckBox->setChecked(settings->unloadThumbs());
     if(settings->thumbPanelStyle() == TH_PANEL_SIMPLE)
         ui->thumbStyleSimple->setChecked(true);
     else
@@ -249,6 +281,7 @@ void SettingsDialog::readSettings() {
     onThumbnailerThreadsSliderChanged(ui->thumbnailerThreadsSlider->value());
 
     ui->memoryLimitSpinBox->setValue(settings->memoryAllocationLimit());
+    ui->imageCacheSizeSpinBox->setValue(settings->imageCacheSize());
 
     // language
     QString langName = langs.value(settings->language());
@@ -266,7 +299,7 @@ void SettingsDialog::readSettings() {
         ui->fitMode1to1->setChecked(true);
 
     // ##### UI #####
-    ui->scalingQualityComboBox->setCurrentIndex(settings->scalingFilter());
+    ui->scalingQualityComboBox->setCurrentIndex(qMax(0, ui->scalingQualityComboBox->findData(settings->scalingFilter())));
     ui->fullscreenCheckBox->setChecked(settings->fullscreenMode());
     ui->pinPanelCheckBox->setChecked(settings->panelPinned());
     ui->panelPositionComboBox->setCurrentIndex(settings->panelPosition());
@@ -309,7 +342,12 @@ void SettingsDialog::saveSettings() {
     settings->setTransparencyGrid(ui->transparencyGridCheckBox->isChecked());
     settings->setEnableSmoothScroll(ui->enableSmoothScrollCheckBox->isChecked());
     settings->setUsePreloader(ui->usePreloaderCheckBox->isChecked());
+    settings->setPreloadAhead(ui->preloadAheadSpinBox->value());
+    settings->setPreloadBehind(ui->preloadBehindSpinBox->value());
     settings->setUseThumbnailCache(ui->useThumbnailCacheCheckBox->isChecked());
+    settings->setThumbnailKeyMode(static_cast<ThumbnailKeyMode>(ui->thumbnailKeyModeComboBox->currentIndex()));
+    settings->setThumbnailCacheLimit(ui->thumbnailCacheLimitSpinBox->value());
+    settings->setThumbnailCacheMaxAge(ui->thumbnailCacheMaxAgeSpinBox->value());
     settings->setSmoothUpscaling(ui->smoothUpscalingCheckBox->isChecked());
     settings->setExpandImage(ui->expandImageCheckBox->isChecked());
     settings->setSmoothAnimatedImages(ui->smoothAnimatedImagesCheckBox->isChecked());
@@ -353,10 +391,9 @@ void SettingsDialog::saveSettings() {
         settings->setFolderEndAction(FOLDER_END_GOTO_ADJACENT);
 
     settings->setMpvBinary(ui->mpvLineEdit->text());
-    settings->setScalingFilter(static_cast<ScalingFilter>(ui->scalingQualityComboBox->currentIndex()));
+    settings->setScalingFilter(static_cast<ScalingFilter>(ui->scalingQualityComboBox->currentData().toInt()));
     settings->setImageScrolling(static_cast<ImageScrolling>(ui->imageScrollingComboBox->currentIndex()));
     settings->setShowSaveOverlay(ui->saveOverlayCheckBox->isChecked());
-    settings->setUnloadThumbs(ui->unloadThumbsCheckBox->isChecked());
     if(ui->thumbStyleSimple->isChecked())
         settings->setThumbPanelStyle(TH_PANEL_SIMPLE);
     else
@@ -381,6 +418,7 @@ void SettingsDialog::saveSettings() {
     settings->setExpandLimit(ui->expandLimitSlider->value());
     settings->setThumbnailerThreadCount(ui->thumbnailerThreadsSlider->value());
     settings->setMemoryAllocationLimit(ui->memoryLimitSpinBox->value());
+    settings->setImageCacheSize(ui->imageCacheSizeSpinBox->value());
 
     settings->setUseSystemColorScheme(ui->useSystemColorsCheckBox->isChecked());
 
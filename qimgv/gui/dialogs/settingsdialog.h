@@ -17,6 +17,7 @@
 #include "gui/dialogs/scripteditordialog.h"
 #include "settings.h"
 #include "components/actionmanager/actionmanager.h"
+#include "components/cache/thumbnailsweeper.h"
 
 namespace Ui {
 class SettingsDialog;
@@ -52,6 +53,8 @@ private:
     void adjustSizeToContents();
     QMap<QString, QString> langs; // <"en_US", "English">
     QButtonGroup fitModeGrp, folderEndGrp, zoomIndGrp;
+    ThumbnailSweeper thumbnailSweeper;
+    void updateThumbnailCacheStats(bool clean);
 
 private slots:
     void saveSettings();
@@ -4,8 +4,11 @@
 
 FolderGridView::FolderGridView(QWidget *parent)
     : ThumbnailView(Qt::Vertical, parent),
+      columns(1),
+      centerOffset(0),
       shiftedCol(-1)
 {
+    thumbStyle = (settings->folderViewMode() == FV_SIMPLE) ? THUMB_SIMPLE : THUMB_NORMAL;
     offscreenPreloadArea = 2300;
 
     this->setAcceptDrops(true);
@@ -29,12 +32,9 @@ FolderGridView::FolderGridView(QWidget *parent)
 
 void FolderGridView::dropEvent(QDropEvent *event) {
     event->accept();
-    ThumbnailWidget *item = dynamic_cast<ThumbnailWidget*>(itemAt(event->pos()));
-    int index = -1;
-    if(item) {
-        index = thumbnails.indexOf(item);
-        item->setDropHovered(false);
-    }
+    int index = indexAt(event->pos());
+    if(auto widget = widgetAt(index))
+        widget->setDropHovered(false);
     emit droppedInto(event->mimeData(), event->source(), index);
 }
 
@@ -44,29 +44,25 @@ void FolderGridView::dragEnterEvent(QDragEnterEvent *event) {
 
 void FolderGridView::dragMoveEvent(QDragMoveEvent *event) {
     event->accept();
-    ThumbnailWidget *item = dynamic_cast<ThumbnailWidget*>(itemAt(event->pos()));
-    int index = -1;
-    if(item)
-        index = thumbnails.indexOf(item);
+    int index = indexAt(event->pos());
     // unselect previous
-    if(index != lastDragTarget && checkRange(lastDragTarget))
-        thumbnails.at(lastDragTarget)->setDropHovered(false);
+    if(index != lastDragTarget) {
+        if(auto widget = widgetAt(lastDragTarget))
+            widget->setDropHovered(false);
+    }
     emit draggedOver(index);
     lastDragTarget = index;
 }
 
 void FolderGridView::dragLeaveEvent(QDragLeaveEvent *event) {
     event->accept();
-    if(lastDragTarget < 0 || lastDragTarget >= thumbnails.count())
-        return;
-    thumbnails.at(lastDragTarget)->setDropHovered(false);
+    if(auto widget = widgetAt(lastDragTarget))
+        widget->setDropHovered(false);
 }
 
 void FolderGridView::setDragHover(int index) {
-    if(!checkRange(index))
-        return;
-    auto item = thumbnails.at(index);
-    item->setDropHovered(true);
+    if(auto widget = widgetAt(index))
+        widget->setDropHovered(true);
 }
 
 void FolderGridView::onitemSelected() {
@@ -74,10 +70,9 @@ void FolderGridView::onitemSelected() {
 }
 
 void FolderGridView::updateScrollbarIndicator() {
-    if(!thumbnails.count() || !selection().count())
+    if(!itemCount() || !selection().count())
         return;
-    ThumbnailWidget *thumb = thumbnails.at(lastSelected());
-    qreal itemCenter = (thumb->pos().y() + (thumb->height() / 2)) / scene.height();
+    qreal itemCenter = itemRect(lastSelected()).center().y() / scene.height();
     indicator = QRect(2, scrollBar->height() * itemCenter - indicatorSize, scrollBar->width() - 4, indicatorSize);
 }
 
@@ -94,24 +89,23 @@ void FolderGridView::hide() {
 }
 
 void FolderGridView::setShowLabels(bool mode) {
-    ThumbnailStyle style = mode ? THUMB_NORMAL : THUMB_SIMPLE;
-    for(int i = 0; i < thumbnails.count(); i++)
-        thumbnails.at(i)->setThumbStyle(style);
+    thumbStyle = mode ? THUMB_NORMAL : THUMB_SIMPLE;
+    clearWidgets();
     updateLayout();
     fitSceneToContents();
     focusOnSelection();
+    loadVisibleThumbnails();
 }
 
 void FolderGridView::focusOnSelection() {
-    if(!thumbnails.count() || lastSelected() == -1)
+    if(!itemCount() || lastSelected() == -1)
         return;
-    ThumbnailWidget *thumb = thumbnails.at(lastSelected());
-    ensureVisible(thumb, 0, 0);
+    ensureVisible(itemRect(lastSelected()), 0, 0);
 }
 
 void FolderGridView::selectAll() {
     QList<int> list;
-    for(int i = 0; i < thumbnails.count(); i++)
+    for(int i = 0; i < itemCount(); i++)
         list << i;
     // preserve last selected index by putting it at the end of a new selection
     // this is simpler but it changes selection order a bit
@@ -130,50 +124,99 @@ void FolderGridView::scrollToCurrent() {
 void FolderGridView::focusOn(int index) {
     if(!checkRange(index))
         return;
-    ThumbnailWidget *thumb = thumbnails.at(index);
-    ensureVisible(thumb, 0, 0);
+    ensureVisible(itemRect(index), 0, 0);
     loadVisibleThumbnailsDelayed();
 }
 
 void FolderGridView::setupLayout() {
     this->setAlignment(Qt::AlignHCenter);
-
-    flowLayout = new FlowLayout();
-    flowLayout->setContentsMargins(9,6,9,0);
     setFrameShape(QFrame::NoFrame);
-    scene.addItem(&holderWidget);
-    holderWidget.setLayout(flowLayout);
-    holderWidget.setContentsMargins(0,0,0,0);
 }
 
 ThumbnailWidget* FolderGridView::createThumbnailWidget() {
     ThumbnailWidget *widget = new ThumbnailWidget();
     widget->setPadding(8);
-    ThumbnailStyle style = (settings->folderViewMode() == FV_SIMPLE) ? THUMB_SIMPLE : THUMB_NORMAL;
-    widget->setThumbStyle(style);
+    widget->setThumbStyle(thumbStyle);
     widget->setThumbnailSize(this->mThumbnailSize); // TODO: constructor
     return widget;
 }
 
-void FolderGridView::addItemToLayout(ThumbnailWidget* widget, int pos) {
-    scene.addItem(widget);
-    flowLayout->insertItem(pos, widget);
+void FolderGridView::updateLayout() {
+    shiftedCol = -1;
+    ThumbnailView::updateLayout();
+    updateGrid();
 }
 
-void FolderGridView::removeItemFromLayout(int pos) {
-    flowLayout->removeAt(pos);
+// Rows are filled left to right; the whole grid is centered horizontally
+// once there is at least one full row.
+void FolderGridView::updateGrid() {
+    qreal layoutWidth = width();
+    if(scrollBar->isVisible())
+        layoutWidth -= scrollBar->width();
+    const qreal maxRowWidth = layoutWidth - gridMargins.left() - gridMargins.right();
+    columns = 1;
+    centerOffset = 0;
+    if(cellSize.width() <= 0)
+        return;
+    columns = qMax(1, static_cast<int>(maxRowWidth / cellSize.width()));
+    if(itemCount() >= columns && maxRowWidth > cellSize.width())
+        centerOffset = static_cast<int>(fmod(maxRowWidth, cellSize.width()) / 2);
 }
 
-void FolderGridView::removeAll() {
-    flowLayout->clear();
-    qDeleteAll(thumbnails);
-    thumbnails.clear();
+QRectF FolderGridView::itemRect(int index) {
+    QPointF pos(gridMargins.left() + centerOffset + (index % columns) * cellSize.width(),
+                gridMargins.top() + (index / columns) * cellSize.height());
+    return QRectF(pos, cellSize);
 }
 
-void FolderGridView::updateLayout() {
-    shiftedCol = -1;
-    flowLayout->invalidate();
-    flowLayout->activate();
+void FolderGridView::itemRange(const QRectF &rect, int &first, int &last) {
+    first = 0;
+    last = -1;
+    if(!itemCount() || cellSize.height() <= 0)
+        return;
+    int firstRow = static_cast<int>(std::floor((rect.top() - gridMargins.top()) / cellSize.height()));
+    int lastRow = static_cast<int>(std::floor((rect.bottom() - gridMargins.top()) / cellSize.height()));
+    if(lastRow < 0)
+        return;
+    first = qMax(0, firstRow) * columns;
+    last = qMin(itemCount() - 1, (lastRow + 1) * columns - 1);
+}
+
+QSizeF FolderGridView::contentsSize() {
+    int rows = (itemCount() + columns - 1) / columns;
+    return QSizeF(width(), gridMargins.top() + rows * cellSize.height() + gridMargins.bottom());
+}
+
+int FolderGridView::itemAbove(int index) {
+    if(!checkRange(index))
+        return -1;
+    int indexAbove = index - columns;
+    if(indexAbove >= 0)
+        return indexAbove;
+    else
+        return index;
+}
+
+int FolderGridView::itemBelow(int index) {
+    if(!checkRange(index))
+        return -1;
+    if(sameRow(index, itemCount() - 1))
+        return index;
+    int indexBelow = index + columns;
+    if(indexBelow < itemCount())
+        return indexBelow;
+    else
+        return itemCount() - 1;
+}
+
+bool FolderGridView::sameRow(int one, int two) {
+    return (one / columns) == (two / columns);
+}
+
+int FolderGridView::columnOf(int index) {
+    if(!checkRange(index))
+        return -1;
+    return index % columns;
 }
 
 // block native tab-switching so we can use it in shortcuts
@@ -206,7 +249,7 @@ void FolderGridView::keyPressEvent(QKeyEvent *event) {
 
     // handle selection
 
-    if(!thumbnails.count())
+    if(!itemCount())
         return;
     int newIndex;
 
@@ -221,24 +264,24 @@ void FolderGridView::keyPressEvent(QKeyEvent *event) {
         break;
 
     case Qt::Key_Right:
-        if(lastSelected() == thumbnails.count() - 1)
+        if(lastSelected() == itemCount() - 1)
             return;
-        if(!rangeSelection && lastSelected() == thumbnails.count() - 1) {
+        if(!rangeSelection && lastSelected() == itemCount() - 1) {
             select(lastSelected());
             return;
         }
         shiftedCol = -1;
         newIndex = lastSelected() + 1;
         if(!checkRange(newIndex))
-            newIndex = thumbnails.count() - 1;
+            newIndex = itemCount() - 1;
         break;
 
     case Qt::Key_Up:
-        if(lastSelected() == -1 || flowLayout->sameRow(0, lastSelected()))
+        if(lastSelected() == -1 || sameRow(0, lastSelected()))
             return;
-        newIndex = flowLayout->itemAbove(lastSelected());
+        newIndex = itemAbove(lastSelected());
         if(shiftedCol >= 0) {
-            int diff = shiftedCol - flowLayout->columnOf(lastSelected());
+            int diff = shiftedCol - columnOf(lastSelected());
             newIndex += diff;
             shiftedCol = -1;
         }
@@ -247,48 +290,48 @@ void FolderGridView::keyPressEvent(QKeyEvent *event) {
         break;
 
     case Qt::Key_Down:
-        if(lastSelected() == -1 || flowLayout->sameRow(lastSelected(), thumbnails.count() - 1))
+        if(lastSelected() == -1 || sameRow(lastSelected(), itemCount() - 1))
             return;
         shiftedCol = -1;
-        newIndex = flowLayout->itemBelow(lastSelected());
+        newIndex = itemBelow(lastSelected());
         if(!checkRange(newIndex))
-            newIndex = thumbnails.count() - 1;
-        if(flowLayout->columnOf(newIndex) != flowLayout->columnOf(lastSelected()))
-            shiftedCol = flowLayout->columnOf(lastSelected());
+            newIndex = itemCount() - 1;
+        if(columnOf(newIndex) != columnOf(lastSelected()))
+            shiftedCol = columnOf(lastSelected());
         break;
 
     case Qt::Key_PageUp:
-        if(lastSelected() == -1 || flowLayout->sameRow(0, lastSelected()))
+        if(lastSelected() == -1 || sameRow(0, lastSelected()))
             return;
         newIndex = lastSelected();
         int tmp;
         // 4 rows up
         for(int i = 0; i < 4; i++) {
-            tmp = flowLayout->itemAbove(newIndex);
+            tmp = itemAbove(newIndex);
             if(checkRange(tmp))
                 newIndex = tmp;
         }
         if(shiftedCol >= 0) {
-            int diff = shiftedCol - flowLayout->columnOf(newIndex);
+            int diff = shiftedCol - columnOf(newIndex);
             newIndex += diff;
             shiftedCol = -1;
         }
         break;
 
     case Qt::Key_PageDown:
-        if(lastSelected() == -1 || flowLayout->sameRow(lastSelected(), thumbnails.count() - 1))
+        if(lastSelected() == -1 || sameRow(lastSelected(), itemCount() - 1))
             return;
         shiftedCol = -1;
         newIndex = lastSelected();
         int tmp2;
         // 4 rows down
         for(int i = 0; i < 4; i++) {
-            tmp2 = flowLayout->itemBelow(newIndex);
+            tmp2 = itemBelow(newIndex);
             if(checkRange(tmp2))
                 newIndex = tmp2;
         }
-        if(flowLayout->columnOf(newIndex) != flowLayout->columnOf(lastSelected()))
-            shiftedCol = flowLayout->columnOf(lastSelected());
+        if(columnOf(newIndex) != columnOf(lastSelected()))
+            shiftedCol = columnOf(lastSelected());
         break;
 
     case Qt::Key_Home:
@@ -298,7 +341,7 @@ void FolderGridView::keyPressEvent(QKeyEvent *event) {
 
     case Qt::Key_End:
         shiftedCol = -1;
-        newIndex = thumbnails.count() - 1;
+        newIndex = itemCount() - 1;
         break;
 
     default:
@@ -335,22 +378,17 @@ void FolderGridView::zoomOut() {
 void FolderGridView::setThumbnailSize(int newSize) {
     newSize = clamp(newSize, THUMBNAIL_SIZE_MIN, THUMBNAIL_SIZE_MAX);
     mThumbnailSize = newSize;
-    for(int i = 0; i < thumbnails.count(); i++) {
-        thumbnails.at(i)->setThumbnailSize(newSize);
-    }
+    clearWidgets();
     updateLayout();
     fitSceneToContents();
     if(lastSelected() != -1)
-        ensureVisible(thumbnails.at(lastSelected()), 0, 40);
+        ensureVisible(itemRect(lastSelected()), 0, 40);
     emit thumbnailSizeChanged(mThumbnailSize);
     loadVisibleThumbnails();
 }
 
 void FolderGridView::fitSceneToContents() {
-    if(scrollBar->isVisible())
-        holderWidget.setGeometry(0,0, width() - scrollBar->width(), height());
-    else
-        holderWidget.setGeometry(0,0, width(), height());
+    updateGrid();
     ThumbnailView::fitSceneToContents();
 }
 
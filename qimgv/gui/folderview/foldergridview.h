@@ -4,7 +4,6 @@
 
 #include "gui/customwidgets/thumbnailview.h"
 #include "gui/customwidgets/thumbnailwidget.h"
-#include "gui/flowlayout.h"
 #include "utils/stuff.h"
 #include "components/actionmanager/actionmanager.h"
 
@@ -31,8 +30,16 @@ public slots:
     virtual void setDragHover(int index) override;
 
 private:
-    FlowLayout *flowLayout;
-    QGraphicsWidget holderWidget;
+    // all items are the same size, so the grid is just a few numbers
+    int columns;
+    qreal centerOffset;
+    const QMarginsF gridMargins = QMarginsF(9, 6, 9, 0);
+    ThumbnailStyle thumbStyle;
+    void updateGrid();
+    int itemAbove(int index);
+    int itemBelow(int index);
+    bool sameRow(int one, int two);
+    int columnOf(int index);
     int shiftedCol;
     void scrollToCurrent();
     int lastDragTarget = -1;
@@ -43,9 +50,9 @@ private slots:
 protected:
     void resizeEvent(QResizeEvent *event) override;
     virtual void updateScrollbarIndicator() override;
-    void addItemToLayout(ThumbnailWidget *widget, int pos) override;
-    void removeItemFromLayout(int pos) override;
-    void removeAll() override;
+    QRectF itemRect(int index) override;
+    void itemRange(const QRectF &rect, int &first, int &last) override;
+    QSizeF contentsSize() override;
     void setupLayout();
     ThumbnailWidget *createThumbnailWidget() override;
     void updateLayout() override;
@@ -346,6 +346,10 @@ void FolderView::insertItem(int index) {
     ui->thumbnailGrid->insertItem(index);
 }
 
+void FolderView::insertItems(int index, int count) {
+    ui->thumbnailGrid->insertItems(index, count);
+}
+
 void FolderView::removeItem(int index) {
     ui->thumbnailGrid->removeItem(index);
 }
@@ -116,6 +116,14 @@ void FolderViewProxy::insertItem(int index) {
     }
 }
 
+void FolderViewProxy::insertItems(int index, int count) {
+    if(folderView) {
+        folderView->insertItems(index, count);
+    } else {
+        stateBuf.itemCount += count;
+    }
+}
+
 void FolderViewProxy::removeItem(int index) {
     if(folderView) {
         folderView->removeItem(index);
@@ -21,6 +21,7 @@ public:
     virtual QList<int> selection() = 0;
     virtual void setDirectoryPath(QString path) = 0;
     virtual void insertItem(int index) = 0;
+    virtual void insertItems(int index, int count) = 0;
     virtual void removeItem(int index) = 0;
     virtual void reloadItem(int index) = 0;
     virtual void setDragHover(int index) = 0;
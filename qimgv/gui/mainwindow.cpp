@@ -225,13 +225,32 @@ void MW::preShowResize(QSize sz) {
     qApp->processEvents(); // not needed anymore with patched qt?
 }
 
-void MW::showImage(std::unique_ptr<QPixmap> pixmap) {
+void MW::showImage(std::unique_ptr<QPixmap> pixmap, std::shared_ptr<TileSource> tiles) {
     if(settings->autoResizeWindow())
-        preShowResize(pixmap->size());
-    viewerWidget->showImage(std::move(pixmap));
+        preShowResize(tiles ? tiles->size() : pixmap->size());
+    viewerWidget->showImage(std::move(pixmap), tiles);
     updateCropPanelData();
 }
 
+// size for the quick first-stage decode of large images
+QSize MW::previewSize() {
+    // window size is derived from the image, so no guessing here
+    if(settings->autoResizeWindow())
+        return QSize();
+    return viewerWidget->previewSize();
+}
+
+// size at which an image will be shown when opened next, if the viewer is going to ask for scaling
+QSize MW::prescaleSize(QSize imageSize) {
+    if(settings->autoResizeWindow() || currentViewMode() != MODE_DOCUMENT)
+        return QSize();
+    return viewerWidget->fitWindowScaledSize(imageSize);
+}
+
+ScalingFilter MW::scalingFilter() {
+    return viewerWidget->scalingFilter();
+}
+
 void MW::showAnimation(std::shared_ptr<QMovie> movie) {
     if(settings->autoResizeWindow())
         preShowResize(movie->frameRect().size());
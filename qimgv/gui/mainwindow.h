@@ -67,7 +67,10 @@ public:
     explicit MW(QWidget *parent = nullptr);
     bool isCropPanelActive();
     void onScalingFinished(std::unique_ptr<QPixmap>scaled);
-    void showImage(std::unique_ptr<QPixmap> pixmap);
+    void showImage(std::unique_ptr<QPixmap> pixmap, std::shared_ptr<TileSource> tiles = nullptr);
+    QSize previewSize();
+    QSize prescaleSize(QSize imageSize);
+    ScalingFilter scalingFilter();
     void showAnimation(std::shared_ptr<QMovie> movie);
     void showVideo(QString file);
 
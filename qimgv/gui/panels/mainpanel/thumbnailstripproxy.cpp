@@ -98,6 +98,14 @@ void ThumbnailStripProxy::insertItem(int index) {
     }
 }
 
+void ThumbnailStripProxy::insertItems(int index, int count) {
+    if(thumbnailStrip) {
+        thumbnailStrip->insertItems(index, count);
+    } else {
+        stateBuf.itemCount += count;
+    }
+}
+
 void ThumbnailStripProxy::removeItem(int index) {
     if(thumbnailStrip) {
         thumbnailStrip->removeItem(index);
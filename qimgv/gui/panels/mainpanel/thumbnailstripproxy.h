@@ -27,6 +27,7 @@ public slots:
     virtual void focusOn(int) override;
     virtual void focusOnSelection() override;
     virtual void insertItem(int index) override;
+    virtual void insertItems(int index, int count) override;
     virtual void removeItem(int index) override;
     virtual void reloadItem(int index) override;
     virtual void setDragHover(int index) override;
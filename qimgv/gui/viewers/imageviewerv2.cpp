@@ -52,6 +52,10 @@ ImageViewerV2::ImageViewerV2(QWidget *parent) : QGraphicsView(parent),
     scaleTimer->setSingleShot(true);
     scaleTimer->setInterval(80);
 
+    tileTimer = new QTimer(this);
+    tileTimer->setSingleShot(true);
+    tileTimer->setInterval(10);
+
     checkboard = new QPixmap(":res/icons/common/other/checkerboard.png");
 
     lastTouchpadScroll.start();
@@ -88,6 +92,10 @@ ImageViewerV2::ImageViewerV2(QWidget *parent) : QGraphicsView(parent),
         this->requestScaling();
     });
 
+    QObject::connect(tileTimer, &QTimer::timeout, [this]() {
+        this->updateTiles();
+    });
+
     readSettings();
     connect(settings, &Settings::settingsChanged, this, &ImageViewerV2::readSettings);
 }
@@ -269,12 +277,19 @@ void ImageViewerV2::showAnimation(std::shared_ptr<QMovie> _movie) {
 }
 
 // display & initialize
-void ImageViewerV2::showImage(std::unique_ptr<QPixmap> _pixmap) {
+void ImageViewerV2::showImage(std::unique_ptr<QPixmap> _pixmap, std::shared_ptr<TileSource> _tiles) {
     reset();
     if(_pixmap) {
         pixmapItemScaled.hide();
         pixmap = std::move(_pixmap);
-        pixmap->setDevicePixelRatio(dpr);
+        tileSource = _tiles;
+        if(tileSource) {
+            // stretch the overview so that it takes as much space as the full image would
+            pixmap->setDevicePixelRatio(dpr * pixmap->width() / tileSource->size().width());
+            connect(tileSource.get(), &TileSource::tileReady, this, &ImageViewerV2::requestTiles);
+        } else {
+            pixmap->setDevicePixelRatio(dpr);
+        }
         pixmapItem.setPixmap(*pixmap);
         Qt::TransformationMode mode = Qt::SmoothTransformation;
         if(mScalingFilter == QI_FILTER_NEAREST)
@@ -295,6 +310,7 @@ void ImageViewerV2::showImage(std::unique_ptr<QPixmap> _pixmap) {
                 applySavedViewportPos();
         }
         requestScaling();
+        requestTiles();
         update();
     }
 }
@@ -302,6 +318,11 @@ void ImageViewerV2::showImage(std::unique_ptr<QPixmap> _pixmap) {
 // reset state, remove image & stop animation
 void ImageViewerV2::reset() {
     stopPosAnimation();
+    clearTiles();
+    if(tileSource) {
+        disconnect(tileSource.get(), &TileSource::tileReady, this, &ImageViewerV2::requestTiles);
+        tileSource.reset();
+    }
     pixmapItemScaled.setPixmap(QPixmap());
     pixmapScaled.reset(nullptr);
     pixmapItem.setPixmap(QPixmap());
@@ -426,6 +447,9 @@ void ImageViewerV2::hide() {
 void ImageViewerV2::requestScaling() {
     if(!pixmap || pixmapItem.scale() == 1.0f || (!smoothUpscaling && pixmapItem.scale() >= 1.0f) || movie)
         return;
+    // overview would be upscaled; tiles take care of it
+    if(tilesNeeded())
+        return;
     if(scaleTimer->isActive())
         scaleTimer->stop();
     // request "real" scaling when graphicsscene scaling is insufficient
@@ -437,8 +461,8 @@ void ImageViewerV2::requestScaling() {
 bool ImageViewerV2::imageFits() const {
     if(!pixmap)
         return true;
-    return (pixmap->width()  <= (viewport()->width()  * devicePixelRatioF()) &&
-            pixmap->height() <= (viewport()->height() * devicePixelRatioF()));
+    return (sourceSize().width()  <= (viewport()->width()  * devicePixelRatioF()) &&
+            sourceSize().height() <= (viewport()->height() * devicePixelRatioF()));
 }
 
 bool ImageViewerV2::scaledImageFits() const {
@@ -632,6 +656,11 @@ void ImageViewerV2::wheelEvent(QWheelEvent *event) {
     }
 }
 
+void ImageViewerV2::scrollContentsBy(int dx, int dy) {
+    QGraphicsView::scrollContentsBy(dx, dy);
+    requestTiles();
+}
+
 void ImageViewerV2::showEvent(QShowEvent *event) {
     QGraphicsView::showEvent(event);
     // ensure we are properly resized
@@ -681,8 +710,8 @@ void ImageViewerV2::mouseMoveZoom(QMouseEvent *event) {
 
 // scale at which current image fills the window
 void ImageViewerV2::updateFitWindowScale() {
-    float scaleFitX = (float) viewport()->width()  * devicePixelRatioF() / pixmap->width();
-    float scaleFitY = (float) viewport()->height() * devicePixelRatioF() / pixmap->height();
+    float scaleFitX = (float) viewport()->width()  * devicePixelRatioF() / sourceSize().width();
+    float scaleFitY = (float) viewport()->height() * devicePixelRatioF() / sourceSize().height();
     if(scaleFitX < scaleFitY) {
         fitWindowScale = scaleFitX;
     } else {
@@ -698,7 +727,7 @@ void ImageViewerV2::updateMinScale() {
     updateFitWindowScale();
     if(settings->unlockMinZoom()) {
         if(!pixmap->isNull())
-            minScale = qMax(10./pixmap->width(), 10./pixmap->height());
+            minScale = qMax(10./sourceSize().width(), 10./sourceSize().height());
         else
             minScale = 1.0f;
     } else {
@@ -714,7 +743,7 @@ void ImageViewerV2::updateMinScale() {
 void ImageViewerV2::fitWidth() {
     if(!pixmap)
         return;
-    float scaleX = (float)viewport()->width() * devicePixelRatioF() / pixmap->width();
+    float scaleX = (float)viewport()->width() * devicePixelRatioF() / sourceSize().width();
     if(!expandImage && scaleX > 1.0f)
         scaleX = 1.0f;
     if(scaleX > expandLimit)
@@ -845,6 +874,7 @@ void ImageViewerV2::resizeEvent(QResizeEvent *event) {
             scaleTimer->stop();
         scaleTimer->start();
         saveViewportPos();
+        requestTiles();
     }
 }
 
@@ -1163,6 +1193,8 @@ void ImageViewerV2::doZoom(float newScale) {
     pixmapItem.setScale(newScale);
 
     pixmapItem.setTransformationMode(selectTransformationMode());
+    placeTiles();
+    requestTiles();
     swapToOriginalPixmap();
     emit scaleChanged(newScale);
 }
@@ -1207,5 +1239,94 @@ float ImageViewerV2::currentScale() const {
 QSize ImageViewerV2::sourceSize() const {
     if(!pixmap)
         return QSize(0,0);
+    if(tileSource)
+        return tileSource->size();
     return pixmap->size();
 }
+
+// physical size at which the next image will be fit to window
+// empty if it is not going to be displayed that way
+QSize ImageViewerV2::previewSize() const {
+    ImageFitMode nextMode = imageFitModeDefault;
+    if(keepFitMode && imageFitMode != FIT_FREE)
+        nextMode = imageFitMode;
+    if(mViewLock != LOCK_NONE || nextMode != FIT_WINDOW)
+        return QSize();
+    return viewport()->size() * devicePixelRatioF();
+}
+
+// size of the scaled pixmap that will be requested when an image of imageSize
+// is opened next. empty if there won't be any request
+QSize ImageViewerV2::fitWindowScaledSize(QSize imageSize) const {
+    if(previewSize().isEmpty() || imageSize.isEmpty())
+        return QSize();
+    // same as updateFitWindowScale()
+    float scaleFitX = (float) viewport()->width()  * devicePixelRatioF() / imageSize.width();
+    float scaleFitY = (float) viewport()->height() * devicePixelRatioF() / imageSize.height();
+    float scale = qMin(scaleFitX, scaleFitY);
+    if(expandImage && scale > expandLimit)
+        scale = expandLimit;
+    // fits as is; nothing for the scaler to do
+    if(scale >= FAST_SCALE_THRESHOLD)
+        return QSize();
+    // same as scaledSizeR() * dpr
+    QSizeF logicalSize = QSizeF(imageSize) / static_cast<qreal>(dpr) * static_cast<qreal>(scale);
+    return logicalSize.toSize() * dpr;
+}
+
+// ---------------------------------------------------------------- tiles
+
+// the overview alone would look blurry at current zoom
+bool ImageViewerV2::tilesNeeded() const {
+    return tileSource && pixmap && currentScale() * tileSource->size().width() > pixmap->width();
+}
+
+void ImageViewerV2::requestTiles() {
+    if(tileSource && !tileTimer->isActive())
+        tileTimer->start();
+}
+
+// syncs tile items with what is visible right now
+void ImageViewerV2::updateTiles() {
+    if(!tileSource || !pixmap)
+        return;
+    if(!tilesNeeded()) {
+        clearTiles();
+        return;
+    }
+    // visible area in source image pixels
+    QRectF itemRect = pixmapItem.mapFromScene(mapToScene(viewport()->rect()).boundingRect()).boundingRect();
+    QRectF sourceRect((itemRect.topLeft() - pixmapItem.offset()) * dpr, itemRect.size() * dpr);
+    auto tiles = tileSource->tiles(sourceRect.toAlignedRect(), currentScale());
+    QSet<quint64> visibleKeys;
+    for(auto &tile : tiles) {
+        visibleKeys.insert(tile.key);
+        if(tileItems.contains(tile.key))
+            continue;
+        QPixmap tilePixmap = tile.pixmap;
+        tilePixmap.setDevicePixelRatio(dpr * tilePixmap.width() / tile.rect.width());
+        auto item = new QGraphicsPixmapItem(tilePixmap, &pixmapItem);
+        item->setData(0, tile.rect);
+        tileItems.insert(tile.key, item);
+    }
+    for(auto key : tileItems.keys()) {
+        if(!visibleKeys.contains(key))
+            delete tileItems.take(key);
+    }
+    placeTiles();
+}
+
+// tiles are children of pixmapItem, so they only need to follow its offset
+void ImageViewerV2::placeTiles() {
+    auto mode = selectTransformationMode();
+    for(auto item : tileItems) {
+        QRect rect = item->data(0).toRect();
+        item->setOffset(pixmapItem.offset() + QPointF(rect.topLeft()) / dpr);
+        item->setTransformationMode(mode);
+    }
+}
+
+void ImageViewerV2::clearTiles() {
+    qDeleteAll(tileItems);
+    tileItems.clear();
+}
@@ -14,6 +14,7 @@
 #include <memory>
 #include <cmath>
 #include "settings.h"
+#include "components/tiles/tilesource.h"
 
 enum MouseInteractionState {
     MOUSE_NONE,
@@ -40,7 +41,9 @@ public:
     virtual QRect scaledRectR() const;
     virtual float currentScale() const;
     virtual QSize sourceSize() const;
-    virtual void showImage(std::unique_ptr<QPixmap> _pixmap);
+    QSize previewSize() const;
+    QSize fitWindowScaledSize(QSize imageSize) const;
+    virtual void showImage(std::unique_ptr<QPixmap> _pixmap, std::shared_ptr<TileSource> _tiles = nullptr);
     virtual void showAnimation(std::shared_ptr<QMovie> _animation);
     virtual void setScaledPixmap(std::unique_ptr<QPixmap> newFrame);
     virtual bool isDisplaying() const;
@@ -109,12 +112,14 @@ protected:
     void wheelEvent(QWheelEvent *event);
     void showEvent(QShowEvent *event);
     void drawBackground(QPainter *painter, const QRectF &rect);
+    void scrollContentsBy(int dx, int dy);
 
 protected slots:
     void onAnimationTimer();
 
 private slots:
     void requestScaling();
+    void requestTiles();
     void scrollToX(int x);
     void scrollToY(int y);
     void centerOnPixmap();
@@ -126,7 +131,10 @@ private:
     std::unique_ptr<QPixmap> pixmapScaled;
     std::shared_ptr<QMovie> movie;
     QGraphicsPixmapItem pixmapItem, pixmapItemScaled;
-    QTimer *animationTimer, *scaleTimer;
+    // for huge images; pixmap is then a reduced overview with tiles on top of it
+    std::shared_ptr<TileSource> tileSource;
+    QHash<quint64, QGraphicsPixmapItem*> tileItems;
+    QTimer *animationTimer, *scaleTimer, *tileTimer;
     QScrollBar *hs, *vs;
     QPoint mouseMoveStartPos, mousePressPos, drawPos;
     bool transparencyGrid, expandImage,    smoothAnimatedImages,
@@ -194,4 +202,8 @@ private:
     void lockZoom();
     void doZoomIn(bool atCursor);
     void doZoomOut(bool atCursor);
+    bool tilesNeeded() const;
+    void updateTiles();
+    void placeTiles();
+    void clearTiles();
 };
@@ -85,6 +85,14 @@ QSize ViewerWidget::sourceSize() {
         return QSize(0,0);
 }
 
+QSize ViewerWidget::previewSize() {
+    return imageViewer->previewSize();
+}
+
+QSize ViewerWidget::fitWindowScaledSize(QSize imageSize) {
+    return imageViewer->fitWindowScaledSize(imageSize);
+}
+
 // hide videoPlayer, show imageViewer
 void ViewerWidget::enableImageViewer() {
     if(currentWidget != IMAGEVIEWER) {
@@ -209,13 +217,13 @@ bool ViewerWidget::interactionEnabled() {
     return mInteractionEnabled;
 }
 
-bool ViewerWidget::showImage(std::unique_ptr<QPixmap> pixmap) {
+bool ViewerWidget::showImage(std::unique_ptr<QPixmap> pixmap, std::shared_ptr<TileSource> tiles) {
     if(!pixmap)
         return false;
     stopPlayback();
     videoControls->hide();
     enableImageViewer();
-    imageViewer->showImage(std::move(pixmap));
+    imageViewer->showImage(std::move(pixmap), tiles);
     hideCursorTimed(false);
     return true;
 }
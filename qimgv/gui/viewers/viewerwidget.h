@@ -22,11 +22,13 @@ public:
     QRect imageRect();
     float currentScale();
     QSize sourceSize();
+    QSize previewSize();
+    QSize fitWindowScaledSize(QSize imageSize);
 
     void setInteractionEnabled(bool mode);
     bool interactionEnabled();
 
-    bool showImage(std::unique_ptr<QPixmap> pixmap);
+    bool showImage(std::unique_ptr<QPixmap> pixmap, std::shared_ptr<TileSource> tiles = nullptr);
     bool showAnimation(std::shared_ptr<QMovie> movie);
     void onScalingFinished(std::unique_ptr<QPixmap> scaled);
     bool isDisplaying();
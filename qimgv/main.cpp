@@ -107,7 +107,10 @@ int main(int argc, char *argv[]) {
     qRegisterMetaType<ScalerRequest>("ScalerRequest");
     qRegisterMetaType<Script>("Script");
     qRegisterMetaType<std::shared_ptr<Image>>("std::shared_ptr<Image>");
+    qRegisterMetaType<std::shared_ptr<const QImage>>("std::shared_ptr<const QImage>");
     qRegisterMetaType<std::shared_ptr<Thumbnail>>("std::shared_ptr<Thumbnail>");
+    qRegisterMetaType<ThumbnailCacheStats>("ThumbnailCacheStats");
+    qRegisterMetaType<std::vector<FSEntry>>("std::vector<FSEntry>");
 #if QT_VERSION < QT_VERSION_CHECK(6, 0, 0)
     qRegisterMetaTypeStreamOperators<Script>("Script");
 #endif
@@ -136,10 +139,22 @@ int main(int argc, char *argv[]) {
             QCoreApplication::translate("main", "Generate all thumbnails for directory."),
             QCoreApplication::translate("main", "directory-path")},
         {"gen-thumbs-size",
-            QCoreApplication::translate("main", "Thumbnail size. Current size is used if not specified."),
+            QCoreApplication::translate("main", "Thumbnail size, or several separated by commas. Current size is used if not specified."),
             QCoreApplication::translate("main", "thumbnail-size")},
+        {"gen-thumbs-crop",
+            QCoreApplication::translate("main", "Generate square (cropped) thumbnails.")},
+        {"gen-thumbs-threads",
+            QCoreApplication::translate("main", "Number of threads for --gen-thumbs. Defaults to the number of cores."),
+            QCoreApplication::translate("main", "count")},
         {"build-options",
             QCoreApplication::translate("main", "Show build options.")},
+        {"benchmark-scaling",
+            QCoreApplication::translate("main", "Compare image scaling implementations on a given image."),
+            QCoreApplication::translate("main", "image-path")},
+        {"thumbnail-cache-stats",
+            QCoreApplication::translate("main", "Show thumbnail cache statistics.")},
+        {"clean-thumbnail-cache",
+            QCoreApplication::translate("main", "Remove outdated thumbnails and apply the cache size limit.")},
     });
     parser.process(a);
 
@@ -147,14 +162,37 @@ int main(int argc, char *argv[]) {
         CmdOptionsRunner r;
         QTimer::singleShot(0, &r, &CmdOptionsRunner::showBuildOptions);
         return a.exec();
+    } else if(parser.isSet("benchmark-scaling")) {
+        CmdOptionsRunner r;
+        QTimer::singleShot(0, &r,
+                           std::bind(&CmdOptionsRunner::benchmarkScaling, &r, parser.value("benchmark-scaling")));
+        return a.exec();
+    } else if(parser.isSet("thumbnail-cache-stats") || parser.isSet("clean-thumbnail-cache")) {
+        CmdOptionsRunner r;
+        QTimer::singleShot(0, &r,
+                           std::bind(&CmdOptionsRunner::thumbnailCacheStats, &r, parser.isSet("clean-thumbnail-cache")));
+        return a.exec();
     } else if(parser.isSet("gen-thumbs")) {
-        int size = settings->folderViewIconSize();
-        if(parser.isSet("gen-thumbs-size"))
-            size = parser.value("gen-thumbs-size").toInt();
+        QList<int> sizes;
+        if(parser.isSet("gen-thumbs-size")) {
+#if QT_VERSION < QT_VERSION_CHECK(5, 14, 0)
+            QStringList list = parser.value("gen-thumbs-size").split(",", QString::SkipEmptyParts);
+#else
+            QStringList list = parser.value("gen-thumbs-size").split(",", Qt::SkipEmptyParts);
+#endif
+            for(auto size : list)
+                sizes.append(size.trimmed().toInt());
+        } else {
+            sizes.append(settings->folderViewIconSize());
+        }
+        int threads = QThread::idealThreadCount();
+        if(parser.isSet("gen-thumbs-threads"))
+            threads = parser.value("gen-thumbs-threads").toInt();
 
         CmdOptionsRunner r;
         QTimer::singleShot(0, &r,
-                           std::bind(&CmdOptionsRunner::generateThumbs, &r, parser.value("gen-thumbs"), size));
+                           std::bind(&CmdOptionsRunner::generateThumbs, &r, parser.value("gen-thumbs"),
+                                     sizes, parser.isSet("gen-thumbs-crop"), threads));
         return a.exec();
     }
 
@@ -738,6 +738,41 @@ void Settings::setUseThumbnailCache(bool mode) {
     settings->settingsConf->setValue("thumbnailCache", mode);
 }
 //------------------------------------------------------------------------------
+ThumbnailKeyMode Settings::thumbnailKeyMode() {
+    int mode = settings->settingsConf->value("thumbnailKeyMode", 0).toInt();
+    if(mode < 0 || mode > 2)
+        mode = 0;
+    return static_cast<ThumbnailKeyMode>(mode);
+}
+
+void Settings::setThumbnailKeyMode(ThumbnailKeyMode mode) {
+    settings->settingsConf->setValue("thumbnailKeyMode", mode);
+}
+//------------------------------------------------------------------------------
+// MB, 0 = unlimited
+int Settings::thumbnailCacheLimit() {
+    int limit = settings->settingsConf->value("thumbnailCacheLimit", 1000).toInt();
+    if(limit < 0)
+        limit = 1000;
+    return limit;
+}
+
+void Settings::setThumbnailCacheLimit(int limit) {
+    settings->settingsConf->setValue("thumbnailCacheLimit", limit);
+}
+//------------------------------------------------------------------------------
+// days, 0 = unlimited
+int Settings::thumbnailCacheMaxAge() {
+    int days = settings->settingsConf->value("thumbnailCacheMaxAge", 90).toInt();
+    if(days < 0)
+        days = 90;
+    return days;
+}
+
+void Settings::setThumbnailCacheMaxAge(int days) {
+    settings->settingsConf->setValue("thumbnailCacheMaxAge", days);
+}
+//------------------------------------------------------------------------------
 QStringList Settings::savedPaths() {
     return settings->stateConf->value("savedPaths", QDir::homePath()).toStringList();
 }
@@ -857,10 +892,10 @@ ScalingFilter Settings::scalingFilter() {
 #endif
     int mode = settings->settingsConf->value("scalingFilter", defaultFilter).toInt();
 #ifndef USE_OPENCV
-    if(mode > 2)
+    if(mode >= QI_FILTER_CV_BILINEAR_SHARPEN && mode <= QI_FILTER_CV_CUBIC_SHARPEN)
         mode = 1;
 #endif
-    if(mode < 0 || mode > 4)
+    if(mode < 0 || mode > QI_FILTER_LANCZOS)
         mode = 1;
     return static_cast<ScalingFilter>(mode);
 }
@@ -942,14 +977,6 @@ void Settings::setConfirmTrash(bool mode) {
     settings->settingsConf->setValue("confirmTrash", mode);
 }
 //------------------------------------------------------------------------------
-bool Settings::unloadThumbs() {
-    return settings->settingsConf->value("unloadThumbs", true).toBool();
-}
-
-void Settings::setUnloadThumbs(bool mode) {
-    settings->settingsConf->setValue("unloadThumbs", mode);
-}
-//------------------------------------------------------------------------------
 float Settings::zoomStep() {
     bool ok = false;
     float value = settings->settingsConf->value("zoomStep", 0.2f).toFloat(&ok);
@@ -1160,4 +1187,31 @@ bool Settings::splitView() {
 
 void Settings::setSplitView(bool mode) {
     settings->settingsConf->setValue("splitView", mode);
-}
\ No newline at end of file
+}
+//------------------------------------------------------------------------------
+int Settings::imageCacheSize() {
+    int size = settings->settingsConf->value("imageCacheSize", 1024).toInt();
+    return std::clamp(size, 0, 65536);
+}
+
+void Settings::setImageCacheSize(int sizeMB) {
+    settings->settingsConf->setValue("imageCacheSize", sizeMB);
+}
+//------------------------------------------------------------------------------
+int Settings::preloadAhead() {
+    int count = settings->settingsConf->value("preloadAhead", 3).toInt();
+    return std::clamp(count, 1, 10);
+}
+
+void Settings::setPreloadAhead(int count) {
+    settings->settingsConf->setValue("preloadAhead", count);
+}
+
+int Settings::preloadBehind() {
+    int count = settings->settingsConf->value("preloadBehind", 1).toInt();
+    return std::clamp(count, 0, 10);
+}
+
+void Settings::setPreloadBehind(int count) {
+    settings->settingsConf->setValue("preloadBehind", count);
+}
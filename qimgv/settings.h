@@ -47,7 +47,8 @@ enum ScalingFilter {
     QI_FILTER_BILINEAR,
     QI_FILTER_CV_BILINEAR_SHARPEN,
     QI_FILTER_CV_CUBIC,
-    QI_FILTER_CV_CUBIC_SHARPEN
+    QI_FILTER_CV_CUBIC_SHARPEN,
+    QI_FILTER_LANCZOS
 };
 
 enum ZoomIndicatorMode {
@@ -73,6 +74,13 @@ enum ImageScrolling {
     SCROLL_BY_TRACKPAD_AND_WHEEL
 };
 
+// how cached thumbnails are matched to files
+enum ThumbnailKeyMode {
+    THUMB_KEY_PATH,
+    THUMB_KEY_FILE_ID, // device + inode + mtime + size; survives renames and moves
+    THUMB_KEY_CONTENT  // size + first and last few KB; survives copies
+};
+
 enum ViewMode {
     MODE_DOCUMENT,
     MODE_FOLDERVIEW,
@@ -142,6 +150,12 @@ public:
     void setEnableSmoothScroll(bool mode);
     bool useThumbnailCache();
     void setUseThumbnailCache(bool mode);
+    ThumbnailKeyMode thumbnailKeyMode();
+    void setThumbnailKeyMode(ThumbnailKeyMode mode);
+    int thumbnailCacheLimit();
+    void setThumbnailCacheLimit(int limit);
+    int thumbnailCacheMaxAge();
+    void setThumbnailCacheMaxAge(int days);
     QStringList savedPaths();
     void setSavedPaths(QStringList paths);
     QString tmpDir();
@@ -265,8 +279,6 @@ public:
     void setPrintFitToPage(bool mode);
     QString lastPrinter();
     void setLastPrinter(QString name);
-    bool unloadThumbs();
-    void setUnloadThumbs(bool mode);
     ThumbPanelStyle thumbPanelStyle();
     void setThumbPanelStyle(ThumbPanelStyle mode);
 
@@ -299,6 +311,14 @@ public:
     bool splitView();
     void setSplitView(bool mode);
 
+    int imageCacheSize();
+    void setImageCacheSize(int sizeMB);
+
+    int preloadAhead();
+    void setPreloadAhead(int count);
+    int preloadBehind();
+    void setPreloadBehind(int count);
+
 private:
     explicit Settings(QObject *parent = nullptr);
     QSettings *settingsConf, *stateConf, *themeConf;
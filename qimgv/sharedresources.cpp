@@ -44,6 +44,27 @@ QPixmap *SharedResources::getPixmap(ShrIcon icon, qreal dpr) {
     return pixmap;
 }
 
+QImage SharedResources::folderIcon(int size, QColor color) {
+    QString key = QString::number(size) + color.name(QColor::HexArgb);
+    QMutexLocker locker(&folderIconMutex);
+    auto it = folderIcons.constFind(key);
+    if(it != folderIcons.constEnd())
+        return it.value();
+    QSvgRenderer svgRenderer;
+    svgRenderer.load(QString(":/res/icons/common/other/folder32-scalable.svg"));
+    int factor = qMax(1, static_cast<int>((size * 0.90f) / svgRenderer.defaultSize().width()));
+    QImage icon(svgRenderer.defaultSize() * factor, QImage::Format_ARGB32_Premultiplied);
+    icon.fill(Qt::transparent);
+    QPainter p(&icon);
+    svgRenderer.render(&p);
+    // same as ImageLib::recolor()
+    p.setCompositionMode(QPainter::CompositionMode_SourceIn);
+    p.fillRect(icon.rect(), color);
+    p.end();
+    folderIcons.insert(key, icon);
+    return icon;
+}
+
 SharedResources *SharedResources::getInstance() {
     if(!shrRes) {
         shrRes = new SharedResources();
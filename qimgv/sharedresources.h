@@ -1,7 +1,12 @@
 #pragma once
 
 #include <QPixmap>
+#include <QImage>
+#include <QHash>
+#include <QMutex>
+#include <QPainter>
 #include <QDebug>
+#include <QtSvg/QSvgRenderer>
 
 enum ShrIcon {
     SHR_ICON_ERROR,
@@ -16,9 +21,14 @@ public:
     ~SharedResources();
 
     QPixmap *getPixmap(ShrIcon icon, qreal dpr);
+    // Folder icon in the given color, scaled by a whole factor to fit 90% of size.
+    // Rendered once per size / color. Thread safe.
+    QImage folderIcon(int size, QColor color);
 private:
     QPixmap *mLoadingIcon72 = nullptr;
     QPixmap *mLoadingErrorIcon72 = nullptr;
+    QMutex folderIconMutex;
+    QHash<QString, QImage> folderIcons;
 };
 
 extern SharedResources *shrRes;
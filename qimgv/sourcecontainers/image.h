@@ -20,6 +20,8 @@ public:
     virtual int height() = 0;
     virtual int width() = 0;
     virtual QSize size() = 0;
+    // approximate amount of memory used by decoded data, in bytes
+    virtual qint64 memorySize() = 0;
     bool isLoaded() const;
     virtual bool save() = 0;
     virtual bool save(QString destPath) = 0;
@@ -94,3 +94,8 @@ int ImageAnimated::width() {
 QSize ImageAnimated::size() {
     return mSize;
 }
+
+// QMovie decodes on the fly, so count just the current frame
+qint64 ImageAnimated::memorySize() {
+    return static_cast<qint64>(mSize.width()) * mSize.height() * 4;
+}
@@ -16,6 +16,7 @@ public:
     int height();
     int width();
     QSize size();
+    qint64 memorySize();
 
     bool isEditable();
     bool isEdited();
@@ -2,13 +2,24 @@
 #include <time.h>
 
 ImageStatic::ImageStatic(QString _path)
-    : Image(_path)
+    : Image(_path),
+      mTiled(false)
 {
     load();
 }
 
 ImageStatic::ImageStatic(std::unique_ptr<DocumentInfo> _info)
-    : Image(std::move(_info))
+    : Image(std::move(_info)),
+      mTiled(false)
+{
+    load();
+}
+
+// loading can be aborted from another thread by setting the flag
+ImageStatic::ImageStatic(std::unique_ptr<DocumentInfo> _info, std::shared_ptr<std::atomic_bool> _cancelFlag)
+    : Image(std::move(_info)),
+      cancelFlag(_cancelFlag),
+      mTiled(false)
 {
     load();
 }
@@ -37,13 +48,30 @@ void ImageStatic::loadGeneric() {
      *
      * tldr: qimage bad
      */
-    QImageReader r(mPath, mDocInfo->format().toStdString().c_str());
+    QImageReader r;
+    CancellableFile file(mPath, cancelFlag);
+    if(cancelFlag) {
+        // read through a device which we can cut off while decoder is running
+        file.open(QIODevice::ReadOnly);
+        r.setDevice(&file);
+    } else {
+        r.setFileName(mPath);
+    }
+    r.setFormat(mDocInfo->format().toStdString().c_str());
 #if QT_VERSION >= QT_VERSION_CHECK(6, 0, 0)
     r.setAllocationLimit(settings->memoryAllocationLimit());
 #endif
+    // too big to decode whole; read a reduced overview, details are decoded on demand
+    if(canUseTiles(r)) {
+        mTiled = true;
+        mFullSize = r.size();
+        r.setScaledSize(mFullSize.scaled(OVERVIEW_SIZE, OVERVIEW_SIZE, Qt::KeepAspectRatio));
+    }
     QImage *tmp = new QImage();
     r.read(tmp);
     std::unique_ptr<const QImage> img(tmp);
+    if(cancelFlag && cancelFlag->load())
+        return;
     img = ImageLib::exifRotated(std::move(img), mDocInfo.get()->exifOrientation());
     // scaling this format via qt results in transparent background
     // it rare enough so lets just convert it to the closest working thing
@@ -58,6 +86,19 @@ void ImageStatic::loadGeneric() {
     mLoaded = true;
 }
 
+bool ImageStatic::canUseTiles(QImageReader &r) {
+    QSize fullSize = r.size();
+    if(!fullSize.isValid())
+        return false;
+    qint64 bytes = static_cast<qint64>(fullSize.width()) * fullSize.height() * 4;
+    qint64 limit = static_cast<qint64>(settings->memoryAllocationLimit()) * 1024 * 1024;
+    // clip rects are in file coordinates; exif-rotated ones are not handled
+    return bytes > limit &&
+           mDocInfo->exifOrientation() == 0 &&
+           r.supportsOption(QImageIOHandler::ClipRect) &&
+           r.supportsOption(QImageIOHandler::ScaledSize);
+}
+
 // TODO: move this out somewhere to use in other places
 void ImageStatic::loadICO() {
     // Big brain code. It's mostly for small ico files so whatever. I'm not patching Qt for this.
@@ -79,6 +120,10 @@ QString ImageStatic::generateHash(QString str) {
 
 // TODO: move saving to directorymodel
 bool ImageStatic::save(QString destPath) {
+    if(mTiled) {
+        qDebug() << "ImageStatic::save() - Image is not fully loaded.";
+        return false;
+    }
     QString tmpPath = destPath + "_" + generateHash(destPath);
     QFileInfo fi(destPath);
     QString ext = fi.suffix();
@@ -149,31 +194,100 @@ std::shared_ptr<const QImage> ImageStatic::getImage() {
 }
 
 int ImageStatic::height() {
-    return isEdited()?imageEdited->height():image->height();
+    return size().height();
 }
 
 int ImageStatic::width() {
-    return isEdited()?imageEdited->width():image->width();
+    return size().width();
 }
 
 QSize ImageStatic::size() {
+    if(mTiled)
+        return mFullSize;
     return isEdited()?imageEdited->size():image->size();
 }
 
+// mipmaps are included, so they are accounted for by the cache
+qint64 ImageStatic::memorySize() {
+    qint64 bytes = 0;
+    if(image)
+        bytes += image->sizeInBytes();
+    if(imageEdited)
+        bytes += imageEdited->sizeInBytes();
+    return bytes + mipmapBytes;
+}
+
+// Levels are built without holding the mutex, so that clearMipmaps() on the
+// gui thread never waits for a scaler thread. A level is only published if
+// the image did not change meanwhile.
+std::shared_ptr<const QImage> ImageStatic::getMipmap(QSize minSize) {
+    mipmapMutex.lock();
+    quint64 generation = mipmapGeneration;
+    auto levels = mipmaps;
+    mipmapMutex.unlock();
+    auto level = getImage();
+    if(!level)
+        return level;
+    minSize = minSize.expandedTo(QSize(MIN_MIPMAP_SIZE, MIN_MIPMAP_SIZE));
+    int i = 0;
+    while(level->width() / 2 >= minSize.width() && level->height() / 2 >= minSize.height()) {
+        if(i == levels.count()) {
+            // each level is made from the previous one, which keeps it cheap
+            std::shared_ptr<const QImage> next(new QImage(level->scaled(level->width() / 2, level->height() / 2,
+                                                                        Qt::IgnoreAspectRatio, Qt::SmoothTransformation)));
+            levels.append(next);
+            QMutexLocker locker(&mipmapMutex);
+            // another thread may have been faster
+            if(generation == mipmapGeneration && mipmaps.count() == i) {
+                mipmaps.append(next);
+                mipmapBytes += next->sizeInBytes();
+            }
+        }
+        level = levels.at(i++);
+    }
+    return level;
+}
+
+void ImageStatic::clearMipmaps() {
+    QMutexLocker locker(&mipmapMutex);
+    mipmapGeneration++;
+    mipmaps.clear();
+    mipmapBytes = 0;
+}
+
 bool ImageStatic::setEditedImage(std::unique_ptr<const QImage> imageEditedNew) {
     if(imageEditedNew && imageEditedNew->width() != 0) {
         discardEditedImage();
         imageEdited = std::move(imageEditedNew);
         mEdited = true;
+        clearMipmaps();
         return true;
     }
     return false;
 }
 
+bool ImageStatic::isTiled() const {
+    return mTiled;
+}
+
+// Created on first use & shared while someone (viewer) holds it.
+// Call from the main thread only.
+std::shared_ptr<TileSource> ImageStatic::tileSource() {
+    if(!mTiled)
+        return nullptr;
+    auto source = mTileSource.lock();
+    if(!source) {
+        source.reset(new TileSource(mPath, mDocInfo->format().toLatin1(), mFullSize));
+        mTileSource = source;
+    }
+    return source;
+}
+
 bool ImageStatic::discardEditedImage() {
     if(imageEdited) {
         imageEdited.reset();
         mEdited = false;
+        clearMipmaps();
         return true;
     }
     return false;
@@ -3,9 +3,13 @@
 #include <QImage>
 #include <QImageWriter>
 #include <QSemaphore>
+#include <QMutex>
 #include <QCryptographicHash>
+#include <atomic>
 #include "image.h"
 #include "utils/imagelib.h"
+#include "utils/cancellablefile.h"
+#include "components/tiles/tilesource.h"
 #include <settings.h>
 #include <QIcon>
 
@@ -13,6 +17,7 @@ class ImageStatic : public Image {
 public:
     ImageStatic(QString _path);
     ImageStatic(std::unique_ptr<DocumentInfo> _info);
+    ImageStatic(std::unique_ptr<DocumentInfo> _info, std::shared_ptr<std::atomic_bool> _cancelFlag);
     ~ImageStatic();
 
     std::unique_ptr<QPixmap> getPixmap();
@@ -22,10 +27,20 @@ public:
     int height();
     int width();
     QSize size();
+    qint64 memorySize();
 
     bool setEditedImage(std::unique_ptr<const QImage> imageEditedNew);
     bool discardEditedImage();
 
+    // Image is too large to be held in memory. getImage() returns a reduced overview,
+    // while size() is the real one. Full resolution parts come from tileSource()
+    bool isTiled() const;
+    std::shared_ptr<TileSource> tileSource();
+
+    // Smallest of 1/2, 1/4, 1/8.. copies which is still at least minSize.
+    // Levels are built on first use, so downscaling won't have to start from full size.
+    std::shared_ptr<const QImage> getMipmap(QSize minSize);
+
 public slots:
     void crop(QRect newRect);
     bool save();
@@ -34,7 +49,21 @@ public slots:
 private:
     void load();
     std::shared_ptr<const QImage> image, imageEdited;
+    std::shared_ptr<std::atomic_bool> cancelFlag;
+    bool mTiled;
+    QSize mFullSize;
+    std::weak_ptr<TileSource> mTileSource;
+    QList<std::shared_ptr<const QImage>> mipmaps;
+    // only guards the list; levels are built outside of it
+    QMutex mipmapMutex;
+    // bumped by clearMipmaps(); levels made from an older image are dropped
+    quint64 mipmapGeneration = 0;
+    std::atomic<qint64> mipmapBytes{0};
+    void clearMipmaps();
+    bool canUseTiles(QImageReader &r);
     void loadGeneric();
     void loadICO();
     QString generateHash(QString str);
+    const int OVERVIEW_SIZE = 4096;
+    const int MIN_MIPMAP_SIZE = 64;
 };
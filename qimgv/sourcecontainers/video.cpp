@@ -79,3 +79,8 @@ int Video::width() {
 QSize Video::size() {
     return QSize(srcWidth, srcHeight);
 }
+
+// frames are owned by the player
+qint64 Video::memorySize() {
+    return 0;
+}
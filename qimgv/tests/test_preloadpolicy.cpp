@@ -0,0 +1,65 @@
+#include "test_preloadpolicy.h"
+
+#include <QtTest>
+#include "../utils/preloadpolicy.h"
+
+QTEST_GUILESS_MAIN(Test_PreloadPolicy)
+
+typedef QList<int> IndexList;
+
+void Test_PreloadPolicy::defaults() {
+    PreloadPolicy policy;
+    QCOMPARE(policy.direction(), 1);
+    QCOMPARE(policy.indexes(5, 10), IndexList({ 6, 4 }));
+}
+
+void Test_PreloadPolicy::depthIsClamped() {
+    PreloadPolicy policy;
+    policy.setDepth(0, -1);
+    QCOMPARE(policy.indexes(5, 10), IndexList({ 6 }));
+}
+
+void Test_PreloadPolicy::fullDepthFromFirstStep() {
+    PreloadPolicy policy;
+    policy.setDepth(3, 1);
+    QCOMPARE(policy.indexes(5, 20), IndexList({ 6, 4, 7, 8 }));
+    QVERIFY(!policy.step(5, 6));
+    QCOMPARE(policy.indexes(6, 20), IndexList({ 7, 5, 8, 9 }));
+}
+
+void Test_PreloadPolicy::reversalFlipsDirection() {
+    PreloadPolicy policy;
+    policy.setDepth(3, 1);
+    policy.step(5, 6);
+    QVERIFY(policy.step(7, 6));
+    QCOMPARE(policy.direction(), -1);
+    QCOMPARE(policy.indexes(6, 20), IndexList({ 5, 7, 4, 3 }));
+    QVERIFY(!policy.step(6, 5));
+    QCOMPARE(policy.direction(), -1);
+    QVERIFY(policy.step(5, 6));
+    QCOMPARE(policy.direction(), 1);
+}
+
+void Test_PreloadPolicy::jumpKeepsDirection() {
+    PreloadPolicy policy;
+    policy.setDepth(3, 1);
+    policy.step(7, 6);
+    QVERIFY(!policy.step(6, 15));
+    QVERIFY(!policy.step(-1, 0));
+    QVERIFY(!policy.step(1, 1));
+    QCOMPARE(policy.direction(), -1);
+    QCOMPARE(policy.indexes(15, 20), IndexList({ 14, 16, 13, 12 }));
+
+    policy.reset();
+    QCOMPARE(policy.direction(), 1);
+}
+
+void Test_PreloadPolicy::clippedToRange() {
+    PreloadPolicy policy;
+    policy.setDepth(2, 2);
+    QCOMPARE(policy.indexes(0, 3), IndexList({ 1, 2 }));
+    QCOMPARE(policy.indexes(2, 3), IndexList({ 1, 0 }));
+    QCOMPARE(policy.indexes(0, 1), IndexList());
+    policy.step(1, 0);
+    QCOMPARE(policy.indexes(1, 2), IndexList({ 0 }));
+}
@@ -0,0 +1,15 @@
+#pragma once
+
+#include <QObject>
+
+class Test_PreloadPolicy : public QObject
+{
+    Q_OBJECT
+private slots:
+    void defaults();
+    void depthIsClamped();
+    void fullDepthFromFirstStep();
+    void reversalFlipsDirection();
+    void jumpKeepsDirection();
+    void clippedToRange();
+};
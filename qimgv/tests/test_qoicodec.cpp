@@ -0,0 +1,122 @@
+#include "test_qoicodec.h"
+
+#include <QtTest>
+#include <QRandomGenerator>
+#include "../components/cache/qoicodec.h"
+
+QTEST_GUILESS_MAIN(Test_QoiCodec)
+
+namespace {
+QImage decoded(const QByteArray &data, const QImage &like) {
+    QImage image(like.size(), like.format());
+    if(!QoiCodec::decode(data, image))
+        return QImage();
+    return image;
+}
+}
+
+void Test_QoiCodec::roundTrip_data() {
+    QTest::addColumn<QImage>("image");
+
+    QImage solid(70, 5, QImage::Format_RGB32);
+    solid.fill(qRgb(12, 34, 56));
+    QTest::newRow("solid") << solid;
+
+    QImage gradient(64, 64, QImage::Format_ARGB32);
+    for(int y = 0; y < gradient.height(); y++)
+        for(int x = 0; x < gradient.width(); x++)
+            gradient.setPixel(x, y, qRgba(x * 4, y * 4, (x + y) * 2, 255));
+    QTest::newRow("gradient") << gradient;
+
+    QImage noise(33, 17, QImage::Format_ARGB32);
+    QRandomGenerator gen(42);
+    for(int y = 0; y < noise.height(); y++)
+        for(int x = 0; x < noise.width(); x++)
+            noise.setPixel(x, y, gen.generate());
+    QTest::newRow("noise with alpha") << noise;
+
+    QImage premultiplied(64, 64, QImage::Format_ARGB32_Premultiplied);
+    premultiplied.fill(qRgba(0, 0, 0, 0));
+    for(int x = 0; x < premultiplied.width(); x += 3)
+        premultiplied.setPixel(x, x, qRgba(x, x, x, x * 4));
+    QTest::newRow("premultiplied, mostly transparent") << premultiplied;
+
+    QImage single(1, 1, QImage::Format_RGB32);
+    single.fill(qRgb(0, 0, 0));
+    QTest::newRow("1x1, same as the initial pixel") << single;
+}
+
+void Test_QoiCodec::roundTrip() {
+    QFETCH(QImage, image);
+    QByteArray data = QoiCodec::encode(image);
+    QVERIFY(!data.isEmpty());
+    QCOMPARE(decoded(data, image), image);
+}
+
+// runs are capped at 62 pixels per chunk
+void Test_QoiCodec::longRun() {
+    QImage image(100, 1, QImage::Format_RGB32);
+    image.fill(qRgb(0, 0, 0)); // same as the initial "previous" pixel
+    QByteArray data = QoiCodec::encode(image);
+    QCOMPARE(data.size(), 2);
+    QCOMPARE(static_cast<uchar>(data.at(0)), static_cast<uchar>(0xc0 | 61));
+    QCOMPARE(static_cast<uchar>(data.at(1)), static_cast<uchar>(0xc0 | 37));
+    QCOMPARE(decoded(data, image), image);
+}
+
+void Test_QoiCodec::indexHits() {
+    // far apart, different hash slots
+    const QRgb a = qRgb(10, 200, 30);
+    const QRgb b = qRgb(200, 10, 100);
+    QImage image(8, 1, QImage::Format_RGB32);
+    for(int x = 0; x < image.width(); x++)
+        image.setPixel(x, 0, (x % 2) ? b : a);
+    QByteArray data = QoiCodec::encode(image);
+    // two full pixels, then one byte each
+    QCOMPARE(data.size(), 4 + 4 + 6);
+    QCOMPARE(decoded(data, image), image);
+}
+
+// 0 -> 255 is a difference of -1, 255 -> 0 is +1
+void Test_QoiCodec::diffWrapsAround() {
+    QImage image(2, 1, QImage::Format_RGB32);
+    image.setPixel(0, 0, qRgb(255, 255, 255));
+    image.setPixel(1, 0, qRgb(0, 254, 0));
+    QByteArray data = QoiCodec::encode(image);
+    QCOMPARE(data.size(), 2);
+    QCOMPARE(static_cast<uchar>(data.at(0)) & 0xc0, 0x40);
+    QCOMPARE(static_cast<uchar>(data.at(1)) & 0xc0, 0x40);
+    QCOMPARE(decoded(data, image), image);
+}
+
+void Test_QoiCodec::lumaWrapsAround() {
+    QImage image(2, 1, QImage::Format_RGB32);
+    image.setPixel(0, 0, qRgb(240, 242, 238)); // green -14, from 0
+    image.setPixel(1, 0, qRgb(4, 6, 2));       // green +20, through 255
+    QByteArray data = QoiCodec::encode(image);
+    QCOMPARE(data.size(), 4);
+    QCOMPARE(static_cast<uchar>(data.at(0)) & 0xc0, 0x80);
+    QCOMPARE(static_cast<uchar>(data.at(2)) & 0xc0, 0x80);
+    QCOMPARE(decoded(data, image), image);
+}
+
+void Test_QoiCodec::rejectsBadInput() {
+    QImage indexed(4, 4, QImage::Format_Indexed8);
+    QVERIFY(!QoiCodec::supportsFormat(indexed.format()));
+    QVERIFY(QoiCodec::encode(indexed).isEmpty());
+
+    QImage image(16, 16, QImage::Format_ARGB32);
+    QRandomGenerator gen(7);
+    for(int y = 0; y < image.height(); y++)
+        for(int x = 0; x < image.width(); x++)
+            image.setPixel(x, y, gen.generate());
+    QByteArray data = QoiCodec::encode(image);
+    QImage target(image.size(), image.format());
+    // truncated
+    QVERIFY(!QoiCodec::decode(data.left(data.size() - 1), target));
+    // trailing garbage
+    QVERIFY(!QoiCodec::decode(data + QByteArray(1, '\0'), target));
+    // wrong size
+    QImage smaller(8, 8, image.format());
+    QVERIFY(!QoiCodec::decode(data, smaller));
+}
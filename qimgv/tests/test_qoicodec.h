@@ -0,0 +1,17 @@
+#pragma once
+
+#include <QObject>
+#include <QImage>
+
+class Test_QoiCodec : public QObject
+{
+    Q_OBJECT
+private slots:
+    void roundTrip_data();
+    void roundTrip();
+    void longRun();
+    void indexHits();
+    void diffWrapsAround();
+    void lumaWrapsAround();
+    void rejectsBadInput();
+};
@@ -0,0 +1,250 @@
+#include "test_thumbnailpack.h"
+
+#include <QtTest>
+#include <QRandomGenerator>
+#include <QThread>
+#include <atomic>
+#include "../components/cache/thumbnailpack.h"
+
+QTEST_GUILESS_MAIN(Test_ThumbnailPack)
+
+namespace {
+// read() hands out a pointer into the mapping; copy it
+QByteArray readCopy(ThumbnailPack &pack, const QByteArray &key) {
+    QByteArray result;
+    pack.read(key, [&result](const QByteArray &data) {
+        result = QByteArray(data.constData(), data.size());
+    });
+    return result;
+}
+
+QByteArray payload(int n) {
+    return QByteArray("thumbnail ") + QByteArray::number(n);
+}
+}
+
+void Test_ThumbnailPack::init() {
+    dir = new QTemporaryDir();
+    QVERIFY(dir->isValid());
+}
+
+void Test_ThumbnailPack::cleanup() {
+    delete dir;
+}
+
+QString Test_ThumbnailPack::packPath() const {
+    return dir->filePath("thumbnails.pack");
+}
+
+void Test_ThumbnailPack::writeReadRemove() {
+    ThumbnailPack pack(packPath());
+    QVERIFY(pack.isOpen());
+    QVERIFY(pack.isWritable());
+    QCOMPARE(pack.stats().entries, 0u);
+
+    QByteArray key = ThumbnailPack::keyFor("/some/image.jpg:200");
+    QCOMPARE(key.size(), 16);
+    QVERIFY(!pack.contains(key));
+    QVERIFY(pack.write(key, "first"));
+    QVERIFY(pack.contains(key));
+    QCOMPARE(readCopy(pack, key), QByteArray("first"));
+
+    QVERIFY(pack.write(key, "second, longer"));
+    QCOMPARE(readCopy(pack, key), QByteArray("second, longer"));
+    QCOMPARE(pack.stats().entries, 1u);
+    QVERIFY(pack.stats().wastedBytes > 0);
+
+    QVERIFY(pack.remove(key));
+    QVERIFY(!pack.contains(key));
+    QVERIFY(!pack.remove(key));
+    QCOMPARE(pack.stats().entries, 0u);
+}
+
+void Test_ThumbnailPack::rejectsInvalidWrites() {
+    ThumbnailPack pack(packPath());
+    QVERIFY(!pack.write(ThumbnailPack::keyFor("a"), QByteArray()));
+    QVERIFY(!pack.write("short key", "data"));
+    QVERIFY(!pack.contains("short key"));
+    QCOMPARE(pack.stats().entries, 0u);
+}
+
+void Test_ThumbnailPack::persistsAcrossReopen() {
+    QByteArray key = ThumbnailPack::keyFor("a");
+    {
+        ThumbnailPack pack(packPath());
+        QVERIFY(pack.write(key, "data"));
+    }
+    ThumbnailPack pack(packPath());
+    QVERIFY(pack.isWritable());
+    QCOMPARE(readCopy(pack, key), QByteArray("data"));
+}
+
+void Test_ThumbnailPack::writeBatch() {
+    ThumbnailPack pack(packPath());
+    QList<QPair<QByteArray, QByteArray>> entries;
+    for(int i = 0; i < 3; i++)
+        entries.append(qMakePair(ThumbnailPack::keyFor(QString::number(i)), payload(i)));
+    entries.append(qMakePair(ThumbnailPack::keyFor("empty"), QByteArray()));
+    QCOMPARE(pack.writeBatch(entries), 3);
+    for(int i = 0; i < 3; i++)
+        QCOMPARE(readCopy(pack, ThumbnailPack::keyFor(QString::number(i))), payload(i));
+    QVERIFY(!pack.contains(ThumbnailPack::keyFor("empty")));
+}
+
+// enough entries to outgrow the initial index
+void Test_ThumbnailPack::indexGrowth() {
+    const int count = 5000;
+    {
+        ThumbnailPack pack(packPath());
+        for(int i = 0; i < count; i++)
+            QVERIFY(pack.write(ThumbnailPack::keyFor(QString::number(i)), payload(i)));
+        QCOMPARE(pack.stats().entries, static_cast<quint32>(count));
+        // the old index is garbage now
+        QVERIFY(pack.stats().wastedBytes > 0);
+    }
+    ThumbnailPack pack(packPath());
+    QCOMPARE(pack.stats().entries, static_cast<quint32>(count));
+    for(int i = 0; i < count; i++)
+        QCOMPARE(readCopy(pack, ThumbnailPack::keyFor(QString::number(i))), payload(i));
+}
+
+void Test_ThumbnailPack::compact() {
+    ThumbnailPack pack(packPath());
+    for(int i = 0; i < 10; i++)
+        pack.write(ThumbnailPack::keyFor(QString::number(i)), payload(i));
+    for(int i = 0; i < 5; i++)
+        pack.write(ThumbnailPack::keyFor(QString::number(i)), payload(i + 100));
+    pack.remove(ThumbnailPack::keyFor("8"));
+    pack.remove(ThumbnailPack::keyFor("9"));
+    QVERIFY(pack.stats().wastedBytes > 0);
+
+    QVERIFY(pack.compact());
+    QVERIFY(pack.isWritable());
+    QCOMPARE(pack.stats().entries, 8u);
+    QCOMPARE(pack.stats().wastedBytes, Q_INT64_C(0));
+    for(int i = 0; i < 8; i++)
+        QCOMPARE(readCopy(pack, ThumbnailPack::keyFor(QString::number(i))), payload(i < 5 ? i + 100 : i));
+    QVERIFY(!pack.contains(ThumbnailPack::keyFor("8")));
+    // still writable after the file was swapped
+    QVERIFY(pack.write(ThumbnailPack::keyFor("new"), "data"));
+    QCOMPARE(readCopy(pack, ThumbnailPack::keyFor("new")), QByteArray("data"));
+}
+
+void Test_ThumbnailPack::invalidFileIsRecreated() {
+    QFile garbage(packPath());
+    QVERIFY(garbage.open(QIODevice::WriteOnly));
+    garbage.write(QByteArray(1000, 'x'));
+    garbage.close();
+
+    ThumbnailPack pack(packPath());
+    QVERIFY(pack.isWritable());
+    QCOMPARE(pack.stats().entries, 0u);
+    QVERIFY(pack.write(ThumbnailPack::keyFor("a"), "data"));
+    QCOMPARE(readCopy(pack, ThumbnailPack::keyFor("a")), QByteArray("data"));
+}
+
+// The new pack must be a new file; whoever has the old one open keeps
+// seeing the old contents instead of a truncated file.
+void Test_ThumbnailPack::reinitializeReplacesFile() {
+#ifdef Q_OS_WIN
+    QSKIP("open files can't be replaced on Windows");
+#endif
+    const QByteArray old(1000, 'x');
+    QFile garbage(packPath());
+    QVERIFY(garbage.open(QIODevice::WriteOnly));
+    garbage.write(old);
+    garbage.close();
+
+    QFile reader(packPath());
+    QVERIFY(reader.open(QIODevice::ReadOnly));
+    ThumbnailPack pack(packPath());
+    QVERIFY(pack.isWritable());
+    QCOMPARE(reader.readAll(), old);
+    QVERIFY(pack.write(ThumbnailPack::keyFor("a"), "data"));
+}
+
+void Test_ThumbnailPack::secondInstanceIsReadOnly() {
+    QByteArray a = ThumbnailPack::keyFor("a");
+    QByteArray b = ThumbnailPack::keyFor("b");
+    ThumbnailPack writer(packPath());
+    QVERIFY(writer.write(a, "first"));
+
+    ThumbnailPack reader(packPath());
+    QVERIFY(reader.isOpen());
+    QVERIFY(!reader.isWritable());
+    QCOMPARE(readCopy(reader, a), QByteArray("first"));
+    QVERIFY(!reader.write(b, "data"));
+    QVERIFY(!reader.remove(a));
+    QVERIFY(!reader.compact());
+
+    // writes show up in the reader
+    QVERIFY(writer.write(b, "second"));
+    QCOMPARE(readCopy(reader, b), QByteArray("second"));
+
+    // the reader switches to the new file after compaction
+    QVERIFY(writer.remove(a));
+    QVERIFY(writer.compact());
+    QVERIFY(!writer.contains(a));
+    QVERIFY(writer.write(a, "third"));
+    QCOMPARE(readCopy(reader, b), QByteArray("second"));
+    QCOMPARE(readCopy(reader, a), QByteArray("third"));
+    QVERIFY(!reader.isWritable());
+}
+
+// The writer grows the file past the reader's mapping and moves the index
+// while the reader is looking things up.
+void Test_ThumbnailPack::readWhileWriterGrows() {
+    const int count = 12000;
+    const QByteArray filler(2000, 'x');
+    ThumbnailPack writer(packPath());
+    ThumbnailPack reader(packPath());
+    QVERIFY(!reader.isWritable());
+
+    std::atomic_int written(0);
+    QScopedPointer<QThread> thread(QThread::create([&]() {
+        for(int i = 0; i < count; i++) {
+            writer.write(ThumbnailPack::keyFor(QString::number(i)), payload(i) + filler);
+            written = i + 1;
+        }
+    }));
+    thread->start();
+    int hits = 0, wrong = 0;
+    while(written < count) {
+        int n = written;
+        if(!n)
+            continue;
+        int i = QRandomGenerator::global()->bounded(n);
+        QByteArray data = readCopy(reader, ThumbnailPack::keyFor(QString::number(i)));
+        if(data.isEmpty())
+            continue;
+        hits++;
+        if(data != payload(i) + filler)
+            wrong++;
+    }
+    thread->wait();
+    QCOMPARE(wrong, 0);
+    qDebug() << hits << "hits while writing";
+    for(int i = 0; i < count; i++)
+        QCOMPARE(readCopy(reader, ThumbnailPack::keyFor(QString::number(i))), payload(i) + filler);
+}
+
+// A reader that could not use the file picks up the one the writer creates.
+void Test_ThumbnailPack::readerPicksUpRecreatedPack() {
+    QFile garbage(packPath());
+    QVERIFY(garbage.open(QIODevice::WriteOnly));
+    garbage.write(QByteArray(1000, 'x'));
+    garbage.close();
+
+    // pretend there is a writer
+    std::unique_ptr<QLockFile> lock(new QLockFile(packPath() + ".lock"));
+    QVERIFY(lock->tryLock(0));
+    ThumbnailPack reader(packPath());
+    QVERIFY(!reader.isOpen());
+    lock.reset();
+
+    ThumbnailPack writer(packPath());
+    QVERIFY(writer.isWritable());
+    QVERIFY(writer.write(ThumbnailPack::keyFor("a"), "data"));
+    QCOMPARE(readCopy(reader, ThumbnailPack::keyFor("a")), QByteArray("data"));
+    QVERIFY(!reader.isWritable());
+}
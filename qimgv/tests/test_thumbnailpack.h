@@ -0,0 +1,28 @@
+#pragma once
+
+#include <QObject>
+#include <QTemporaryDir>
+
+class Test_ThumbnailPack : public QObject
+{
+    Q_OBJECT
+private slots:
+    void init();
+    void cleanup();
+
+    void writeReadRemove();
+    void rejectsInvalidWrites();
+    void persistsAcrossReopen();
+    void writeBatch();
+    void indexGrowth();
+    void compact();
+    void invalidFileIsRecreated();
+    void reinitializeReplacesFile();
+    void secondInstanceIsReadOnly();
+    void readWhileWriterGrows();
+    void readerPicksUpRecreatedPack();
+
+private:
+    QTemporaryDir *dir;
+    QString packPath() const;
+};
@@ -0,0 +1,191 @@
+#include "test_thumbnailtaskqueue.h"
+
+#include <QtTest>
+#include "../components/thumbnailer/thumbnailtaskqueue.h"
+
+QTEST_GUILESS_MAIN(Test_ThumbnailTaskQueue)
+
+namespace {
+ThumbnailTask makeTask(const QString &path, bool force = false) {
+    ThumbnailTask task;
+    task.path = path;
+    task.size = 100;
+    task.force = force;
+    return task;
+}
+
+// takes everything that is left
+QStringList drain(ThumbnailTaskQueue &queue) {
+    QStringList paths;
+    ThumbnailTask task;
+    while(queue.take(task)) {
+        paths << task.path;
+        queue.finish(task, true);
+    }
+    return paths;
+}
+}
+
+void Test_ThumbnailTaskQueue::spawnCountIsCapped() {
+    ThumbnailTaskQueue queue(2);
+    QCOMPARE(queue.setTasks({ makeTask("a"), makeTask("b"), makeTask("c") }), 2);
+    QCOMPARE(queue.addTask(makeTask("d")), 0);
+    ThumbnailTaskQueue single(1);
+    QCOMPARE(single.setTasks({ makeTask("a") }), 1);
+    QCOMPARE(single.setTasks({}), 0);
+}
+
+void Test_ThumbnailTaskQueue::takeInPriorityOrder() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a"), makeTask("b") });
+    queue.addTask(makeTask("c"));
+    QCOMPARE(drain(queue), QStringList({ "a", "b", "c" }));
+    ThumbnailTask task;
+    QVERIFY(!queue.take(task));
+}
+
+void Test_ThumbnailTaskQueue::duplicatesAreIgnored() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a"), makeTask("b"), makeTask("a") });
+    QCOMPARE(drain(queue), QStringList({ "a", "b" }));
+}
+
+void Test_ThumbnailTaskQueue::addTaskSkipsQueuedDuplicate() {
+    ThumbnailTaskQueue queue(1);
+    QCOMPARE(queue.addTask(makeTask("a")), 1);
+    QCOMPARE(queue.addTask(makeTask("b")), 0);
+    QCOMPARE(queue.addTask(makeTask("a")), 0);
+    QCOMPARE(drain(queue), QStringList({ "a", "b" }));
+}
+
+void Test_ThumbnailTaskQueue::forcedAddTaskReplacesQueuedOne() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a"), makeTask("b") });
+    QCOMPARE(queue.addTask(makeTask("b", true)), 0);
+    // a plain request doesn't undo the forced one
+    queue.addTask(makeTask("b"));
+    ThumbnailTask task;
+    QVERIFY(queue.take(task));
+    QCOMPARE(task.path, QString("a"));
+    queue.finish(task, true);
+    QVERIFY(queue.take(task));
+    QCOMPARE(task.path, QString("b"));
+    QVERIFY(task.force);
+    queue.finish(task, true);
+    QVERIFY(!queue.take(task));
+}
+
+void Test_ThumbnailTaskQueue::setTasksKeepsWantedRunningTasks() {
+    ThumbnailTaskQueue queue(4);
+    queue.setTasks({ makeTask("a"), makeTask("b") });
+    ThumbnailTask a;
+    QVERIFY(queue.take(a));
+    QCOMPARE(a.path, QString("a"));
+
+    queue.setTasks({ makeTask("b") });
+    QVERIFY(*a.cancel);
+    // requested again before the worker noticed
+    queue.setTasks({ makeTask("c"), makeTask("a"), makeTask("b") });
+    QVERIFY(!*a.cancel);
+
+    // "a" is not queued twice
+    ThumbnailTask task;
+    QVERIFY(queue.take(task));
+    QCOMPARE(task.path, QString("c"));
+    queue.finish(task, true);
+    queue.finish(a, true);
+    QCOMPARE(drain(queue), QStringList({ "b" }));
+}
+
+void Test_ThumbnailTaskQueue::setTasksCancelsUnwantedRunningTasks() {
+    ThumbnailTaskQueue queue(2);
+    queue.setTasks({ makeTask("a"), makeTask("b") });
+    ThumbnailTask a, b;
+    QVERIFY(queue.take(a));
+    QVERIFY(queue.take(b));
+    queue.setTasks({ makeTask("b"), makeTask("c") });
+    QVERIFY(*a.cancel);
+    QVERIFY(!*b.cancel);
+}
+
+void Test_ThumbnailTaskQueue::interruptedTaskIsRetriedFirst() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a"), makeTask("b") });
+    ThumbnailTask a;
+    QVERIFY(queue.take(a));
+    queue.finish(a, false);
+    QCOMPARE(drain(queue), QStringList({ "a", "b" }));
+}
+
+void Test_ThumbnailTaskQueue::cancelledTaskIsNotRetried() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a"), makeTask("b") });
+    ThumbnailTask a;
+    QVERIFY(queue.take(a));
+    queue.setTasks({ makeTask("b") });
+    queue.finish(a, false);
+    QCOMPARE(drain(queue), QStringList({ "b" }));
+}
+
+void Test_ThumbnailTaskQueue::forcedTaskRerunsAfterRunningOne() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a"), makeTask("b") });
+    ThumbnailTask a;
+    QVERIFY(queue.take(a));
+    QVERIFY(!a.force);
+
+    // via addTask
+    QCOMPARE(queue.addTask(makeTask("a", true)), 0);
+    QVERIFY(*a.cancel);
+    queue.finish(a, false);
+    ThumbnailTask forced;
+    QVERIFY(queue.take(forced));
+    QCOMPARE(forced.path, QString("a"));
+    QVERIFY(forced.force);
+    QVERIFY(!*forced.cancel);
+
+    // via setTasks, even when the running one completes
+    queue.setTasks({ makeTask("a", true), makeTask("b") });
+    QVERIFY(*forced.cancel);
+    queue.finish(forced, true);
+    QCOMPARE(drain(queue), QStringList({ "a", "b" }));
+}
+
+void Test_ThumbnailTaskQueue::forcedTaskStaysCancelled() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a") });
+    ThumbnailTask a;
+    QVERIFY(queue.take(a));
+    queue.addTask(makeTask("a", true));
+    // a plain request must not revive the stale run
+    queue.setTasks({ makeTask("a") });
+    QVERIFY(*a.cancel);
+    queue.finish(a, false);
+    ThumbnailTask task;
+    QVERIFY(queue.take(task));
+    QVERIFY(task.force);
+}
+
+void Test_ThumbnailTaskQueue::droppedKeyDropsRerun() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a") });
+    ThumbnailTask a;
+    QVERIFY(queue.take(a));
+    queue.addTask(makeTask("a", true));
+    queue.setTasks({ makeTask("b") });
+    queue.finish(a, false);
+    QCOMPARE(drain(queue), QStringList({ "b" }));
+}
+
+void Test_ThumbnailTaskQueue::cancelAll() {
+    ThumbnailTaskQueue queue(1);
+    queue.setTasks({ makeTask("a"), makeTask("b") });
+    ThumbnailTask a;
+    QVERIFY(queue.take(a));
+    queue.addTask(makeTask("a", true));
+    queue.cancelAll();
+    QVERIFY(*a.cancel);
+    queue.finish(a, false);
+    ThumbnailTask task;
+    QVERIFY(!queue.take(task));
+}
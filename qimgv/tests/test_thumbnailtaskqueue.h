@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QObject>
+
+class Test_ThumbnailTaskQueue : public QObject
+{
+    Q_OBJECT
+private slots:
+    void spawnCountIsCapped();
+    void takeInPriorityOrder();
+    void duplicatesAreIgnored();
+    void addTaskSkipsQueuedDuplicate();
+    void forcedAddTaskReplacesQueuedOne();
+    void setTasksKeepsWantedRunningTasks();
+    void setTasksCancelsUnwantedRunningTasks();
+    void interruptedTaskIsRetriedFirst();
+    void cancelledTaskIsNotRetried();
+    void forcedTaskRerunsAfterRunningOne();
+    void forcedTaskStaysCancelled();
+    void droppedKeyDropsRerun();
+    void cancelAll();
+};
@@ -0,0 +1,13 @@
+#include "cancellablefile.h"
+
+CancellableFile::CancellableFile(const QString &path, std::shared_ptr<std::atomic_bool> _cancelFlag)
+    : QFile(path),
+      cancelFlag(_cancelFlag)
+{
+}
+
+qint64 CancellableFile::readData(char *data, qint64 maxSize) {
+    if(cancelFlag && cancelFlag->load())
+        return -1;
+    return QFile::readData(data, qMin(maxSize, CHUNK_SIZE));
+}
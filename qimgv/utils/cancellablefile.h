@@ -0,0 +1,20 @@
+#pragma once
+
+#include <QFile>
+#include <atomic>
+#include <memory>
+
+// QFile that fails all reads once the flag is set.
+// Used as a QImageReader device to abort decoders mid-flight.
+// Reads are also split into chunks so the flag gets checked often.
+class CancellableFile : public QFile {
+public:
+    CancellableFile(const QString &path, std::shared_ptr<std::atomic_bool> _cancelFlag);
+
+protected:
+    qint64 readData(char *data, qint64 maxSize) override;
+
+private:
+    std::shared_ptr<std::atomic_bool> cancelFlag;
+    const qint64 CHUNK_SIZE = 256 * 1024;
+};
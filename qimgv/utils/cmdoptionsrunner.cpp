@@ -1,15 +1,50 @@
 #include "cmdoptionsrunner.h"
 
-void CmdOptionsRunner::generateThumbs(QString dirPath, int size) {
-    if(size <= 50 || size > 400) {
-        qDebug() << "Error: Invalid thumbnail size.";
-        qDebug() << "Please specify a value between [50, 400].";
-        qDebug() << "Example:  qimgv --gen-thumbs=/home/user/Pictures/ --gen-thumbs-size=120";
+namespace {
+std::atomic_bool interruptRequested(false);
+
+void onInterrupt(int) {
+    interruptRequested = true;
+}
+
+// best of a few runs, at least 0.5s total
+void benchmark(QString name, QSize sourceSize, std::function<void()> func) {
+    qint64 best = -1, total = 0;
+    QElapsedTimer t;
+    for(int runs = 0; runs < 3 || total < 500000000; runs++) {
+        t.start();
+        func();
+        qint64 elapsed = t.nsecsElapsed();
+        total += elapsed;
+        if(best < 0 || elapsed < best)
+            best = elapsed;
+    }
+    double ms = best / 1000000.0;
+    double mpps = (static_cast<double>(sourceSize.width()) * sourceSize.height()) / (best / 1000.0);
+    qDebug().noquote() << QString("   %1 %2 ms  %3 MP/s").arg(name, -40)
+                                                       .arg(ms, 8, 'f', 2)
+                                                       .arg(mpps, 8, 'f', 1);
+}
+}
+
+// Prints progress to stderr and a json summary to stdout.
+// Ctrl+C stops after the current files; running it again continues where it stopped.
+void CmdOptionsRunner::generateThumbs(QString dirPath, QList<int> sizes, bool crop, int threads) {
+    for(auto size : sizes) {
+        if(size <= 50 || size > 400) {
+            qDebug() << "Error: Invalid thumbnail size.";
+            qDebug() << "Please specify values between [50, 400].";
+            qDebug() << "Example:  qimgv --gen-thumbs=/home/user/Pictures/ --gen-thumbs-size=120,200";
+            QCoreApplication::exit(1);
+            return;
+        }
+    }
+    if(sizes.isEmpty() || threads < 1) {
+        qDebug() << "Error: Invalid arguments.";
         QCoreApplication::exit(1);
         return;
     }
 
-    Thumbnailer th;
     DirectoryManager dm;
     if(!dm.setDirectoryRecursive(dirPath)) {
         qDebug() << "Error: Invalid path.";
@@ -18,18 +53,64 @@ void CmdOptionsRunner::generateThumbs(QString dirPath, int size) {
     }
 
     auto list = dm.fileList();
+    QStringList sizeList;
+    for(auto size : sizes)
+        sizeList << QString::number(size);
 
     qDebug() << "\nDirectory:" << dirPath;
     qDebug() << "File count:" << list.size();
-    qDebug() << "Size limit:" << size << "x" << size << "px";
+    qDebug().noquote() << "Sizes:" << sizeList.join(", ") << (crop ? "(square)" : "");
+    qDebug() << "Threads:" << threads;
     qDebug() << "Generating thumbnails...";
 
-    for(auto path : list)
-        th.getThumbnailAsync(path, size, false, false);
+    ThumbnailBatch batch(list, sizes, crop, threads);
+    interruptRequested = false;
+    auto oldIntHandler = std::signal(SIGINT, onInterrupt);
+    auto oldTermHandler = std::signal(SIGTERM, onInterrupt);
+    batch.run([&batch](const ThumbnailBatchStats &stats) {
+        if(interruptRequested)
+            batch.cancel();
+        double seconds = qMax(stats.elapsed, qint64(1)) / 1000.0;
+        qDebug().noquote() << QString("%1/%2  generated: %3  skipped: %4  failed: %5  %6 files/s")
+                              .arg(stats.processed).arg(stats.files).arg(stats.generated)
+                              .arg(stats.skipped).arg(stats.failed).arg(stats.generated / seconds, 0, 'f', 1);
+    }, 2000);
+    std::signal(SIGINT, oldIntHandler);
+    std::signal(SIGTERM, oldTermHandler);
 
-    th.waitForDone();
-    qDebug() << "\nDone.";
-    QCoreApplication::quit();
+    ThumbnailBatchStats stats = batch.stats();
+    ThumbnailWriterStats writerStats = ThumbnailCache().writerStats();
+    double seconds = qMax(stats.elapsed, qint64(1)) / 1000.0;
+    qDebug() << (stats.interrupted ? "\nInterrupted." : "\nDone.");
+    qDebug() << "Written:" << writerStats.written << "thumbnails," << writerStats.bytesWritten / 1024 << "KB in" << writerStats.batches << "batches";
+    qDebug() << "Encoding:" << writerStats.encodeTime << "ms, writing:" << writerStats.writeTime << "ms";
+    qDebug() << "Max queue depth:" << writerStats.maxQueueDepth << "| stalls:" << writerStats.stalls << "| merged:" << writerStats.replaced;
+
+    QJsonObject summary;
+    summary["directory"] = dirPath;
+    QJsonArray sizeArray;
+    for(auto size : sizes)
+        sizeArray.append(size);
+    summary["sizes"] = sizeArray;
+    summary["crop"] = crop;
+    summary["threads"] = threads;
+    summary["files"] = stats.files;
+    summary["processed"] = stats.processed;
+    summary["generated"] = stats.generated;
+    summary["skipped"] = stats.skipped;
+    summary["unsupported"] = stats.unsupported;
+    summary["failed"] = stats.failed;
+    summary["failedPaths"] = QJsonArray::fromStringList(stats.failedPaths);
+    summary["bytesRead"] = stats.bytesRead;
+    summary["seconds"] = seconds;
+    summary["filesPerSecond"] = stats.generated / seconds;
+    summary["bytesPerSecond"] = stats.bytesRead / seconds;
+    summary["thumbnailsWritten"] = static_cast<qint64>(writerStats.written);
+    summary["bytesWritten"] = writerStats.bytesWritten;
+    summary["interrupted"] = stats.interrupted;
+    QTextStream(stdout) << QJsonDocument(summary).toJson(QJsonDocument::Compact) << "\n";
+
+    QCoreApplication::exit(stats.interrupted ? 130 : 0);
 }
 
 void CmdOptionsRunner::showBuildOptions() {
@@ -53,3 +134,82 @@ void CmdOptionsRunner::showBuildOptions() {
         qDebug() << "   " << features.at(i);
     QCoreApplication::quit();
 }
+
+// Compares the built-in resampler with QImage::scaled and OpenCV
+void CmdOptionsRunner::benchmarkScaling(QString path) {
+    QImage source(path);
+    if(source.isNull()) {
+        qDebug() << "Error: Could not load" << path;
+        QCoreApplication::exit(1);
+        return;
+    }
+    // same input for everything; this is what most decoders produce anyway
+    source = source.convertToFormat(source.hasAlphaChannel() ? QImage::Format_ARGB32_Premultiplied
+                                                             : QImage::Format_RGB32);
+    int threads = QThread::idealThreadCount();
+    auto best = Resampler::implementation();
+    qDebug() << "\nImage:" << path << source.size();
+    qDebug().noquote() << "Resampler:" << Resampler::implementationName(best) << "|" << threads << "threads";
+#ifdef USE_OPENCV
+    QtOcv::MatColorOrder order;
+    cv::Mat srcMat = QtOcv::image2Mat_shared(source, &order);
+#endif
+    for(qreal scale : { 0.75, 0.5, 0.25, 0.1 }) {
+        QSize destSize = (source.size() * scale).expandedTo(QSize(1, 1));
+        qDebug() << "\n" << source.size() << "->" << destSize;
+        benchmark("QImage::scaled (smooth)", source.size(), [&]() {
+            source.scaled(destSize, Qt::IgnoreAspectRatio, Qt::SmoothTransformation);
+        });
+        for(auto kernel : { Resampler::KERNEL_AREA, Resampler::KERNEL_LANCZOS3 }) {
+            QString kernelName = (kernel == Resampler::KERNEL_AREA) ? "area" : "lanczos3";
+            benchmark(kernelName + ", generic, 1 thread", source.size(), [&]() {
+                Resampler::resample(source, destSize, kernel, 1, Resampler::IMPL_GENERIC);
+            });
+            if(best != Resampler::IMPL_GENERIC) {
+                benchmark(kernelName + ", " + Resampler::implementationName(best) + ", 1 thread", source.size(), [&]() {
+                    Resampler::resample(source, destSize, kernel, 1, best);
+                });
+            }
+            benchmark(kernelName + ", " + Resampler::implementationName(best) + ", " + QString::number(threads) + " threads", source.size(), [&]() {
+                Resampler::resample(source, destSize, kernel, threads, best);
+            });
+        }
+#ifdef USE_OPENCV
+        cv::Size destSizeCv(destSize.width(), destSize.height());
+        benchmark("cv::resize INTER_AREA", source.size(), [&]() {
+            cv::Mat dstMat;
+            cv::resize(srcMat, dstMat, destSizeCv, 0, 0, cv::INTER_AREA);
+        });
+        benchmark("cv::resize INTER_CUBIC", source.size(), [&]() {
+            cv::Mat dstMat;
+            cv::resize(srcMat, dstMat, destSizeCv, 0, 0, cv::INTER_CUBIC);
+        });
+        benchmark("cv::resize INTER_LANCZOS4", source.size(), [&]() {
+            cv::Mat dstMat;
+            cv::resize(srcMat, dstMat, destSizeCv, 0, 0, cv::INTER_LANCZOS4);
+        });
+#endif
+    }
+    QCoreApplication::quit();
+}
+
+void CmdOptionsRunner::thumbnailCacheStats(bool clean) {
+    ThumbnailCache cache;
+    ThumbnailPackStats packStats = cache.stats();
+    qDebug() << "\nCache:" << settings->thumbnailCacheDir();
+    qDebug() << "File size:" << packStats.fileSize / 1024 << "KB";
+    qDebug() << "Unused space:" << packStats.wastedBytes / 1024 << "KB";
+    qDebug() << (clean ? "Cleaning up..." : "Scanning...");
+    qint64 maxBytes = static_cast<qint64>(settings->thumbnailCacheLimit()) * 1024 * 1024;
+    ThumbnailCacheStats stats = cache.collectGarbage(maxBytes, settings->thumbnailCacheMaxAge(), !clean);
+    qDebug() << "Thumbnails:" << stats.entries;
+    qDebug() << "Thumbnail data:" << stats.bytes / 1024 << "KB";
+    qDebug() << "Orphaned:" << stats.orphans;
+    if(clean) {
+        qDebug() << "Removed:" << stats.removed;
+        qDebug() << "Freed:" << stats.freedBytes / 1024 << "KB";
+        if(stats.migrated)
+            qDebug() << "Migrated from png:" << stats.migrated;
+    }
+    QCoreApplication::quit();
+}
@@ -4,11 +4,23 @@
 #include <QObject>
 #include <QDebug>
 #include <QString>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QJsonObject>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <functional>
+#include <csignal>
+#include <atomic>
 #include "core.h"
+#include "components/thumbnailer/thumbnailbatch.h"
+#include "utils/imagelib.h"
 
 class CmdOptionsRunner : public QObject {
     Q_OBJECT
 public slots:
-    void generateThumbs(QString dirPath, int size);
+    void generateThumbs(QString dirPath, QList<int> sizes, bool crop, int threads);
     void showBuildOptions();
+    void benchmarkScaling(QString path);
+    void thumbnailCacheStats(bool clean);
 };
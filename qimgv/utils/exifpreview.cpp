@@ -0,0 +1,160 @@
+#include "exifpreview.h"
+
+namespace {
+// tiff/exif ifd parsing helpers
+quint16 get16(const uchar *p, bool le) {
+    return le ? static_cast<quint16>(p[0] | (p[1] << 8))
+              : static_cast<quint16>((p[0] << 8) | p[1]);
+}
+
+quint32 get32(const uchar *p, bool le) {
+    return le ? (static_cast<quint32>(p[0]) | (static_cast<quint32>(p[1]) << 8) | (static_cast<quint32>(p[2]) << 16) | (static_cast<quint32>(p[3]) << 24))
+              : ((static_cast<quint32>(p[0]) << 24) | (static_cast<quint32>(p[1]) << 16) | (static_cast<quint32>(p[2]) << 8) | static_cast<quint32>(p[3]));
+}
+}
+
+bool ExifPreview::isSupportedFormat(const QString &format) {
+    static const QStringList formats = { "jpg", "jpeg", "tif", "tiff", "dng", "cr2", "cr3", "nef", "nrw", "arw",
+                                         "srf", "sr2", "orf", "rw2", "raf", "pef", "srw", "x3f", "3fr", "erf",
+                                         "kdc", "mrw", "mos", "iiq", "rwl" };
+    return formats.contains(format.toLower());
+}
+
+// the preview has to be big enough and show the whole picture (some cameras letterbox them)
+bool ExifPreview::isUsable(QSize preview, QSize original, int size, bool crop) {
+    if(preview.isEmpty() || original.isEmpty())
+        return false;
+    double previewAR = static_cast<double>(preview.width()) / preview.height();
+    double originalAR = static_cast<double>(original.width()) / original.height();
+    if(qAbs(previewAR - originalAR) > originalAR * 0.02)
+        return false;
+    QSize target = original.scaled(size, size, crop ? Qt::KeepAspectRatioByExpanding : Qt::KeepAspectRatio);
+    return preview.width() >= target.width() && preview.height() >= target.height();
+}
+
+ExifPreviewData ExifPreview::find(const QString &path, int size, bool crop) {
+    ExifPreviewData result;
+#ifdef USE_EXIV2
+    try {
+        std::unique_ptr<Exiv2::Image> image = Exiv2::ImageFactory::open(toStdString(path));
+        if(!image.get())
+            return result;
+        image->readMetadata();
+        QSize original(image->pixelWidth(), image->pixelHeight());
+        if(original.isEmpty())
+            original = QImageReader(path).size();
+        Exiv2::ExifData &exifData = image->exifData();
+        auto it = exifData.findKey(Exiv2::ExifKey("Exif.Image.Orientation"));
+        int orientation = -1;
+        if(it != exifData.end() && it->count())
+            orientation = exifToTransformation(static_cast<int>(it->toFloat()));
+        Exiv2::PreviewManager manager(*image);
+        // sorted by size, smallest first
+        Exiv2::PreviewPropertiesList list = manager.getPreviewProperties();
+        for(auto &props : list) {
+            QSize previewSize(static_cast<int>(props.width_), static_cast<int>(props.height_));
+            if(!isUsable(previewSize, original, size, crop))
+                continue;
+            Exiv2::PreviewImage preview = manager.getPreviewImage(props);
+            result.data = QByteArray(reinterpret_cast<const char*>(preview.pData()), static_cast<int>(preview.size()));
+            result.size = previewSize;
+            result.originalSize = original;
+            result.orientation = orientation;
+            break;
+        }
+    }
+    catch (Exiv2::AnyError& e) {
+        qDebug() << "[ExifPreview] Caught Exiv2 exception:" << e.what();
+        result = ExifPreviewData();
+    }
+#else
+    ExifPreviewData thumb = findJpegThumbnail(path);
+    if(isUsable(thumb.size, thumb.originalSize, size, crop))
+        result = thumb;
+#endif
+    return result;
+}
+
+// IFD1 thumbnail from the APP1 segment. Typically 160x120, so this only helps for small thumbnails.
+ExifPreviewData ExifPreview::findJpegThumbnail(const QString &path) {
+    ExifPreviewData result;
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return result;
+    QByteArray marker = file.read(2);
+    if(marker.size() != 2 || static_cast<uchar>(marker[0]) != 0xFF || static_cast<uchar>(marker[1]) != 0xD8)
+        return result;
+    QByteArray segment;
+    // find the exif segment; it comes before the image data
+    for(int i = 0; i < 16; i++) {
+        QByteArray head = file.read(4);
+        if(head.size() != 4 || static_cast<uchar>(head[0]) != 0xFF)
+            return result;
+        uchar type = static_cast<uchar>(head[1]);
+        int length = (static_cast<uchar>(head[2]) << 8) | static_cast<uchar>(head[3]);
+        if(type == 0xDA || length < 2)
+            return result;
+        if(type == 0xE1) {
+            segment = file.read(length - 2);
+            if(segment.startsWith(QByteArray("Exif\0\0", 6)))
+                break;
+            segment.clear();
+        } else if(!file.seek(file.pos() + length - 2)) {
+            return result;
+        }
+    }
+    if(segment.size() < 6 + 8)
+        return result;
+    const uchar *tiff = reinterpret_cast<const uchar*>(segment.constData()) + 6;
+    quint32 tiffSize = static_cast<quint32>(segment.size() - 6);
+    bool le = (tiff[0] == 'I' && tiff[1] == 'I');
+    if(!le && !(tiff[0] == 'M' && tiff[1] == 'M'))
+        return result;
+    if(get16(tiff + 2, le) != 42)
+        return result;
+    // skip IFD0
+    // offsets come from the file; compare in 64 bits so that nothing wraps around
+    quint32 ifd = get32(tiff + 4, le);
+    if(quint64(ifd) + 2 > tiffSize)
+        return result;
+    quint32 entries = get16(tiff + ifd, le);
+    quint64 next = quint64(ifd) + 2 + quint64(entries) * 12;
+    if(next + 4 > tiffSize)
+        return result;
+    ifd = get32(tiff + next, le);
+    if(!ifd || quint64(ifd) + 2 > tiffSize)
+        return result;
+    entries = get16(tiff + ifd, le);
+    if(quint64(ifd) + 2 + quint64(entries) * 12 > tiffSize)
+        return result;
+    quint32 offset = 0, length = 0;
+    for(quint32 n = 0; n < entries; n++) {
+        const uchar *entry = tiff + ifd + 2 + n * 12;
+        quint16 tag = get16(entry, le);
+        if(tag == 0x0201)
+            offset = get32(entry + 8, le);
+        else if(tag == 0x0202)
+            length = get32(entry + 8, le);
+    }
+    if(!offset || !length || offset > tiffSize || length > tiffSize - offset)
+        return result;
+    result.data = QByteArray(reinterpret_cast<const char*>(tiff + offset), static_cast<int>(length));
+    QBuffer buffer(&result.data);
+    result.size = QImageReader(&buffer, "jpg").size();
+    file.close();
+    result.originalSize = QImageReader(path, "jpg").size();
+    return result;
+}
+
+int ExifPreview::exifToTransformation(int exifOrientation) {
+    switch(exifOrientation) {
+    case 2: return QImageIOHandler::TransformationMirror;
+    case 3: return QImageIOHandler::TransformationRotate180;
+    case 4: return QImageIOHandler::TransformationFlip;
+    case 5: return QImageIOHandler::TransformationFlipAndRotate90;
+    case 6: return QImageIOHandler::TransformationRotate90;
+    case 7: return QImageIOHandler::TransformationMirrorAndRotate90;
+    case 8: return QImageIOHandler::TransformationRotate270;
+    default: return QImageIOHandler::TransformationNone;
+    }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include <QString>
+#include <QSize>
+#include <QFile>
+#include <QBuffer>
+#include <QImageReader>
+#include <QDebug>
+#include "utils/stuff.h"
+
+#ifdef USE_EXIV2
+#include <exiv2/exiv2.hpp>
+#endif
+
+struct ExifPreviewData {
+    QByteArray data;        // encoded image (usually jpeg)
+    QSize size;
+    QSize originalSize;     // of the main image
+    int orientation = -1;   // QImageIOHandler::Transformations; -1 if unknown
+};
+
+// Finds previews embedded into camera files, so that thumbnails can be made without
+// decoding the full image. With exiv2 this covers all the previews it knows about
+// (including raw formats); otherwise only the exif thumbnail of jpeg files.
+class ExifPreview {
+public:
+    static bool isSupportedFormat(const QString &format);
+    // Smallest preview that can be scaled down to a size x size thumbnail
+    // (covering it if crop is set) of the same aspect ratio as the main image.
+    // Empty data if there is none.
+    static ExifPreviewData find(const QString &path, int size, bool crop);
+
+private:
+    static bool isUsable(QSize preview, QSize original, int size, bool crop);
+    static ExifPreviewData findJpegThumbnail(const QString &path);
+    static int exifToTransformation(int exifOrientation);
+};
@@ -0,0 +1,56 @@
+#include "fileidentity.h"
+
+#ifdef _WIN32
+#include <windows.h>
+#else
+#include <sys/stat.h>
+#endif
+
+QString FileIdentity::fileId(const QString &path) {
+#ifdef _WIN32
+    HANDLE handle = CreateFileW(reinterpret_cast<LPCWSTR>(path.utf16()), 0,
+                                FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                                nullptr, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS, nullptr);
+    if(handle == INVALID_HANDLE_VALUE)
+        return QString();
+    BY_HANDLE_FILE_INFORMATION info;
+    bool ok = GetFileInformationByHandle(handle, &info);
+    CloseHandle(handle);
+    if(!ok)
+        return QString();
+    quint64 index = (static_cast<quint64>(info.nFileIndexHigh) << 32) | info.nFileIndexLow;
+    quint64 size = (static_cast<quint64>(info.nFileSizeHigh) << 32) | info.nFileSizeLow;
+    quint64 mtime = (static_cast<quint64>(info.ftLastWriteTime.dwHighDateTime) << 32) | info.ftLastWriteTime.dwLowDateTime;
+    return QString("id:%1:%2:%3:%4").arg(info.dwVolumeSerialNumber).arg(index).arg(mtime).arg(size);
+#else
+    struct stat st;
+    if(stat(QFile::encodeName(path).constData(), &st) != 0)
+        return QString();
+    // some network filesystems make up inode numbers
+    if(st.st_ino == 0)
+        return QString();
+    return QString("id:%1:%2:%3:%4").arg(static_cast<quint64>(st.st_dev))
+                                    .arg(static_cast<quint64>(st.st_ino))
+                                    .arg(static_cast<qint64>(st.st_mtime))
+                                    .arg(static_cast<qint64>(st.st_size));
+#endif
+}
+
+QString FileIdentity::contentHash(const QString &path) {
+    QFile file(path);
+    if(!file.open(QIODevice::ReadOnly))
+        return QString();
+    qint64 size = file.size();
+    QCryptographicHash hash(QCryptographicHash::Md5);
+    hash.addData(QByteArray::number(size));
+    QByteArray head = file.read(SAMPLE_SIZE);
+    if(head.isEmpty() && size > 0)
+        return QString();
+    hash.addData(head);
+    if(size > SAMPLE_SIZE) {
+        if(!file.seek(qMax(SAMPLE_SIZE, size - SAMPLE_SIZE)))
+            return QString();
+        hash.addData(file.read(SAMPLE_SIZE));
+    }
+    return "content:" + QString(hash.result().toHex());
+}
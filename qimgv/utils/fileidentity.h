@@ -0,0 +1,22 @@
+#pragma once
+
+#include <QString>
+#include <QFile>
+#include <QFileInfo>
+#include <QDateTime>
+#include <QCryptographicHash>
+
+// Ways to recognize a file that do not depend on its path.
+// Both return an empty string when it can't be done.
+class FileIdentity {
+public:
+    // device + inode (file index on windows) + mtime + size. Cheap, survives renames
+    // and moves within the same filesystem.
+    static QString fileId(const QString &path);
+    // hash of the size plus first and last SAMPLE_SIZE bytes. Costs two small reads,
+    // but survives copies to another disk.
+    static QString contentHash(const QString &path);
+
+private:
+    static constexpr qint64 SAMPLE_SIZE = 16 * 1024;
+};
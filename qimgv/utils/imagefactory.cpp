@@ -1,6 +1,11 @@
 #include "imagefactory.h"
 
 std::shared_ptr<Image> ImageFactory::createImage(QString path) {
+    return createImage(path, nullptr);
+}
+
+// returns nullptr if loading was cancelled via cancelFlag
+std::shared_ptr<Image> ImageFactory::createImage(QString path, std::shared_ptr<std::atomic_bool> cancelFlag) {
     std::unique_ptr<DocumentInfo> docInfo(new DocumentInfo(path));
     std::shared_ptr<Image> img = nullptr;
     if(docInfo->type() == NONE) {
@@ -10,7 +15,38 @@ std::shared_ptr<Image> ImageFactory::createImage(QString path) {
     } else if(docInfo->type() == VIDEO) {
         img.reset(new Video(move(docInfo)));
     } else {
-        img.reset(new ImageStatic(move(docInfo)));
+        img.reset(new ImageStatic(move(docInfo), cancelFlag));
     }
+    if(cancelFlag && cancelFlag->load())
+        img = nullptr;
     return img;
 }
+
+// Fast reduced decode for showing something while the full image loads.
+// Only for decoders which can scale during read (jpeg does it via idct).
+// Returns nullptr if that is not possible or not worth it.
+std::shared_ptr<const QImage> ImageFactory::createPreview(QString path, QSize maxSize) {
+    DocumentInfo docInfo(path);
+    if(docInfo.type() != STATIC || maxSize.isEmpty())
+        return nullptr;
+    QImageReader r(path, docInfo.format().toStdString().c_str());
+    if(!r.supportsOption(QImageIOHandler::ScaledSize) || !r.size().isValid())
+        return nullptr;
+    // orientations 4-7 swap width & height
+    if(docInfo.exifOrientation() >= 4)
+        maxSize.transpose();
+    QSize fullSize = r.size();
+    QSize scaledSize = fullSize.scaled(maxSize, Qt::KeepAspectRatio);
+    // less than 2x reduction; just wait for the full thing
+    if(scaledSize.width() * 2 > fullSize.width())
+        return nullptr;
+    r.setScaledSize(scaledSize);
+    QImage *tmp = new QImage();
+    if(!r.read(tmp) || tmp->size() != scaledSize) {
+        delete tmp;
+        return nullptr;
+    }
+    std::unique_ptr<const QImage> img(tmp);
+    img = ImageLib::exifRotated(std::move(img), docInfo.exifOrientation());
+    return std::shared_ptr<const QImage>(img.release());
+}
@@ -10,4 +10,6 @@
 class ImageFactory {
 public:
     static std::shared_ptr<Image> createImage(QString path);
+    static std::shared_ptr<Image> createImage(QString path, std::shared_ptr<std::atomic_bool> cancelFlag);
+    static std::shared_ptr<const QImage> createPreview(QString path, QSize maxSize);
 };
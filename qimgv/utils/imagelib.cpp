@@ -141,6 +141,13 @@ QImage *ImageLib::cropped(QRect newRect, QRect targetRes, bool upscaled) {
 */
 
 QImage* ImageLib::scaled(std::shared_ptr<const QImage> source, QSize destSize, ScalingFilter filter) {
+    return scaledCancellable(source, destSize, filter, nullptr);
+}
+
+// Only the built-in resampler can stop halfway, other filters check the flag when done
+QImage* ImageLib::scaledCancellable(std::shared_ptr<const QImage> source, QSize destSize, ScalingFilter filter, const std::atomic_bool *cancel) {
+    if(cancel && *cancel)
+        return nullptr;
     if(!source)
         return new QImage();
     auto scaleTarget = source;
@@ -151,25 +158,48 @@ QImage* ImageLib::scaled(std::shared_ptr<const QImage> source, QSize destSize, S
         scaleTarget.reset(new QImage(source->convertToFormat(newFmt)));
     }
 #ifdef USE_OPENCV
-    if(filter > 1 && !QtOcv::isSupported(scaleTarget->format()))
+    if(filter >= QI_FILTER_CV_BILINEAR_SHARPEN && filter <= QI_FILTER_CV_CUBIC_SHARPEN &&
+       !QtOcv::isSupported(scaleTarget->format()))
         filter = QI_FILTER_BILINEAR;
 #endif
+    QImage *result = nullptr;
     switch (filter) {
         case QI_FILTER_NEAREST:
-            return scaled_Qt(scaleTarget, destSize, false);
+            result = scaled_Qt(scaleTarget, destSize, false);
+            break;
         case QI_FILTER_BILINEAR:
-            return scaled_Qt(scaleTarget, destSize, true);
+            if(destSize.width() <= scaleTarget->width() && destSize.height() <= scaleTarget->height() &&
+               Resampler::supportsFormat(scaleTarget->format()))
+            {
+                return scaled_Area(scaleTarget, destSize, cancel);
+            }
+            result = scaled_Qt(scaleTarget, destSize, true);
+            break;
+        case QI_FILTER_LANCZOS:
+            if(Resampler::supportsFormat(scaleTarget->format()))
+                return scaled_Lanczos(scaleTarget, destSize, cancel);
+            result = scaled_Qt(scaleTarget, destSize, true);
+            break;
 #ifdef USE_OPENCV
         case QI_FILTER_CV_BILINEAR_SHARPEN:
-            return scaled_CV(scaleTarget, destSize, cv::INTER_LINEAR, 0);
+            result = scaled_CV(scaleTarget, destSize, cv::INTER_LINEAR, 0);
+            break;
         case QI_FILTER_CV_CUBIC:
-            return scaled_CV(scaleTarget, destSize, cv::INTER_CUBIC, 0);
+            result = scaled_CV(scaleTarget, destSize, cv::INTER_CUBIC, 0);
+            break;
         case QI_FILTER_CV_CUBIC_SHARPEN:
-            return scaled_CV(scaleTarget, destSize, cv::INTER_CUBIC, 1);
+            result = scaled_CV(scaleTarget, destSize, cv::INTER_CUBIC, 1);
+            break;
 #endif
         default:
-            return scaled_Qt(scaleTarget, destSize, true);
+            result = scaled_Qt(scaleTarget, destSize, true);
+            break;
+    }
+    if(cancel && *cancel) {
+        delete result;
+        return nullptr;
     }
+    return result;
 }
 
 QImage* ImageLib::scaled_Qt(std::shared_ptr<const QImage> source, QSize destSize, bool smooth) {
@@ -181,6 +211,29 @@ QImage* ImageLib::scaled_Qt(std::shared_ptr<const QImage> source, QSize destSize
     return dest;
 }
 
+// Pixel area averaging, same thing QImage does for smooth downscaling
+// but split between all cores. Result does not depend on the core count.
+QImage* ImageLib::scaled_Area(std::shared_ptr<const QImage> source, QSize destSize, const std::atomic_bool *cancel) {
+    if(!source)
+        return new QImage();
+    QImage result = Resampler::resample(*source.get(), destSize, Resampler::KERNEL_AREA,
+                                        QThread::idealThreadCount(), Resampler::IMPL_AUTO, cancel);
+    if(cancel && *cancel)
+        return nullptr;
+    return new QImage(result);
+}
+
+// Lanczos-3, sharper than area averaging. Works for upscaling too.
+QImage* ImageLib::scaled_Lanczos(std::shared_ptr<const QImage> source, QSize destSize, const std::atomic_bool *cancel) {
+    if(!source)
+        return new QImage();
+    QImage result = Resampler::resample(*source.get(), destSize, Resampler::KERNEL_LANCZOS3,
+                                        QThread::idealThreadCount(), Resampler::IMPL_AUTO, cancel);
+    if(cancel && *cancel)
+        return nullptr;
+    return new QImage(result);
+}
+
 #ifdef USE_OPENCV
 // this probably leaks, needs checking
 QImage* ImageLib::scaled_CV(std::shared_ptr<const QImage> source, QSize destSize, cv::InterpolationFlags filter, int sharpen) {
@@ -8,6 +8,7 @@
 #include <QProcess>
 #include "sourcecontainers/documentinfo.h"
 #include "settings.h"
+#include "utils/resampler.h"
 
 #ifdef USE_OPENCV
 #include "3rdparty/QtOpenCV/cvmatandqimage.h"
@@ -30,9 +31,13 @@ class ImageLib {
 
         //static QImage *scaled(const QImage *source, QSize destSize, ScalingFilter filter);
         static QImage *scaled(std::shared_ptr<const QImage> source, QSize destSize, ScalingFilter filter);
+        // returns nullptr if *cancel got set before the result was ready
+        static QImage *scaledCancellable(std::shared_ptr<const QImage> source, QSize destSize, ScalingFilter filter, const std::atomic_bool *cancel);
 
         static QImage *scaled_Qt(const QImage *source, QSize destSize, bool smooth);
         static QImage *scaled_Qt(std::shared_ptr<const QImage> source, QSize destSize, bool smooth);
+        static QImage *scaled_Area(std::shared_ptr<const QImage> source, QSize destSize, const std::atomic_bool *cancel = nullptr);
+        static QImage *scaled_Lanczos(std::shared_ptr<const QImage> source, QSize destSize, const std::atomic_bool *cancel = nullptr);
 
 #ifdef USE_OPENCV
         static QImage *scaled_CV(std::shared_ptr<const QImage> source, QSize destSize, cv::InterpolationFlags filter, int sharpen);
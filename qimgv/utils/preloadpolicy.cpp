@@ -0,0 +1,47 @@
+#include "preloadpolicy.h"
+
+PreloadPolicy::PreloadPolicy()
+    : mAhead(1),
+      mBehind(1),
+      mDirection(1)
+{
+}
+
+void PreloadPolicy::setDepth(int ahead, int behind) {
+    mAhead = qMax(ahead, 1);
+    mBehind = qMax(behind, 0);
+}
+
+bool PreloadPolicy::step(int fromIndex, int toIndex) {
+    int delta = toIndex - fromIndex;
+    // ignore jumps (first/last, random, new directory etc.)
+    if(fromIndex < 0 || delta == 0 || qAbs(delta) > 1)
+        return false;
+    if(delta != mDirection) {
+        mDirection = delta;
+        return true;
+    }
+    return false;
+}
+
+void PreloadPolicy::reset() {
+    mDirection = 1;
+}
+
+int PreloadPolicy::direction() const {
+    return mDirection;
+}
+
+QList<int> PreloadPolicy::indexes(int current, int count) const {
+    QList<int> list;
+    int maxDepth = qMax(mAhead, mBehind);
+    for(int i = 1; i <= maxDepth; i++) {
+        int fwd = current + i * mDirection;
+        int back = current - i * mDirection;
+        if(i <= mAhead && fwd >= 0 && fwd < count)
+            list << fwd;
+        if(i <= mBehind && back >= 0 && back < count)
+            list << back;
+    }
+    return list;
+}
@@ -0,0 +1,24 @@
+#pragma once
+
+#include <QList>
+#include <QtGlobal>
+
+// Decides which files to preload based on recent navigation.
+// The full configured depth is preloaded in the direction of the last step,
+// and the "behind" depth in the other one. Jumps keep the direction.
+class PreloadPolicy {
+public:
+    PreloadPolicy();
+
+    void setDepth(int ahead, int behind);
+    // registers a navigation step; returns true if direction has changed
+    bool step(int fromIndex, int toIndex);
+    // back to moving forward
+    void reset();
+    int direction() const;
+    // indexes to preload around current, nearest first
+    QList<int> indexes(int current, int count) const;
+
+private:
+    int mAhead, mBehind, mDirection;
+};
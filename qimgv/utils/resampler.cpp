@@ -0,0 +1,450 @@
+#include "resampler.h"
+
+#include <atomic>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(_M_X64) || defined(__i386__) || defined(_M_IX86)
+#define RESAMPLER_X86
+#include <immintrin.h>
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+#endif
+
+#if defined(RESAMPLER_X86) && (defined(__GNUC__) || defined(__clang__))
+#define TARGET_SSE2 __attribute__((target("sse2")))
+#define TARGET_AVX2 __attribute__((target("avx2")))
+#else
+#define TARGET_SSE2
+#define TARGET_AVX2
+#endif
+
+namespace {
+
+const int VERTICAL_SHIFT = Resampler::WEIGHT_BITS - Resampler::MID_BITS;
+const int HORIZONTAL_SHIFT = Resampler::WEIGHT_BITS + Resampler::MID_BITS;
+const double PI = 3.14159265358979323846;
+
+class ParallelTask : public QRunnable {
+public:
+    ParallelTask(std::function<void()> _func) : func(_func) { }
+    void run() { func(); }
+private:
+    std::function<void()> func;
+};
+
+inline int16_t saturate16(int32_t value) {
+    return static_cast<int16_t>(qBound(-32768, value, 32767));
+}
+
+double lanczos3(double t) {
+    if(t == 0.0)
+        return 1.0;
+    if(t <= -3.0 || t >= 3.0)
+        return 0.0;
+    double pt = PI * t;
+    return 3.0 * std::sin(pt) * std::sin(pt / 3.0) / (pt * pt);
+}
+
+// ---------------------------------------------------------------- generic
+
+// mid[x] = sum(w[j] * row[first + j][x]), for x in [x0, length)
+void verticalGeneric(const uchar *src, int srcStride, int first, int count, const int16_t *w,
+                     int16_t *mid, int x0, int length, int32_t *scratch)
+{
+    std::fill(scratch + x0, scratch + length, 0);
+    for(int j = 0; j < count; j++) {
+        const uchar *s = src + static_cast<qint64>(first + j) * srcStride;
+        const int32_t weight = w[j];
+        for(int x = x0; x < length; x++)
+            scratch[x] += weight * s[x];
+    }
+    for(int x = x0; x < length; x++)
+        mid[x] = saturate16((scratch[x] + (1 << (VERTICAL_SHIFT - 1))) >> VERTICAL_SHIFT);
+}
+
+void horizontalGeneric(const int16_t *mid, uchar *dst, int dstWidth, int channels,
+                       const int *start, const int *count, const int16_t *weights, int stride)
+{
+    for(int x = 0; x < dstWidth; x++) {
+        const int16_t *w = weights + static_cast<qint64>(x) * stride;
+        const int16_t *m = mid + start[x] * channels;
+        for(int ch = 0; ch < channels; ch++) {
+            int32_t acc = 0;
+            for(int j = 0; j < count[x]; j++)
+                acc += w[j] * m[j * channels + ch];
+            acc = (acc + (1 << (HORIZONTAL_SHIFT - 1))) >> HORIZONTAL_SHIFT;
+            dst[x * channels + ch] = static_cast<uchar>(qBound(0, acc, 255));
+        }
+    }
+}
+
+#ifdef RESAMPLER_X86
+// two int16 weights packed for _mm_madd_epi16
+inline int weightPair(int16_t a, int16_t b) {
+    return static_cast<int>(static_cast<uint32_t>(static_cast<uint16_t>(a)) |
+                            (static_cast<uint32_t>(static_cast<uint16_t>(b)) << 16));
+}
+
+// ---------------------------------------------------------------- sse2
+
+// 16 pixels per step; two source rows at a time via madd
+TARGET_SSE2
+void verticalSSE2(const uchar *src, int srcStride, int first, int count, const int16_t *w,
+                  int16_t *mid, int x0, int length, int32_t *scratch)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (VERTICAL_SHIFT - 1));
+    int x = x0;
+    for(; x + 16 <= length; x += 16) {
+        __m128i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        const uchar *s = src + static_cast<qint64>(first) * srcStride + x;
+        int j = 0;
+        for(; j + 1 < count; j += 2) {
+            __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + static_cast<qint64>(j) * srcStride));
+            __m128i r1 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + static_cast<qint64>(j + 1) * srcStride));
+            __m128i wv = _mm_set1_epi32(weightPair(w[j], w[j + 1]));
+            // r0[0] r1[0] r0[1] r1[1] ...
+            __m128i lo = _mm_unpacklo_epi8(r0, r1);
+            __m128i hi = _mm_unpackhi_epi8(r0, r1);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), wv));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), wv));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), wv));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), wv));
+        }
+        if(j < count) {
+            __m128i r0 = _mm_loadu_si128(reinterpret_cast<const __m128i*>(s + static_cast<qint64>(j) * srcStride));
+            __m128i wv = _mm_set1_epi32(weightPair(w[j], 0));
+            __m128i lo = _mm_unpacklo_epi8(r0, zero);
+            __m128i hi = _mm_unpackhi_epi8(r0, zero);
+            acc0 = _mm_add_epi32(acc0, _mm_madd_epi16(_mm_unpacklo_epi8(lo, zero), wv));
+            acc1 = _mm_add_epi32(acc1, _mm_madd_epi16(_mm_unpackhi_epi8(lo, zero), wv));
+            acc2 = _mm_add_epi32(acc2, _mm_madd_epi16(_mm_unpacklo_epi8(hi, zero), wv));
+            acc3 = _mm_add_epi32(acc3, _mm_madd_epi16(_mm_unpackhi_epi8(hi, zero), wv));
+        }
+        acc0 = _mm_srai_epi32(_mm_add_epi32(acc0, round), VERTICAL_SHIFT);
+        acc1 = _mm_srai_epi32(_mm_add_epi32(acc1, round), VERTICAL_SHIFT);
+        acc2 = _mm_srai_epi32(_mm_add_epi32(acc2, round), VERTICAL_SHIFT);
+        acc3 = _mm_srai_epi32(_mm_add_epi32(acc3, round), VERTICAL_SHIFT);
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mid + x), _mm_packs_epi32(acc0, acc1));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(mid + x + 8), _mm_packs_epi32(acc2, acc3));
+    }
+    if(x < length)
+        verticalGeneric(src, srcStride, first, count, w, mid, x, length, scratch);
+}
+
+// 4 channels, two source pixels at a time
+TARGET_SSE2
+void horizontal4SSE2(const int16_t *mid, uchar *dst, int dstWidth,
+                     const int *start, const int *count, const int16_t *weights, int stride)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i round = _mm_set1_epi32(1 << (HORIZONTAL_SHIFT - 1));
+    for(int x = 0; x < dstWidth; x++) {
+        const int16_t *w = weights + static_cast<qint64>(x) * stride;
+        const int16_t *m = mid + start[x] * 4;
+        __m128i acc = zero;
+        int j = 0;
+        for(; j + 1 < count[x]; j += 2) {
+            __m128i p = _mm_loadu_si128(reinterpret_cast<const __m128i*>(m + j * 4));
+            // a.c0 b.c0 a.c1 b.c1 ...
+            __m128i pairs = _mm_unpacklo_epi16(p, _mm_srli_si128(p, 8));
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, _mm_set1_epi32(weightPair(w[j], w[j + 1]))));
+        }
+        if(j < count[x]) {
+            __m128i p = _mm_loadl_epi64(reinterpret_cast<const __m128i*>(m + j * 4));
+            __m128i pairs = _mm_unpacklo_epi16(p, zero);
+            acc = _mm_add_epi32(acc, _mm_madd_epi16(pairs, _mm_set1_epi32(weightPair(w[j], 0))));
+        }
+        acc = _mm_srai_epi32(_mm_add_epi32(acc, round), HORIZONTAL_SHIFT);
+        __m128i packed = _mm_packus_epi16(_mm_packs_epi32(acc, zero), zero);
+        int32_t pixel = _mm_cvtsi128_si32(packed);
+        memcpy(dst + x * 4, &pixel, 4);
+    }
+}
+
+// ---------------------------------------------------------------- avx2
+
+// same as sse2 version, 32 pixels per step
+TARGET_AVX2
+void verticalAVX2(const uchar *src, int srcStride, int first, int count, const int16_t *w,
+                  int16_t *mid, int x0, int length, int32_t *scratch)
+{
+    const __m256i zero = _mm256_setzero_si256();
+    const __m256i round = _mm256_set1_epi32(1 << (VERTICAL_SHIFT - 1));
+    int x = x0;
+    for(; x + 32 <= length; x += 32) {
+        __m256i acc0 = zero, acc1 = zero, acc2 = zero, acc3 = zero;
+        const uchar *s = src + static_cast<qint64>(first) * srcStride + x;
+        int j = 0;
+        for(; j + 1 < count; j += 2) {
+            __m256i r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + static_cast<qint64>(j) * srcStride));
+            __m256i r1 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + static_cast<qint64>(j + 1) * srcStride));
+            __m256i wv = _mm256_set1_epi32(weightPair(w[j], w[j + 1]));
+            __m256i lo = _mm256_unpacklo_epi8(r0, r1);
+            __m256i hi = _mm256_unpackhi_epi8(r0, r1);
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), wv));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), wv));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), wv));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), wv));
+        }
+        if(j < count) {
+            __m256i r0 = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(s + static_cast<qint64>(j) * srcStride));
+            __m256i wv = _mm256_set1_epi32(weightPair(w[j], 0));
+            __m256i lo = _mm256_unpacklo_epi8(r0, zero);
+            __m256i hi = _mm256_unpackhi_epi8(r0, zero);
+            acc0 = _mm256_add_epi32(acc0, _mm256_madd_epi16(_mm256_unpacklo_epi8(lo, zero), wv));
+            acc1 = _mm256_add_epi32(acc1, _mm256_madd_epi16(_mm256_unpackhi_epi8(lo, zero), wv));
+            acc2 = _mm256_add_epi32(acc2, _mm256_madd_epi16(_mm256_unpacklo_epi8(hi, zero), wv));
+            acc3 = _mm256_add_epi32(acc3, _mm256_madd_epi16(_mm256_unpackhi_epi8(hi, zero), wv));
+        }
+        acc0 = _mm256_srai_epi32(_mm256_add_epi32(acc0, round), VERTICAL_SHIFT);
+        acc1 = _mm256_srai_epi32(_mm256_add_epi32(acc1, round), VERTICAL_SHIFT);
+        acc2 = _mm256_srai_epi32(_mm256_add_epi32(acc2, round), VERTICAL_SHIFT);
+        acc3 = _mm256_srai_epi32(_mm256_add_epi32(acc3, round), VERTICAL_SHIFT);
+        // unpack & pack work within 128 bit lanes: [0-7 | 16-23], [8-15 | 24-31]
+        __m256i p0 = _mm256_packs_epi32(acc0, acc1);
+        __m256i p1 = _mm256_packs_epi32(acc2, acc3);
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mid + x), _mm256_permute2x128_si256(p0, p1, 0x20));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(mid + x + 16), _mm256_permute2x128_si256(p0, p1, 0x31));
+    }
+    if(x < length)
+        verticalSSE2(src, srcStride, first, count, w, mid, x, length, scratch);
+}
+
+bool cpuHasSSE2() {
+#if defined(__x86_64__) || defined(_M_X64)
+    return true;
+#elif defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("sse2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 1);
+    return info[3] & (1 << 26);
+#else
+    return false;
+#endif
+}
+
+bool cpuHasAVX2() {
+#if defined(__GNUC__) || defined(__clang__)
+    __builtin_cpu_init();
+    return __builtin_cpu_supports("avx2");
+#elif defined(_MSC_VER)
+    int info[4];
+    __cpuid(info, 0);
+    if(info[0] < 7)
+        return false;
+    __cpuid(info, 1);
+    // os must save ymm registers
+    bool osxsave = info[2] & (1 << 27);
+    if(!osxsave || (_xgetbv(0) & 6) != 6)
+        return false;
+    __cpuidex(info, 7, 0);
+    return info[1] & (1 << 5);
+#else
+    return false;
+#endif
+}
+#endif // RESAMPLER_X86
+
+Resampler::Implementation detectImplementation() {
+#ifdef RESAMPLER_X86
+    if(cpuHasAVX2())
+        return Resampler::IMPL_AVX2;
+    if(cpuHasSSE2())
+        return Resampler::IMPL_SSE2;
+#endif
+    return Resampler::IMPL_GENERIC;
+}
+
+} // namespace
+
+bool Resampler::supportsFormat(QImage::Format format) {
+    return format == QImage::Format_RGB32 ||
+           format == QImage::Format_ARGB32 ||
+           format == QImage::Format_ARGB32_Premultiplied ||
+           format == QImage::Format_Grayscale8;
+}
+
+Resampler::Implementation Resampler::implementation() {
+    static const Implementation best = detectImplementation();
+    return best;
+}
+
+QString Resampler::implementationName(Implementation impl) {
+    switch(impl) {
+        case IMPL_GENERIC: return "generic";
+        case IMPL_SSE2:    return "sse2";
+        case IMPL_AVX2:    return "avx2";
+        default:           return implementationName(implementation());
+    }
+}
+
+QImage Resampler::resample(const QImage &src, QSize destSize, Kernel kernel, int threads) {
+    return resample(src, destSize, kernel, threads, IMPL_AUTO);
+}
+
+QImage Resampler::resample(const QImage &src, QSize destSize, Kernel kernel, int threads, Implementation impl,
+                           const std::atomic_bool *cancel)
+{
+    if(src.isNull() || destSize.isEmpty() || !supportsFormat(src.format()))
+        return QImage();
+    // never pick something this cpu can't run
+    if(impl == IMPL_AUTO || impl > implementation())
+        impl = implementation();
+    QImage source = src;
+    // averaging non-premultiplied colors gives dark fringes around transparent areas
+    if(source.format() == QImage::Format_ARGB32)
+        source = source.convertToFormat(QImage::Format_ARGB32_Premultiplied);
+    int channels = (source.format() == QImage::Format_Grayscale8) ? 1 : 4;
+    // lanczos can overshoot; premultiplied colors must stay within alpha
+    int alphaChannel = -1;
+    if(kernel == KERNEL_LANCZOS3 && source.format() == QImage::Format_ARGB32_Premultiplied)
+        alphaChannel = (QSysInfo::ByteOrder == QSysInfo::LittleEndian) ? 3 : 0;
+    QImage dst(destSize, source.format());
+    if(dst.isNull())
+        return QImage();
+    auto cx = contributions(source.width(), destSize.width(), kernel);
+    auto cy = contributions(source.height(), destSize.height(), kernel);
+    // get raw pointers here; scanLine() is not safe to call from several threads
+    const uchar *srcBits = source.constBits();
+    uchar *dstBits = dst.bits();
+    int srcStride = source.bytesPerLine();
+    int dstStride = dst.bytesPerLine();
+    // a few bands per thread to even out the load
+    int bands = qBound(1, threads * 4, destSize.height());
+    runParallel(bands, threads, [&](int band) {
+        int firstRow = destSize.height() * band / bands;
+        int lastRow = destSize.height() * (band + 1) / bands;
+        resampleRows(srcBits, srcStride, source.width(),
+                     dstBits, dstStride, destSize.width(), channels, alphaChannel,
+                     cx, cy, firstRow, lastRow, impl, cancel);
+    });
+    if(cancel && *cancel)
+        return QImage();
+    return dst;
+}
+
+Resampler::Contributions Resampler::contributions(int srcSize, int dstSize, Kernel kernel) {
+    Contributions c;
+    c.start.resize(dstSize);
+    c.count.resize(dstSize);
+    double ratio = static_cast<double>(srcSize) / dstSize;
+    // filter is stretched when downscaling
+    double filterScale = qMax(1.0, ratio);
+    double support = 3.0 * filterScale;
+    if(kernel == KERNEL_AREA)
+        c.stride = static_cast<int>(std::ceil(ratio)) + 2;
+    else
+        c.stride = static_cast<int>(std::ceil(support * 2.0)) + 2;
+    c.weights.assign(static_cast<size_t>(dstSize) * c.stride, 0);
+    const int one = 1 << WEIGHT_BITS;
+    std::vector<double> raw(c.stride);
+    for(int i = 0; i < dstSize; i++) {
+        int first, count;
+        double total = 0;
+        if(kernel == KERNEL_AREA) {
+            // this pixel covers [x0, x1) of the source
+            double x0 = i * ratio;
+            double x1 = (i + 1) * ratio;
+            first = qBound(0, static_cast<int>(std::floor(x0)), srcSize - 1);
+            int last = qBound(first + 1, static_cast<int>(std::ceil(x1)), srcSize);
+            // skip slivers left by rounding errors
+            if(last - first > 1 && qMin(x1, first + 1.0) - x0 < 1e-9)
+                first++;
+            if(last - first > 1 && x1 - (last - 1) < 1e-9)
+                last--;
+            count = last - first;
+            for(int j = 0; j < count; j++) {
+                int x = first + j;
+                raw[j] = qMax(0.0, qMin(x1, x + 1.0) - qMax(x0, static_cast<double>(x)));
+                total += raw[j];
+            }
+        } else {
+            double center = (i + 0.5) * ratio;
+            first = qBound(0, static_cast<int>(std::floor(center - support)), srcSize - 1);
+            int last = qBound(first + 1, static_cast<int>(std::ceil(center + support)), srcSize);
+            count = qMin(last - first, c.stride);
+            for(int j = 0; j < count; j++) {
+                raw[j] = lanczos3((first + j + 0.5 - center) / filterScale);
+                total += raw[j];
+            }
+        }
+        // convert to fixed point; weights must sum up to exactly one
+        int16_t *w = &c.weights[static_cast<size_t>(i) * c.stride];
+        int sum = 0, largest = 0;
+        for(int j = 0; j < count; j++) {
+            w[j] = static_cast<int16_t>(std::lround(raw[j] / total * one));
+            sum += w[j];
+            if(w[j] > w[largest])
+                largest = j;
+        }
+        w[largest] += one - sum;
+        c.start[i] = first;
+        c.count[i] = count;
+    }
+    return c;
+}
+
+// vertical pass into an intermediate row, then horizontal
+void Resampler::resampleRows(const uchar *src, int srcStride, int srcWidth,
+                             uchar *dst, int dstStride, int dstWidth, int channels, int alphaChannel,
+                             const Contributions &cx, const Contributions &cy,
+                             int firstRow, int lastRow, Implementation impl, const std::atomic_bool *cancel)
+{
+    const int rowLength = srcWidth * channels;
+    std::vector<int16_t> mid(rowLength);
+    std::vector<int32_t> scratch(rowLength);
+    for(int y = firstRow; y < lastRow; y++) {
+        if(cancel && *cancel)
+            return;
+        const int16_t *wy = &cy.weights[static_cast<size_t>(y) * cy.stride];
+        uchar *d = dst + static_cast<qint64>(y) * dstStride;
+#ifdef RESAMPLER_X86
+        if(impl == IMPL_AVX2)
+            verticalAVX2(src, srcStride, cy.start[y], cy.count[y], wy, mid.data(), 0, rowLength, scratch.data());
+        else if(impl == IMPL_SSE2)
+            verticalSSE2(src, srcStride, cy.start[y], cy.count[y], wy, mid.data(), 0, rowLength, scratch.data());
+        else
+#endif
+            verticalGeneric(src, srcStride, cy.start[y], cy.count[y], wy, mid.data(), 0, rowLength, scratch.data());
+#ifdef RESAMPLER_X86
+        if(impl != IMPL_GENERIC && channels == 4)
+            horizontal4SSE2(mid.data(), d, dstWidth, cx.start.data(), cx.count.data(), cx.weights.data(), cx.stride);
+        else
+#endif
+            horizontalGeneric(mid.data(), d, dstWidth, channels, cx.start.data(), cx.count.data(), cx.weights.data(), cx.stride);
+        if(alphaChannel >= 0) {
+            for(int x = 0; x < dstWidth; x++) {
+                uchar *pixel = d + x * 4;
+                for(int ch = 0; ch < 4; ch++) {
+                    if(ch != alphaChannel && pixel[ch] > pixel[alphaChannel])
+                        pixel[ch] = pixel[alphaChannel];
+                }
+            }
+        }
+    }
+}
+
+// Runs func(0..count-1) on the global pool, the calling thread helps out.
+// Bands are handed out one by one, so it also works when the pool is busy.
+void Resampler::runParallel(int count, int threads, const std::function<void(int)> &func) {
+    std::atomic<int> next(0);
+    auto worker = [&]() {
+        int i;
+        while((i = next++) < count)
+            func(i);
+    };
+    int helpers = qBound(0, threads - 1, count - 1);
+    QSemaphore done;
+    for(int i = 0; i < helpers; i++) {
+        QThreadPool::globalInstance()->start(new ParallelTask([&]() {
+            worker();
+            done.release();
+        }));
+    }
+    worker();
+    done.acquire(helpers);
+}
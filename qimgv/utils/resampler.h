@@ -0,0 +1,62 @@
+#pragma once
+
+#include <QImage>
+#include <QThread>
+#include <QThreadPool>
+#include <QRunnable>
+#include <QSemaphore>
+#include <QSysInfo>
+#include <functional>
+#include <vector>
+#include <cstdint>
+#include <atomic>
+#include <cmath>
+
+// Separable fixed-point resampler for 8 bit per channel images.
+// Destination is split into horizontal bands which are processed in parallel.
+// Filter weights are computed once for the whole image, so every row comes out
+// the same no matter how many bands there are.
+// Inner loops have SSE2 / AVX2 versions picked at runtime; all of them
+// produce exactly the same result as the plain C++ one.
+class Resampler {
+public:
+    enum Kernel {
+        KERNEL_AREA,    // box filter / pixel area averaging. for downscaling
+        KERNEL_LANCZOS3 // windowed sinc, sharper. may overshoot a bit
+    };
+
+    enum Implementation {
+        IMPL_AUTO,
+        IMPL_GENERIC,
+        IMPL_SSE2,
+        IMPL_AVX2
+    };
+
+    static bool supportsFormat(QImage::Format format);
+    // returns a null image if the format is not supported
+    static QImage resample(const QImage &src, QSize destSize, Kernel kernel, int threads);
+    // stops between rows once *cancel is set, and returns a null image
+    static QImage resample(const QImage &src, QSize destSize, Kernel kernel, int threads, Implementation impl,
+                           const std::atomic_bool *cancel = nullptr);
+    // best one available on this cpu
+    static Implementation implementation();
+    static QString implementationName(Implementation impl);
+
+    static const int WEIGHT_BITS = 14;
+    // intermediate (after vertical pass) precision. keeps it within int16
+    static const int MID_BITS = 6;
+
+private:
+    // which source pixels contribute to each destination pixel, and how much
+    struct Contributions {
+        std::vector<int> start, count;
+        std::vector<int16_t> weights; // WEIGHT_BITS fixed point; count[i] used out of stride
+        int stride = 0;
+    };
+    static Contributions contributions(int srcSize, int dstSize, Kernel kernel);
+    static void resampleRows(const uchar *src, int srcStride, int srcWidth,
+                             uchar *dst, int dstStride, int dstWidth, int channels, int alphaChannel,
+                             const Contributions &cx, const Contributions &cy,
+                             int firstRow, int lastRow, Implementation impl, const std::atomic_bool *cancel);
+    static void runParallel(int count, int threads, const std::function<void(int)> &func);
+};